@@ -10,6 +10,8 @@
 # implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
 ###############################################################################
 
+include (CMakeParseArguments)
+
 # ----------------------------------------------------------------------------
 # split version string into parts
 function (split_version VERSION MAJOR MINOR PATCH)
@@ -85,12 +87,48 @@ endmacro ()
 # add command-line tool
 macro (add_tool tgt)
  add_executable (${tgt} src/${tgt}.cc ${ARGN})
- if (CIMG_LIBRARIES)
-   target_link_libraries (${tgt} ${CIMG_LIBRARIES})
- endif ()
+ target_link_libraries (${tgt} animtk)
  install (TARGETS ${tgt} RUNTIME DESTINATION ${RUNTIME_INSTALL_DIR} COMPONENT tools)
 endmacro ()
 
+# -----------------------------------------------------------------------------
+# add golden output regression test of crop-frames
+#
+# add_golden_test (<name> [EXPECTED <other>] SYNTH <synth-frames args>... [CROP <crop-frames args>...])
+#
+# The input sequence is generated by synth-frames and cropped by crop-frames.
+# The output is compared to the expected output in test/expected/<name>.txt,
+# or test/expected/<other>.txt if the output must equal the one of another test.
+# One test is added for each kernel variant in GOLDEN_TEST_VARIANTS, where each
+# variant is given as "<name>:<VAR>=<value>[,<VAR>=<value>]..." and the
+# environment variables select the code path of the variant.
+function (add_golden_test name)
+  cmake_parse_arguments (ARGS "" "EXPECTED" "SYNTH;CROP" ${ARGN})
+  if (NOT ARGS_EXPECTED)
+    set (ARGS_EXPECTED "${name}")
+  endif ()
+  string (REPLACE ";" " " SYNTH_ARGS "${ARGS_SYNTH}")
+  string (REPLACE ";" " " CROP_ARGS  "${ARGS_CROP}")
+  foreach (VARIANT IN LISTS GOLDEN_TEST_VARIANTS)
+    string (REGEX REPLACE ":.*$"    "" VARIANT_NAME "${VARIANT}")
+    string (REGEX REPLACE "^[^:]*:" "" VARIANT_ENV  "${VARIANT}")
+    string (REPLACE "," ";" VARIANT_ENV "${VARIANT_ENV}")
+    add_test (
+      NAME    golden-${name}-${VARIANT_NAME}
+      COMMAND "${CMAKE_COMMAND}"
+                "-DCROP_FRAMES=$<TARGET_FILE:crop-frames>"
+                "-DSYNTH_FRAMES=$<TARGET_FILE:synth-frames>"
+                "-DHASH_FRAMES=$<TARGET_FILE:hash-frames>"
+                "-DSYNTH_ARGS=${SYNTH_ARGS}"
+                "-DCROP_ARGS=${CROP_ARGS}"
+                "-DEXPECTED=${PROJECT_SOURCE_DIR}/test/expected/${ARGS_EXPECTED}.txt"
+                "-DWORKING_DIR=${PROJECT_BINARY_DIR}/test/${name}-${VARIANT_NAME}"
+                -P "${PROJECT_SOURCE_DIR}/test/RunGoldenTest.cmake"
+    )
+    set_tests_properties (golden-${name}-${VARIANT_NAME} PROPERTIES ENVIRONMENT "${VARIANT_ENV}")
+  endforeach ()
+endfunction ()
+
 # -----------------------------------------------------------------------------
 # configure Mac OS X workflow
 #
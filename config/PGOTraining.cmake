@@ -0,0 +1,110 @@
+###############################################################################
+# Animation Toolkit - Training run of profile-guided optimization build
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DCROP_FRAMES=<file> -DSYNTH_FRAMES=<file> -DWORKING_DIR=<dir>
+#         [-DPROFILE_DIR=<dir> -DLLVM_PROFDATA=<file>]
+#         -P PGOTraining.cmake
+#
+# Generates a corpus of synthetic image sequences using synth-frames and runs
+# the instrumented crop-frames tool on each sequence in each of its modes and
+# with each of its additional outputs.
+# When the tools were instrumented by Clang, the raw profiles are merged into
+# the PROFILE_DIR/default.profdata file afterwards.
+
+foreach (VAR CROP_FRAMES SYNTH_FRAMES WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+# ----------------------------------------------------------------------------
+# synthetic benchmark corpus, each entry is "<name>:<synth-frames arguments>"
+set (CORPUS
+  "walk:-k walk -n 48 -x 640 -y 360"
+  "walk-rgb:-k walk -n 24 -x 320 -y 240 -c 3"
+  "twin:-k twin -n 24 -x 512 -y 256"
+  "limbs:-k limbs -n 24 -x 256 -y 256"
+  "pixel:-k pixel -n 16 -x 97 -y 64"
+  "opaque:-k opaque -n 8 -x 128 -y 96"
+  "plate:-k walk -n 1 -x 2048 -y 1536"
+)
+
+# modes of crop-frames which are exercised, each entry is "<name>:<crop-frames arguments>",
+# where "tight" means no extra options and <dir> is replaced by the directory of the sequence
+set (MODES
+  "tight:"
+  "union:-u"
+  "fixed:-f"
+  "segments:--segments 1000"
+  "stack:-u --stack"
+  "cache:--cache <dir>/cache"
+  "regions:--regions --gap 4"
+  "delta:-u --delta <dir>/delta.csv --keyframes 8"
+  "hull:--hull <dir>/hull.csv"
+  "scales:--scales 1,0.5,0.25"
+  "texture:-f --texture bc3"
+  "colors:--colors 16"
+  "masks:--masks <dir>/cropped.mask"
+  "bleed:-u --bleed 2"
+  "tiles:-u --tiles <dir>/tiles.csv"
+)
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (COMMAND ${ARGN} RESULT_VARIABLE RETVAL)
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}")
+  endif ()
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}")
+
+foreach (ENTRY IN LISTS CORPUS)
+  string (REGEX REPLACE ":.*$" "" NAME "${ENTRY}")
+  string (REGEX REPLACE "^[^:]*:" "" ARGS "${ENTRY}")
+  separate_arguments (ARGS)
+  set (DIR "${WORKING_DIR}/${NAME}")
+  file (MAKE_DIRECTORY "${DIR}")
+  message (STATUS "Training on ${NAME}...")
+  run ("${SYNTH_FRAMES}" -o "${DIR}/${NAME}_%05d.png" ${ARGS})
+  foreach (MODE IN LISTS MODES)
+    string (REGEX REPLACE ":.*$" "" MODE_NAME "${MODE}")
+    string (REGEX REPLACE "^[^:]*:" "" OPTS "${MODE}")
+    string (REPLACE "<dir>" "${DIR}" OPTS "${OPTS}")
+    separate_arguments (OPTS)
+    if (OPTS MATCHES "--texture")
+      set (EXT "dds")
+    else ()
+      set (EXT "png")
+    endif ()
+    run ("${CROP_FRAMES}" -i "${DIR}/${NAME}_00000.png" -o "${DIR}/cropped-${MODE_NAME}.${EXT}" ${OPTS})
+    # second run of cached mode reuses the cropped frames of unchanged input frames
+    if (MODE_NAME STREQUAL "cache")
+      run ("${CROP_FRAMES}" -i "${DIR}/${NAME}_00000.png" -o "${DIR}/cropped-${MODE_NAME}.${EXT}" ${OPTS})
+    endif ()
+  endforeach ()
+  # append mode processing a single image at a time
+  run ("${CROP_FRAMES}" -a -i "${DIR}/${NAME}_00000.png" -o "${DIR}/single.png" -c "${DIR}/single.csv")
+endforeach ()
+
+# ----------------------------------------------------------------------------
+# merge raw profiles written by Clang instrumented executables
+if (LLVM_PROFDATA AND PROFILE_DIR)
+  file (GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+  if (RAW_PROFILES)
+    run ("${LLVM_PROFDATA}" merge -output "${PROFILE_DIR}/default.profdata" ${RAW_PROFILES})
+  endif ()
+endif ()
@@ -0,0 +1,40 @@
+#!/bin/sh
+###############################################################################
+# Animation Toolkit - Two-stage profile-guided optimization build
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage: pgo-build.sh <source dir> <build dir> [<additional CMake arguments>]
+#
+# 1. Builds instrumented tools (PGO_STAGE=GENERATE).
+# 2. Runs the tools on the synthetic benchmark corpus (pgo-train target).
+# 3. Rebuilds the tools using the collected profiles (PGO_STAGE=USE).
+
+set -e
+
+if [ $# -lt 2 ]; then
+  echo "usage: $0 <source dir> <build dir> [<additional CMake arguments>]" 1>&2
+  exit 1
+fi
+
+src="$1"
+bld="$2"
+shift 2
+
+src="$(cd "$src" && pwd)"
+mkdir -p "$bld"
+cd "$bld"
+
+rm -rf pgo
+cmake "$src" -DCMAKE_BUILD_TYPE=Release -DPGO_STAGE=GENERATE "$@"
+cmake --build .
+cmake --build . --target pgo-train
+cmake "$src" -DPGO_STAGE=USE
+cmake --build .
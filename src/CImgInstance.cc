@@ -0,0 +1,24 @@
+/* CImg configuration and instantiation for The Animation Toolkit
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CImgInstance.h"
+
+// ----------------------------------------------------------------------------
+// Explicit instantiation of the image types used by the tools, including the
+// methods added by the CImgPlugin.h
+template struct cimg_library::CImg<unsigned char>;
+template struct cimg_library::CImgList<unsigned char>;
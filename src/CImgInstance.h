@@ -0,0 +1,41 @@
+/* CImg configuration and instantiation for The Animation Toolkit
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CIMG_INSTANCE_H
+#define CIMG_INSTANCE_H
+
+// ----------------------------------------------------------------------------
+// CImg, configured the same way for the library and all tools
+#include "CImgConfig.h"
+#ifndef cimg_display
+#  define cimg_display 0
+#endif
+#ifndef cimg_verbosity
+#  define cimg_verbosity 0
+#endif
+#define cimg_plugin "CImgPlugin.h"
+#include "CImg.h"
+
+// ----------------------------------------------------------------------------
+// The image types used by the tools are explicitly instantiated only once in
+// CImgInstance.cc, which is part of the animtk library. Other translation units
+// must not instantiate the (non-inlined) member functions again.
+extern template struct cimg_library::CImg<unsigned char>;
+extern template struct cimg_library::CImgList<unsigned char>;
+
+
+#endif // CIMG_INSTANCE_H
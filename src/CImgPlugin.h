@@ -20,7 +20,7 @@
 ///
 /// \param color Color used for the crop. If \c 0, color is guessed.
 /// \param axes Axes used for the crop.
-CImg<int> get_autocrop_region(const T *const color=0, const char *const axes="zyx") {
+CImg<int> get_autocrop_region(const T *const color=0, const char *const axes="zyx") const {
   CImg<int> bb(3,2);
   bb(0,0) = bb(1,0) = bb(2,0) =  0;
   bb(0,1) = bb(1,1) = bb(2,1) = -1;
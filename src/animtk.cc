@@ -0,0 +1,953 @@
+/* Library of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <sys/stat.h>
+
+#include "animtk.h"
+#include "bleed.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "components.h"
+#include "delta.h"
+#include "hull.h"
+#include "mask.h"
+#include "palette.h"
+#include "pool.h"
+#include "scale.h"
+#include "texture.h"
+#include "tiles.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Code paths
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+bool code_path(const char *name)
+{
+  const char *value = getenv(name);
+  return value && *value && strcmp(value, "0") != 0;
+}
+
+// ----------------------------------------------------------------------------
+size_t parallel_frame_size()
+{
+  const char *value = getenv("ANIMTK_PARALLEL_FRAME_SIZE");
+  if (!value || !*value) return PARALLEL_FRAME_SIZE;
+  return static_cast<size_t>(strtoul(value, NULL, 10));
+}
+
+// ============================================================================
+// File names
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+bool contains_pattern(const string &str)
+{
+  const char *p = str.c_str();
+  while ((p = strchr(p, '%')) && ++p) {
+    while ('0' <= *p && *p <= '9') ++p;
+    if (*p == 'd') return true;
+  }
+  return false;
+}
+
+// ----------------------------------------------------------------------------
+string remove_pattern(const string &str)
+{
+  string res;
+  const char *p = str.c_str();
+  while (*p && *p != '_') res.push_back(*p++);
+  p++;
+  while ('0' <= *p && *p <= '9') p++;
+  if (*p != '.') return str;
+  return res + p;
+}
+
+// ----------------------------------------------------------------------------
+string replace_pattern(const string &str, int &b)
+{
+  string res;
+  string n;
+  const char *p = str.c_str();
+  while (*p && *p != '_') res.push_back(*p++);
+  p++;
+  while ('0' <= *p && *p <= '9') n.push_back(*p++);
+  if (!n.empty()) b = atoi(n.c_str());
+  if (*p != '.') return str;
+  char d[32];
+  snprintf(d, 32, "%lu", n.size());
+  return (res + "_%0" + d + "d") + p;
+}
+
+// ----------------------------------------------------------------------------
+string replace_extension(const string &str, const char *ext)
+{
+  string res(str);
+  size_t pos = res.rfind('.');
+  if (pos != string::npos) res.replace(pos, string::npos, ext);
+  return res;
+}
+
+// ----------------------------------------------------------------------------
+int get_frame_number(const string &str)
+{
+  string n;
+  const char *p = str.c_str();
+  while (*p && *p != '_') { p++; } p++;
+  while ('0' <= *p && *p <= '9') n.push_back(*p++);
+  return n.empty() ? 0 : atoi(n.c_str());
+}
+
+// ============================================================================
+// Input
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+Frame frame(const unsigned char *data, int width, int height, int channels, bool interleaved, bool shared)
+{
+  if (width < 1 || height < 1 || channels < 1) {
+    throw CImgArgumentException("frame(): Invalid image size %dx%dx%d", width, height, channels);
+  }
+  if (interleaved) {
+    if (channels == 1) return Frame(data, width, height, 1, 1, shared);
+    return Frame(data, channels, width, height, 1).permute_axes("yzcx");
+  }
+  return Frame(data, width, height, 1, channels, shared);
+}
+
+// ----------------------------------------------------------------------------
+vector<string> frame_files(const string &fname, int fbegin, int fend, int fstride)
+{
+  vector<string> fnames;
+  char buffer[1024];
+  for (int frame = fbegin; fend < 0 || frame <= fend; frame += fstride) {
+    if (frame > 1e6) {
+      throw CImgIOException("Too many input frames...!");
+    }
+    snprintf(buffer, 1024, fname.c_str(), frame);
+    FILE *tmp = fopen(buffer, "r");
+    if (!tmp) {
+      if (frame > fbegin && fend < 0) break;
+      throw CImgIOException("Cannot read frame %d of image sequence."
+                            " Expected to find it in file %s!", frame, buffer);
+    }
+    fclose(tmp);
+    fnames.push_back(buffer);
+  }
+  return fnames;
+}
+
+// ----------------------------------------------------------------------------
+void read_sequence(Sequence &seq, const string &fname, int fbegin, int fend, int fstride)
+{
+  if (contains_pattern(fname)) {
+    const vector<string> fnames = frame_files(fname, fbegin, fend, fstride);
+    const unsigned int n = static_cast<unsigned int>(fnames.size());
+    if (seq.size() < n) seq.insert(n - seq.size());
+    if (seq.size() > n) seq.remove(n, seq.size() - 1);
+    for (unsigned int i = 0; i < n; ++i) seq[i].load(fnames[i].c_str());
+  } else {
+    seq.assign(fname.c_str());
+  }
+}
+
+// ----------------------------------------------------------------------------
+Sequence read_sequence(const string &fname, int fbegin, int fend, int fstride)
+{
+  Sequence seq;
+  read_sequence(seq, fname, fbegin, fend, fstride);
+  return seq;
+}
+
+// ----------------------------------------------------------------------------
+void read_sequence(Sequence &seq, FramePool &pool, const string &fname, int fbegin, int fend, int fstride)
+{
+  if (contains_pattern(fname)) {
+    const vector<string> fnames = frame_files(fname, fbegin, fend, fstride);
+    const unsigned int n = static_cast<unsigned int>(fnames.size());
+    if (seq.size() > n) {
+      for (unsigned int i = n; i < seq.size(); ++i) pool.release(seq[i]);
+      seq.remove(n, seq.size() - 1);
+    }
+    if (seq.size() < n) seq.insert(n - seq.size());
+    for (unsigned int i = 0; i < n; ++i) pool.load(seq[i], fnames[i].c_str());
+  } else {
+    pool.release(seq);
+    seq.assign(fname.c_str());
+  }
+}
+
+// ----------------------------------------------------------------------------
+void read_stack(Sequence &seq, FramePool &pool, const string &fname, int fbegin, int fend, int fstride)
+{
+  if (!contains_pattern(fname)) {
+    read_sequence(seq, pool, fname, fbegin, fend, fstride);
+    return;
+  }
+  const vector<string> fnames = frame_files(fname, fbegin, fend, fstride);
+  const int n = static_cast<int>(fnames.size());
+  pool.release(seq);
+  if (n == 0) {
+    seq.assign();
+    return;
+  }
+  // Size of stack is given by first frame
+  if (seq.size() < 1) seq.insert(1);
+  pool.load(seq[0], fnames[0].c_str());
+  FrameStack &stack = pool.stack();
+  stack.assign(seq[0].width(), seq[0].height(), seq[0].spectrum(), n);
+  memcpy(stack.data(0), seq[0].data(), stack.frame_size());
+  pool.release(seq[0]);
+  stack.view(seq);
+  // Decode other frames in place
+  for (int i = 1; i < n; ++i) {
+    pool.load(seq[i], fnames[i].c_str());
+    if (seq[i].data() != stack.data(i) || seq[i].width()    != stack.width() ||
+        seq[i].height()   != stack.height() || seq[i].spectrum() != stack.channels()) {
+      throw CImgIOException("Frame %s differs in size from first frame of image sequence!", fnames[i].c_str());
+    }
+  }
+}
+
+// ============================================================================
+// Crop regions
+// ============================================================================
+
+/// Number of rows of the bands into which a frame is split for analysis
+static const int BAND_ROWS = 64;
+
+// ----------------------------------------------------------------------------
+/// Enlarge bounding box such that it contains another box
+static void extend(BoundingBox &u, const BoundingBox &b)
+{
+  u.x0 = cimg::min(u.x0, b.x0);
+  u.x1 = cimg::max(u.x1, b.x1);
+  u.y0 = cimg::min(u.y0, b.y0);
+  u.y1 = cimg::max(u.y1, b.y1);
+}
+
+// ----------------------------------------------------------------------------
+/// Enlarge bounding box by the pixels of rows [y0, y1] which differ from the
+/// background color in any channel
+///
+/// Each row is scanned from the left and from the right up to its outermost
+/// pixels which differ from the background, channel by channel.
+static void extend(BoundingBox &b, const Frame &frame, const unsigned char *bg, int y0, int y1)
+{
+  const int w = frame.width();
+  for (int y = y0; y <= y1; ++y) {
+    int l = w, r = -1;
+    for (int c = 0; c < frame.spectrum(); ++c) {
+      const unsigned char *p = frame.data(0, y, 0, c);
+      const unsigned char  v = bg[c];
+      for (int x = 0;     x < l; ++x) if (p[x] != v) { l = x; break; }
+      for (int x = w - 1; x > r; --x) if (p[x] != v) { r = x; break; }
+    }
+    if (l <= r) {
+      if (l < b.x0) b.x0 = l;
+      if (r > b.x1) b.x1 = r;
+      if (y < b.y0) b.y0 = y;
+      b.y1 = y;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+BoundingBox analyze(const Frame &frame)
+{
+  BoundingBox box;
+  if (frame.depth() > 1 || frame.spectrum() > 16) {
+    const CImg<int> bb = frame.get_autocrop_region(0, "yx");
+    box = BoundingBox(bb(0,0), bb(1,0), bb(0,1), bb(1,1));
+  } else if (!frame.is_empty()) {
+    // Same background color as CImg::get_autocrop_region(), whose fallback to
+    // the color of the last pixel never applies when the z axis is excluded
+    unsigned char bg[16];
+    for (int c = 0; c < frame.spectrum(); ++c) bg[c] = frame(0, 0, 0, c);
+    // Bands of rows are analyzed by multiple threads for large frames
+    const int h = frame.height(), bands = (h + BAND_ROWS - 1) / BAND_ROWS;
+    BoundingBox u(frame.width(), h, -1, -1);
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic) if (frame.size() >= parallel_frame_size())
+#endif
+    for (int band = 0; band < bands; ++band) {
+      BoundingBox v(frame.width(), h, -1, -1);
+      extend(v, frame, bg, band * BAND_ROWS, cimg::min(h, (band + 1) * BAND_ROWS) - 1);
+      if (v.x1 >= 0) {
+#ifdef cimg_use_openmp
+#pragma omp critical
+#endif
+        extend(u, v);
+      }
+    }
+    if (u.x1 >= 0) box = u;
+  }
+  // Ensure that center is well defined
+  box.x1 += (box.x1 - box.x0 + 1) % 2;
+  box.y1 += (box.y1 - box.y0 + 1) % 2;
+  return box;
+}
+
+// ----------------------------------------------------------------------------
+BoundingBoxes analyze(const Sequence &frames)
+{
+  BoundingBoxes boxes(frames.size());
+  // A single frame is analyzed by multiple threads instead if large enough
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic) if (frames.size() > 1)
+#endif
+  cimglist_for(frames,frame) {
+    boxes[frame] = analyze(frames[frame]);
+  }
+  return boxes;
+}
+
+// ----------------------------------------------------------------------------
+/// Whether any pixel of a region differs from the background color
+static bool contains_foreground(const Frame &frame, const unsigned char *bg, int x0, int y0, int x1, int y1)
+{
+  for (int y = y0; y <= y1; ++y) {
+    for (int c = 0; c < frame.spectrum(); ++c) {
+      const unsigned char *p = frame.data(x0, y, 0, c);
+      const unsigned char  v = bg[c];
+      for (int n = x1 - x0 + 1; n > 0; --n, ++p) {
+        if (*p != v) return true;
+      }
+    }
+  }
+  return false;
+}
+
+// ----------------------------------------------------------------------------
+/// Enlarge union by the bounding box of a frame
+///
+/// Like CImg::get_autocrop_region() as used by analyze(), the background color
+/// is the color of the first pixel. The box of a frame whose foreground pixels
+/// lie inside [u.x0, u.x1 - 1] x [u.y0, u.y1 - 1] is contained in the union
+/// even after it was enlarged by analyze(). Hence, only the pixels outside
+/// this region need to be scanned. The box of an empty frame is (0, 0, -1, -1).
+static void extend(BoundingBox &u, const Frame &frame)
+{
+  const int w = frame.width(), h = frame.height();
+  const int x0 = u.x0, x1 = cimg::min(u.x1 - 1, w - 1);
+  const int y0 = u.y0, y1 = cimg::min(u.y1 - 1, h - 1);
+  unsigned char bg[16];
+  if (frame.is_empty() || frame.depth() > 1 || frame.spectrum() > 16 || x0 > x1 || y0 > y1) {
+    extend(u, analyze(frame));
+    return;
+  }
+  for (int c = 0; c < frame.spectrum(); ++c) bg[c] = frame(0, 0, 0, c);
+  if ((y0 > 0     && contains_foreground(frame, bg, 0,      0,      w - 1,  y0 - 1)) ||
+      (y1 < h - 1 && contains_foreground(frame, bg, 0,      y1 + 1, w - 1,  h - 1))  ||
+      (x0 > 0     && contains_foreground(frame, bg, 0,      y0,     x0 - 1, y1))     ||
+      (x1 < w - 1 && contains_foreground(frame, bg, x1 + 1, y0,     w - 1,  y1))) {
+    extend(u, analyze(frame));
+  } else if ((u.x0 > 0 || u.y0 > 0) && !contains_foreground(frame, bg, x0, y0, x1, y1)) {
+    extend(u, BoundingBox(0, 0, -1, -1));
+  }
+}
+
+// ----------------------------------------------------------------------------
+BoundingBox analyze_union(const Sequence &frames)
+{
+  if (frames.is_empty()) return BoundingBox();
+  const int w = frames.front().width();
+  const int h = frames.front().height();
+  BoundingBox u(w, h, -1, -1);
+#ifdef cimg_use_openmp
+#pragma omp parallel
+#endif
+  {
+    // Each thread determines the union of its frames
+    BoundingBox v(w, h, -1, -1);
+#ifdef cimg_use_openmp
+#pragma omp for schedule(dynamic)
+#endif
+    cimglist_for(frames,frame) {
+      extend(v, frames[frame]);
+    }
+#ifdef cimg_use_openmp
+#pragma omp critical
+#endif
+    extend(u, v);
+  }
+  return u;
+}
+
+// ----------------------------------------------------------------------------
+/// Union of the non-empty bounding boxes of frames [begin, end)
+static bool segment_union(const BoundingBoxes &boxes, int begin, int end, BoundingBox &u)
+{
+  bool empty = true;
+  for (int i = begin; i < end; ++i) {
+    const BoundingBox &b = boxes[i];
+    if (b.x1 < b.x0 || b.y1 < b.y0) continue;
+    if (empty) u = b, empty = false;
+    else       extend(u, b);
+  }
+  return !empty;
+}
+
+// ----------------------------------------------------------------------------
+/// Partition frames into segments cropped using the union of their bounding boxes
+///
+/// The minimum cost of frames [0, j) is the minimum over i of the cost of
+/// frames [0, i) plus the pixels of segment [i, j) and the cost of a segment.
+/// As the pixels of the segment only grow with decreasing i and the costs of
+/// the frames before are not negative, the search stops as soon as the
+/// segment alone costs at least as much as the best partition found.
+static void segment(BoundingBoxes &boxes, double cost)
+{
+  const int      n = int(boxes.size());
+  vector<double> best (n + 1, 0.);
+  vector<int>    begin(n + 1, 0);
+  for (int j = 1; j <= n; ++j) {
+    BoundingBox u;
+    bool        empty = true;
+    best[j] = numeric_limits<double>::max();
+    for (int i = j - 1; i >= 0; --i) {
+      const BoundingBox &b = boxes[i];
+      if (b.x0 <= b.x1 && b.y0 <= b.y1) {
+        if (empty) u = b, empty = false;
+        else       extend(u, b);
+      }
+      const double c = (empty ? 0. : double(u.width()) * u.height() * (j - i)) + cost;
+      if (best[i] + c < best[j]) {
+        best [j] = best[i] + c;
+        begin[j] = i;
+      }
+      if (c >= best[j]) break;
+    }
+  }
+  for (int j = n; j > 0; j = begin[j]) {
+    BoundingBox u;
+    if (segment_union(boxes, begin[j], j, u)) {
+      for (int i = begin[j]; i < j; ++i) boxes[i] = u;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+BoundingBox adjust(BoundingBoxes &boxes, CropMode mode, int w, int h, double cost)
+{
+  BoundingBox u(w, h, -1, -1);
+  for (size_t frame = 0; frame < boxes.size(); ++frame) extend(u, boxes[frame]);
+  if (mode == CROP_UNION) {
+    for (size_t frame = 0; frame < boxes.size(); ++frame) boxes[frame] = u;
+  } else if (mode == CROP_FIXED) {
+    int fx = 0;
+    int fy = 0;
+    for (size_t frame = 0; frame < boxes.size(); ++frame) {
+      fx = cimg::max(fx, boxes[frame].width());
+      fy = cimg::max(fy, boxes[frame].height());
+    }
+    for (size_t frame = 0; frame < boxes.size(); ++frame) {
+      BoundingBox &b = boxes[frame];
+      const int sx = b.x1 - b.x0;
+      const int sy = b.y1 - b.y0;
+      b.x0 -= (fx - sx)     / 2;
+      b.x1 += (fx - sx + 1) / 2;
+      b.y0 -= (fy - sy)     / 2;
+      b.y1 += (fy - sy + 1) / 2;
+    }
+  } else if (mode == CROP_SEGMENTED) {
+    segment(boxes, cost);
+  }
+  return u;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+void crop(Sequence &frames, const BoundingBoxes &boxes, bool bleed)
+{
+  if (boxes.size() != frames.size()) {
+    throw CImgArgumentException("crop(): Number of bounding boxes (%u) does not match number of frames (%u)",
+                                (unsigned int)boxes.size(), frames.size());
+  }
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    const BoundingBox &b = boxes[frame];
+    frames[frame].crop(b.x0, b.y0, b.x1, b.y1);
+    if (bleed) animtk::bleed(frames[frame]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Whether crop region lies inside frame which shares pooled memory, such that
+/// the frame is cropped without modifying the pool
+static bool inside(const Frame &frame, const BoundingBox &b, const FramePool &pool)
+{
+  return pool.capacity(frame) > 0 && frame.depth() == 1 &&
+         0 <= b.x0 && b.x0 <= b.x1 && b.x1 < frame.width() &&
+         0 <= b.y0 && b.y0 <= b.y1 && b.y1 < frame.height();
+}
+
+// ----------------------------------------------------------------------------
+void crop(Sequence &frames, const BoundingBoxes &boxes, FramePool &pool, bool bleed)
+{
+  if (boxes.size() != frames.size()) {
+    throw CImgArgumentException("crop(): Number of bounding boxes (%u) does not match number of frames (%u)",
+                                (unsigned int)boxes.size(), frames.size());
+  }
+  // Frames whose crop region lies inside the frame are cropped in parallel,
+  // the others need the scratch memory of the pool. These are cropped after
+  // the parallel loop, because the pool is not modified by any thread as long
+  // as it is looked up by the others. A single frame is cropped by multiple
+  // threads instead if large enough.
+  vector<char> in(frames.size());
+  cimglist_for(frames,frame) in[frame] = inside(frames[frame], boxes[frame], pool);
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic) if (frames.size() > 1)
+#endif
+  cimglist_for(frames,frame) {
+    if (in[frame]) pool.crop(frames[frame], boxes[frame]);
+  }
+  cimglist_for(frames,frame) {
+    if (!in[frame]) pool.crop(frames[frame], boxes[frame]);
+  }
+  if (bleed) {
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic) if (frames.size() > 1)
+#endif
+    cimglist_for(frames,frame) animtk::bleed(frames[frame]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void write_sequence(const Sequence &frames, const char *fname, FramePool &pool)
+{
+  // Same file names as CImgList::save()
+  if (cimg::strcasecmp(cimg::split_filename(fname), "png") != 0) {
+    frames.save(fname);
+  } else if (frames.size() == 1) {
+    pool.save(frames[0], fname);
+  } else {
+    char ofname[1024];
+    cimglist_for(frames,frame) {
+      cimg::number_filename(fname, frame, 6, ofname);
+      pool.save(frames[frame], ofname);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+void crop_and_write(Sequence &frames, const BoundingBoxes &boxes, const char *fname)
+{
+  crop(frames, boxes);
+  frames.save(fname);
+}
+
+// ----------------------------------------------------------------------------
+void crop_and_write(Sequence &frames, const BoundingBoxes &boxes, const char *fname, FramePool &pool)
+{
+  crop(frames, boxes, pool);
+  write_sequence(frames, fname, pool);
+}
+
+// ----------------------------------------------------------------------------
+void write_csv_header(FILE *fp)
+{
+  fprintf(fp, " frame,     iw,     ih,     ow,     oh,     cx,     cy,     dx,     dy,     x0,     y0,     x1,     y1\n");
+}
+
+// ----------------------------------------------------------------------------
+void write_csv_row(FILE *fp, int frame, const BoundingBox &b, int w, int h, const BoundingBox *prev)
+{
+  const int cx = b.cx();
+  const int cy = b.cy();
+  const int dx = prev ? (cx - prev->cx()) : 0;
+  const int dy = prev ? (cy - prev->cy()) : 0;
+  fprintf(fp, "%6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d\n",
+              frame, w, h, b.width(), b.height(), cx, cy, dx, dy, b.x0, b.y0, b.x1, b.y1);
+}
+
+// ----------------------------------------------------------------------------
+void write_csv(FILE *fp, const BoundingBoxes &boxes, int w, int h, int fbegin, int fstride)
+{
+  for (size_t frame = 0; frame < boxes.size(); ++frame) {
+    write_csv_row(fp, fbegin + int(frame) * fstride, boxes[frame], w, h, frame > 0 ? &boxes[frame - 1] : NULL);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void write_csv(const char *fname, const BoundingBoxes &boxes, int w, int h, int fbegin, int fstride, bool append)
+{
+  FILE *csv = NULL;
+  if (append) {
+    csv = fopen(fname, "r");
+    if (csv) {
+      fclose(csv);
+      csv = fopen(fname, "a");
+    }
+  }
+  if (!csv) {
+    csv = fopen(fname, "w");
+    if (csv) write_csv_header(csv);
+  }
+  if (!csv) {
+    throw CImgIOException("Failed to open spreadsheet file %s!", fname);
+  }
+  write_csv(csv, boxes, w, h, fbegin, fstride);
+  fclose(csv);
+}
+
+// ============================================================================
+// Jobs
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+string validate(const Job &job)
+{
+  char msg[256] = "";
+  TextureFormat format;
+  if (job.input.empty() || job.output.empty()) {
+    snprintf(msg, 256, "No input or output image sequence specified!");
+  } else if (job.fbegin < 0) {
+    snprintf(msg, 256, "Invalid frame start index (-b): %d", job.fbegin);
+  } else if (job.fstride < 1) {
+    snprintf(msg, 256, "Invalid frame index increment (-s): %d", job.fstride);
+  } else if (!job.delta.empty() && (!job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --delta cannot be combined with --cache or --checkpoint!");
+  } else if (job.keyframes < 0) {
+    snprintf(msg, 256, "Invalid keyframe interval (--keyframes): %d", job.keyframes);
+  } else if (job.regions && (job.mode != CROP_TIGHT || !job.delta.empty() || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --regions requires separate output images and cannot be combined with -u, -f, --delta, --cache, or --checkpoint!");
+  } else if (job.gap < 0) {
+    snprintf(msg, 256, "Invalid distance of parts (--gap): %d", job.gap);
+  } else if (!job.hull.empty() && (job.regions || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --hull cannot be combined with --regions, --cache, or --checkpoint!");
+  } else if (job.vertices < 3) {
+    snprintf(msg, 256, "Invalid number of vertices (--vertices): %d", job.vertices);
+  } else if (!job.scales.empty() && (job.regions || !job.delta.empty() || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --scales cannot be combined with --regions, --delta, --cache, or --checkpoint!");
+  } else if (!job.texture.empty() && !parse_texture_format(job.texture, format)) {
+    snprintf(msg, 256, "Invalid texture format (--texture): %s, must be bc1, bc3, or bc7", job.texture.c_str());
+  } else if (!texture_format(job).empty() && (!is_dds(job.output) || job.regions || !job.delta.empty() || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --texture requires DDS output (-o *.dds) and cannot be combined with --regions, --delta, --cache, or --checkpoint!");
+  } else if (snap_size(job) == 0) {
+    snprintf(msg, 256, "Invalid scales (--scales): %s, must be positive multiples of 1/%d", format_scales(job.scales).c_str(),
+             MAX_SNAP_SIZE / (texture_format(job).empty() ? 1 : TEXTURE_BLOCK_SIZE));
+  } else if (job.colors != 0 && (job.colors < 2 || job.colors > MAX_PALETTE_COLORS)) {
+    snprintf(msg, 256, "Invalid number of colors (--colors): %d, must be between 2 and %d", job.colors, MAX_PALETTE_COLORS);
+  } else if (job.colors != 0 && (!is_png(job.output) || job.regions || !job.delta.empty() || !texture_format(job).empty() ||
+                                 !job.scales.empty() || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --colors requires PNG output (-o *.png) and cannot be combined with --regions, --delta, --texture, --scales, --cache, or --checkpoint!");
+  } else if (!job.masks.empty() && (job.append || job.regions || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --masks cannot be combined with -a, --regions, --cache, or --checkpoint!");
+  } else if (job.threshold < 0 || job.threshold > 254) {
+    snprintf(msg, 256, "Invalid alpha threshold (--threshold): %d, must be between 0 and 254", job.threshold);
+  } else if (job.bleed < 0) {
+    snprintf(msg, 256, "Invalid padding of color bleeding (--bleed): %d", job.bleed);
+  } else if (job.bleed > 0 && (job.regions || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --bleed cannot be combined with --regions, --cache, or --checkpoint!");
+  } else if (job.tilesize < 1) {
+    snprintf(msg, 256, "Invalid tile size (--tilesize): %d", job.tilesize);
+  } else if (!job.tiles.empty() && (job.append || job.regions || !job.delta.empty() || !texture_format(job).empty() || job.colors != 0 ||
+                                    !job.scales.empty() || !job.cache.empty() || !job.checkpoint.empty())) {
+    snprintf(msg, 256, "Option --tiles cannot be combined with -a, --regions, --delta, --texture, --colors, --scales, --cache, or --checkpoint!");
+  } else if (job.segments < 0) {
+    snprintf(msg, 256, "Invalid cost of segments (--segments): %d", job.segments);
+  } else if (job.segments > 0 && job.mode != CROP_SEGMENTED) {
+    snprintf(msg, 256, "Option --segments cannot be combined with -u, -f, or output formats which store all frames in one file!");
+  } else if (job.segments == 0 && job.mode == CROP_SEGMENTED) {
+    snprintf(msg, 256, "Missing cost of segments (--segments) of segmented crop mode!");
+  }
+  return msg;
+}
+
+// ----------------------------------------------------------------------------
+const char *extra_option(const Job &job)
+{
+  if (!job.cache.empty())           return "--cache";
+  if (!job.checkpoint.empty())      return "--checkpoint";
+  if (job.stack)                    return "--stack";
+  if (!job.delta.empty())           return "--delta";
+  if (job.regions)                  return "--regions";
+  if (!job.hull.empty())            return "--hull";
+  if (!job.scales.empty())          return "--scales";
+  if (!texture_format(job).empty()) return "--texture";
+  if (job.colors != 0)              return "--colors";
+  if (!job.masks.empty())           return "--masks";
+  if (job.bleed != 0)               return "--bleed";
+  if (!job.tiles.empty())           return "--tiles";
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+static unsigned long file_size(const char *fname)
+{
+  struct stat info;
+  if (stat(fname, &info) != 0) return 0;
+  return static_cast<unsigned long>(info.st_size);
+}
+
+// ----------------------------------------------------------------------------
+unsigned long estimate_size(const Job &job)
+{
+  if (!contains_pattern(job.input)) return file_size(job.input.c_str());
+  unsigned long size = 0;
+  char buffer[1024];
+  for (int frame = job.fbegin; (job.fend < 0 || frame <= job.fend) && frame <= 1e6; frame += job.fstride) {
+    snprintf(buffer, 1024, job.input.c_str(), frame);
+    const unsigned long n = file_size(buffer);
+    if (n == 0 && frame > job.fbegin && job.fend < 0) break;
+    size += n;
+  }
+  return size;
+}
+
+// ----------------------------------------------------------------------------
+/// Report crop regions of all frames as written
+static void report(Progress *progress, const BoundingBoxes &boxes)
+{
+  if (progress) {
+    for (size_t i = 0; i < boxes.size(); ++i) progress->written(int(i), boxes[i]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Write cropped frames of job, their compressed textures, indexed colors, tiles, or delta rectangles
+///
+/// Cropped frames which are written to separate files are reported one by
+/// one, the frames of other outputs once the output was written.
+static void write_output(const Job &job, const Sequence &seq, const BoundingBoxes &boxes,
+                         FramePool &pool, Progress *progress)
+{
+  TextureFormat format;
+  if (parse_texture_format(texture_format(job), format)) {
+    write_textures(seq, job.output.c_str(), format, job.hq);
+  } else if (job.colors > 0) {
+    write_indexed(seq, build_palette(seq, job.colors), job.output.c_str(), pool);
+  } else if (!job.tiles.empty()) {
+    Sequence       tiles, atlas(1);
+    const TileMaps maps = tile_maps(seq, job.tilesize, tiles);
+    tile_atlas(tiles, job.tilesize).move_to(atlas[0]);
+    write_sequence(atlas, job.output.c_str(), pool);
+    write_tiles_csv(job.tiles.c_str(), maps, job.fbegin, job.fstride);
+  } else if (!job.delta.empty()) {
+    const DeltaRects rects = delta_rects(seq, job.keyframes);
+    write_delta(seq, rects, job.output.c_str(), pool);
+    write_delta_csv(job.delta.c_str(), rects, job.fbegin, job.fstride);
+  } else if (progress && seq.size() > 1 && !CImgList<>::is_saveable(job.output.c_str())) {
+    // Same file names as write_sequence()
+    char fname[1024];
+    cimglist_for(seq, frame) {
+      cimg::number_filename(job.output.c_str(), frame, 6, fname);
+      write_sequence(Sequence(seq[frame], true), fname, pool);
+      progress->written(frame, boxes[frame]);
+    }
+    return;
+  } else {
+    write_sequence(seq, job.output.c_str(), pool);
+  }
+  report(progress, boxes);
+}
+
+// ----------------------------------------------------------------------------
+/// Write separate parts of the frames of job (see find_regions())
+static int process_regions(const Job &job, const Sequence &seq, FramePool &pool, BoundingBoxes *boxes, Progress *progress)
+{
+  const FrameRegions regions = find_regions(seq, job.gap);
+  write_regions(seq, regions, job.output.c_str(), pool);
+  if (progress) {
+    for (size_t i = 0; i < regions.size(); ++i)
+    for (size_t j = 0; j < regions[i].size(); ++j) {
+      progress->written(int(i), regions[i][j]);
+    }
+  }
+  if (!job.csv.empty()) {
+    write_regions_csv(job.csv.c_str(), regions, seq.front().width(), seq.front().height(),
+                      job.fbegin, job.fstride, job.append);
+  }
+  if (boxes) {
+    boxes->clear();
+    for (size_t i = 0; i < regions.size(); ++i) boxes->insert(boxes->end(), regions[i].begin(), regions[i].end());
+  }
+  return int(seq.size());
+}
+
+// ----------------------------------------------------------------------------
+/// Read input frames of crop job into buffers of their own
+static void read_plain(const Job &job, Sequence &seq, FramePool *)
+{
+  read_sequence(seq, job.input, job.fbegin, job.fend, job.fstride);
+}
+
+// ----------------------------------------------------------------------------
+/// Read input frames of crop job into pooled buffers
+static void read_pooled(const Job &job, Sequence &seq, FramePool *pool)
+{
+  if (job.stack || code_path("ANIMTK_STACK")) read_stack   (seq, *pool, job.input, job.fbegin, job.fend, job.fstride);
+  else                                        read_sequence(seq, *pool, job.input, job.fbegin, job.fend, job.fstride);
+}
+
+// ----------------------------------------------------------------------------
+/// Read, crop, and write the frames of a crop job
+///
+/// \param[in] pool Frame buffer pool shared by the frames read by \p read,
+///                 or \c NULL if these own their buffers.
+/// \param[in] read Function which reads the input frames.
+static int process_frames(const Job &job, Sequence &seq, FramePool *pool,
+                          void (*read)(const Job &, Sequence &, FramePool *),
+                          BoundingBoxes *boxes, JobStats *stats, Progress *progress)
+{
+  read(job, seq, pool);
+  if (seq.is_empty()) {
+    throw CImgIOException("Input image sequence %s is empty!", job.input.c_str());
+  }
+  const int w = seq.front().width();
+  const int h = seq.front().height();
+  if (stats) {
+    stats->frames   = stats->analyzed = stats->written = int(seq.size());
+    stats->width    = w;
+    stats->height   = h;
+  }
+  if (job.regions) {
+    if (pool) return process_regions(job, seq, *pool, boxes, progress);
+    FramePool scratch;
+    return process_regions(job, seq, scratch, boxes, progress);
+  }
+  // The union of all frames is found without the box of each frame unless the latter is requested
+  BoundingBoxes bb = job.mode == CROP_UNION && !stats && !code_path("ANIMTK_ANALYZE_FRAMES")
+                   ? BoundingBoxes(seq.size(), analyze_union(seq)) : analyze(seq);
+  if (stats) stats->tight = bb;
+  adjust(bb, job.mode, w, h, job.segments);
+  if (job.bleed > 0) pad(bb, job.bleed);
+  const int size = snap_size(job);
+  if (size > 1) snap(bb, size, job.mode);
+  Polygons hulls;
+  if (!job.hull.empty()) hulls = convex_hulls(seq, bb, job.vertices);
+  if (pool) {
+    crop(seq, bb, *pool, job.bleed > 0);
+    write_output(job, seq, bb, *pool, progress);
+    write_scales(job, seq, bb, w, h, *pool);
+  } else if (!progress && job.delta.empty() && job.scales.empty() && texture_format(job).empty() && job.colors == 0 &&
+             job.bleed == 0 && job.tiles.empty()) {
+    crop_and_write(seq, bb, job.output.c_str());
+  } else {
+    FramePool scratch;
+    crop(seq, bb, job.bleed > 0);
+    write_output(job, seq, bb, scratch, progress);
+    write_scales(job, seq, bb, w, h, scratch);
+  }
+  if (!job.csv.empty()) {
+    write_csv(job.csv.c_str(), bb, w, h, job.fbegin, job.fstride, job.append);
+  }
+  if (!job.hull.empty()) {
+    write_hulls(job.hull.c_str(), hulls, job.fbegin, job.fstride, job.append);
+  }
+  if (!job.masks.empty()) {
+    write_masks(job.masks.c_str(), seq, bb, job.threshold);
+  }
+  if (boxes) boxes->swap(bb);
+  return int(seq.size());
+}
+
+// ----------------------------------------------------------------------------
+int process(const Job &job, Sequence &seq, BoundingBoxes *boxes, JobStats *stats, Progress *progress)
+{
+  if (!job.checkpoint.empty() && contains_pattern(job.input)) {
+    return process_checkpointed(job, seq, boxes, stats, progress);
+  }
+  if (!job.cache.empty() && contains_pattern(job.input)) {
+    return process_cached(job, seq, boxes, stats, progress);
+  }
+  return process_frames(job, seq, NULL, read_plain, boxes, stats, progress);
+}
+
+// ----------------------------------------------------------------------------
+int process(const Job &job, Sequence &seq, FramePool &pool, BoundingBoxes *boxes, JobStats *stats, Progress *progress)
+{
+  if ((!job.checkpoint.empty() || !job.cache.empty()) && contains_pattern(job.input)) {
+    pool.release(seq);
+    return process(job, seq, boxes, stats, progress);
+  }
+  return process_frames(job, seq, &pool, read_pooled, boxes, stats, progress);
+}
+
+// ----------------------------------------------------------------------------
+int process(const Job &job)
+{
+  FramePool pool;
+  Sequence  seq;
+  return process(job, seq, pool);
+}
+
+// ----------------------------------------------------------------------------
+/// Compare jobs by estimated size for largest first scheduling
+struct LargerJob
+{
+  const vector<unsigned long> &size;
+  LargerJob(const vector<unsigned long> &size) : size(size) {}
+  bool operator ()(int a, int b) const { return size[a] > size[b]; }
+};
+
+// ----------------------------------------------------------------------------
+int process(const vector<Job> &jobs, vector<string> &errors)
+{
+  const int n = int(jobs.size());
+  errors.assign(jobs.size(), string());
+  // Schedule largest jobs first
+  vector<unsigned long> size(jobs.size());
+  vector<int>           order(jobs.size());
+  for (int i = 0; i < n; ++i) {
+    size [i] = estimate_size(jobs[i]);
+    order[i] = i;
+  }
+  stable_sort(order.begin(), order.end(), LargerJob(size));
+  // Process jobs, each worker reusing its frame buffers
+  int nfailed = 0;
+#ifdef cimg_use_openmp
+#pragma omp parallel reduction(+:nfailed)
+#endif
+  {
+    FramePool pool;
+    Sequence  seq;
+#ifdef cimg_use_openmp
+#pragma omp for schedule(dynamic, 1)
+#endif
+    for (int i = 0; i < n; ++i) {
+      const int j = order[i];
+      try {
+        process(jobs[j], seq, pool);
+      } catch (const exception &err) {
+        errors[j] = err.what();
+        if (errors[j].empty()) errors[j] = "Unknown error";
+        ++nfailed;
+      }
+    }
+  }
+  return nfailed;
+}
+
+
+} // namespace animtk
@@ -0,0 +1,474 @@
+/* Library of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_H
+#define ANIMTK_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CImgInstance.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Image frame, channels are stored in separate planes (non-interleaved)
+typedef cimg_library::CImg<unsigned char> Frame;
+
+/// Image sequence, all frames are expected to have the same size
+typedef cimg_library::CImgList<unsigned char> Sequence;
+
+/// Crop region given by the inclusive minimum and maximum pixel indices
+struct BoundingBox
+{
+  int x0, y0, x1, y1;
+
+  BoundingBox() : x0(0), y0(0), x1(-1), y1(-1) {}
+  BoundingBox(int x0, int y0, int x1, int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+
+  int width () const { return x1 - x0 + 1; }
+  int height() const { return y1 - y0 + 1; }
+  int cx    () const { return (x0 + x1) / 2; }
+  int cy    () const { return (y0 + y1) / 2; }
+
+  bool operator ==(const BoundingBox &b) const
+  {
+    return x0 == b.x0 && y0 == b.y0 && x1 == b.x1 && y1 == b.y1;
+  }
+  bool operator !=(const BoundingBox &b) const { return !(*this == b); }
+};
+
+/// Crop regions of the frames of an image sequence
+typedef std::vector<BoundingBox> BoundingBoxes;
+
+/// Output scales of multi-resolution output (see scale.h)
+typedef std::vector<double> Scales;
+
+/// Pool of frame buffers (see pool.h)
+class FramePool;
+
+/// How the bounding boxes of the individual frames are adjusted
+enum CropMode
+{
+  CROP_TIGHT, ///< Crop each frame to its smallest possible bounding box.
+  CROP_UNION, ///< Crop all frames using the union of all bounding boxes.
+  CROP_FIXED, ///< Crop all frames using a fixed size bounding box.
+  CROP_SEGMENTED ///< Crop contiguous segments of frames using the union of their bounding boxes.
+};
+
+/// Minimum size of a frame in bytes from which on its rows are analyzed,
+/// cropped, and encoded by multiple threads, e.g., for single huge images
+const size_t PARALLEL_FRAME_SIZE = 4 << 20;
+
+// ============================================================================
+// Code paths
+// ============================================================================
+
+/// Whether a code path is forced by the given environment variable
+///
+/// The optimized code paths write the same output as the plain ones. The
+/// regression tests compare the output of each of the following code paths
+/// to the same expected output (see GOLDEN_TEST_VARIANTS):
+///
+/// - ANIMTK_PLAIN_IO:       CImg reads and writes all frames instead of FramePool.
+/// - ANIMTK_ANALYZE_FRAMES: Each frame is analyzed instead of using analyze_union().
+/// - ANIMTK_STACK:          The frames of all jobs are read into a FrameStack (see Job::stack).
+///
+/// \returns Whether the variable is set to a value other than "0".
+bool code_path(const char *name);
+
+/// Minimum size of a frame in bytes from which on it is processed by multiple threads
+///
+/// This is PARALLEL_FRAME_SIZE unless set by the environment variable
+/// ANIMTK_PARALLEL_FRAME_SIZE, e.g., to 1 by the regression tests, which then
+/// run the band-parallel analysis and strip-parallel PNG encoding of small frames.
+size_t parallel_frame_size();
+
+// ============================================================================
+// File names
+// ============================================================================
+
+/// Checks if given filename contains a format pattern such as in test_%05d.png
+bool contains_pattern(const std::string &str);
+
+/// Remove '_[0-9]+' pattern from string matching regular expression '*_[0-9]+\.*'
+std::string remove_pattern(const std::string &str);
+
+/// Replace '_[0-9]+' pattern from string matching regular expression '*_[0-9]+\.*'
+///
+/// \param[in]  str Filename of a frame of an image sequence.
+/// \param[out] b   Frame number of the given frame. Unmodified if none found.
+///
+/// \returns Filename with frame number replaced by a format pattern.
+std::string replace_pattern(const std::string &str, int &b);
+
+/// Replace filename extension
+std::string replace_extension(const std::string &str, const char *ext);
+
+/// Get frame number from filename matching regular expression '*_[0-9]+\.*'
+int get_frame_number(const std::string &str);
+
+// ============================================================================
+// Input
+// ============================================================================
+
+/// Create frame from pixel buffer in memory
+///
+/// \param data        Pixel data.
+/// \param width       Width of the image.
+/// \param height      Height of the image.
+/// \param channels    Number of channels, e.g., 4 for RGBA.
+/// \param interleaved Whether the channels of a pixel are stored next to
+///                    each other (RGBARGBA...) or in separate planes.
+/// \param shared      Whether the frame shares the memory of \p data instead of
+///                    creating a copy. Only possible for non-interleaved data.
+Frame frame(const unsigned char *data, int width, int height, int channels,
+            bool interleaved = true, bool shared = false);
+
+/// Get file names of the frames of an image sequence
+///
+/// \param fname   File name containing a format pattern such as frames_%05d.png.
+/// \param fbegin  Index of first frame.
+/// \param fend    Index of last frame. If negative, all frames up to the
+///                first missing file.
+/// \param fstride Increment of frame indices.
+///
+/// \throws cimg_library::CImgIOException if a frame file does not exist.
+std::vector<std::string> frame_files(const std::string &fname, int fbegin = 0, int fend = -1, int fstride = 1);
+
+/// Read image sequence
+///
+/// The frames of the given sequence are reused, i.e., their memory is only
+/// reallocated when the size of a frame changes.
+///
+/// \param[in,out] seq Image sequence.
+/// \param[in] fname   Either filename of a single image or movie file, or a filename
+///                    containing a format pattern such as frames_%05d.png.
+/// \param[in] fbegin  Index of first frame.
+/// \param[in] fend    Index of last frame. If negative, frames are read until the
+///                    first missing file.
+/// \param[in] fstride Increment of frame indices.
+///
+/// \throws cimg_library::CImgIOException if a frame could not be read.
+void read_sequence(Sequence &seq, const std::string &fname, int fbegin = 0, int fend = -1, int fstride = 1);
+
+/// Read image sequence
+///
+/// \param fname   Either filename of a single image or movie file, or a filename
+///                containing a format pattern such as frames_%05d.png.
+/// \param fbegin  Index of first frame.
+/// \param fend    Index of last frame. If negative, frames are read until the
+///                first missing file.
+/// \param fstride Increment of frame indices.
+///
+/// \throws cimg_library::CImgIOException if a frame could not be read.
+Sequence read_sequence(const std::string &fname, int fbegin = 0, int fend = -1, int fstride = 1);
+
+/// Read image sequence into the buffers of a frame pool
+///
+/// The frames of a sequence given by a file name pattern are decoded into
+/// pooled buffers (see FramePool::load()). Other sequences are read by CImg.
+/// The frames must not be used after the pool was destroyed.
+///
+/// \throws cimg_library::CImgIOException if a frame could not be read.
+void read_sequence(Sequence &seq, FramePool &pool, const std::string &fname,
+                   int fbegin = 0, int fend = -1, int fstride = 1);
+
+/// Read image sequence into one contiguous block of memory
+///
+/// The frames of a sequence given by a file name pattern are decoded into
+/// the FrameStack of the pool, whose frames are shared by the frames of the
+/// sequence. Other sequences are read as by read_sequence().
+///
+/// \throws cimg_library::CImgIOException if a frame could not be read or
+///         its size differs from the size of the first frame.
+void read_stack(Sequence &seq, FramePool &pool, const std::string &fname,
+                int fbegin = 0, int fend = -1, int fstride = 1);
+
+// ============================================================================
+// Crop regions
+// ============================================================================
+
+/// Determine bounding box of a single frame
+///
+/// The background color is the color of the first pixel. The box is
+/// enlarged by one pixel if needed such that its center is well defined.
+BoundingBox analyze(const Frame &frame);
+
+/// Determine bounding boxes of all frames of an image sequence
+BoundingBoxes analyze(const Sequence &frames);
+
+/// Determine union of the bounding boxes of all frames of an image sequence
+///
+/// The result is identical to the union of the boxes determined by analyze(),
+/// but each frame is only scanned outside the union of the frames analyzed
+/// before. A frame is only analyzed completely if it may enlarge the union.
+BoundingBox analyze_union(const Sequence &frames);
+
+/// Adjust bounding boxes of image sequence
+///
+/// In CROP_SEGMENTED mode, the sequence is partitioned into segments of
+/// consecutive frames which are cropped using the union of their bounding
+/// boxes. The partition minimizes the total number of pixels of the cropped
+/// frames plus \p cost for each segment. It is found by dynamic programming
+/// over the end of the last segment, which only considers longer segments
+/// as long as their own pixels cost less than the best partition found so far.
+///
+/// \param[in,out] boxes Bounding boxes of the individual frames.
+/// \param[in]     mode  How the bounding boxes are adjusted.
+/// \param[in]     w     Width of the frames.
+/// \param[in]     h     Height of the frames.
+/// \param[in]     cost  Cost of each segment in pixels in CROP_SEGMENTED mode.
+///
+/// \returns Union of all bounding boxes.
+BoundingBox adjust(BoundingBoxes &boxes, CropMode mode, int w, int h, double cost = 0.);
+
+// ============================================================================
+// Output
+// ============================================================================
+
+/// Crop frames of image sequence in place
+///
+/// If \p bleed is true, the colors of the visible pixels of each cropped frame
+/// are bled into its transparent pixels by the same thread (see bleed()).
+void crop(Sequence &frames, const BoundingBoxes &boxes, bool bleed = false);
+
+/// Crop frames of image sequence in place, keeping their pooled buffers
+void crop(Sequence &frames, const BoundingBoxes &boxes, FramePool &pool, bool bleed = false);
+
+/// Write image sequence, encoding PNG frames using the memory of a frame pool
+///
+/// \throws cimg_library::CImgException if the output could not be written.
+void write_sequence(const Sequence &frames, const char *fname, FramePool &pool);
+
+/// Crop frames of image sequence and write cropped sequence
+///
+/// \throws cimg_library::CImgException if the output could not be written.
+void crop_and_write(Sequence &frames, const BoundingBoxes &boxes, const char *fname);
+
+/// Crop frames of image sequence and write cropped sequence using a frame pool
+///
+/// \throws cimg_library::CImgException if the output could not be written.
+void crop_and_write(Sequence &frames, const BoundingBoxes &boxes, const char *fname, FramePool &pool);
+
+/// Print header line of CSV spreadsheet
+void write_csv_header(FILE *fp);
+
+/// Print crop region of a single frame in CSV format
+///
+/// \param fp    Output stream.
+/// \param frame Index of frame.
+/// \param box   Crop region.
+/// \param w     Width of input frame.
+/// \param h     Height of input frame.
+/// \param prev  Crop region of previous frame, \c NULL for first frame.
+void write_csv_row(FILE *fp, int frame, const BoundingBox &box, int w, int h, const BoundingBox *prev = NULL);
+
+/// Print crop regions in CSV format
+///
+/// \param fp     Output stream.
+/// \param boxes  Crop regions.
+/// \param w      Width of input frames.
+/// \param h      Height of input frames.
+/// \param fbegin Index of first frame.
+/// \param fstride Increment of frame indices.
+void write_csv(FILE *fp, const BoundingBoxes &boxes, int w, int h, int fbegin = 0, int fstride = 1);
+
+/// Write crop regions to CSV spreadsheet
+///
+/// \param append Append rows to existing spreadsheet if file exists.
+///
+/// \throws cimg_library::CImgIOException if file could not be opened.
+void write_csv(const char *fname, const BoundingBoxes &boxes, int w, int h,
+               int fbegin = 0, int fstride = 1, bool append = false);
+
+// ============================================================================
+// Jobs
+// ============================================================================
+
+/// Crop job corresponding to a single invocation of the crop-frames tool
+struct Job
+{
+  std::string input;   ///< Input sequence, e.g., movie.mov or movie_%06d.png.
+  std::string output;  ///< Output sequence, e.g., cropped.mov or cropped.png.
+  std::string csv;     ///< Output CSV spreadsheet. Empty if none.
+  int         fbegin;  ///< Index of first frame.
+  int         fend;    ///< Index of last frame or -1.
+  int         fstride; ///< Increment of frame indices.
+  CropMode    mode;    ///< How the bounding boxes of the frames are adjusted.
+  bool        append;  ///< Append crop regions to existing spreadsheet.
+  std::string cache;   ///< Directory of analysis cache (see Cache). Empty if none.
+  std::string checkpoint; ///< Checkpoint file of progress (see Checkpoint). Empty if none.
+  bool        resume;     ///< Continue from existing checkpoint.
+  int         interval;   ///< Number of frames processed between checkpoints.
+  bool        stack;      ///< Store frames in one contiguous block (see read_stack()).
+  std::string delta;      ///< Output CSV table of delta rectangles (see delta.h). Empty if none.
+  int         keyframes;  ///< Interval of keyframes of delta output.
+  bool        regions;    ///< Crop separate parts of frames (see find_regions()).
+  int         gap;        ///< Maximum distance of parts which are cropped together.
+  std::string hull;       ///< Output CSV table of convex hulls (see hull.h). Empty if none.
+  int         vertices;   ///< Maximum number of vertices of convex hulls.
+  Scales      scales;     ///< Scales of additional resampled outputs (see write_scales()). Empty if none.
+  std::string texture;    ///< BCn compression format of DDS output, e.g., "bc3". Empty for default (see texture_format()).
+  bool        hq;         ///< Compress textures using the slower high quality preset.
+  int         colors;     ///< Number of colors of indexed PNG output (see palette.h). Zero if not indexed.
+  std::string masks;      ///< Output file of hit-test masks (see mask.h). Empty if none.
+  int         threshold;  ///< Alpha value above which pixels of hit-test masks are hit.
+  int         bleed;      ///< Padding of crop regions whose transparent pixels take the nearest colors (see bleed.h).
+  std::string tiles;      ///< Output CSV table of tile maps (see tiles.h). Empty if none.
+  int         tilesize;   ///< Width and height of tiles.
+  int         segments;   ///< Cost of each segment in pixels in CROP_SEGMENTED mode (see adjust()).
+
+  Job() : fbegin(0), fend(-1), fstride(1), mode(CROP_TIGHT), append(false), resume(false), interval(100), stack(false),
+          keyframes(30), regions(false), gap(16), vertices(8), hq(false), colors(0), threshold(0), bleed(0), tilesize(16), segments(0) {}
+};
+
+/// Statistics of a processed crop job (see process())
+struct JobStats
+{
+  int           frames;   ///< Number of frames of the input sequence.
+  int           width;    ///< Width of the input frames.
+  int           height;   ///< Height of the input frames.
+  int           analyzed; ///< Number of frames analyzed, i.e., not found in the cache or checkpoint.
+  int           written;  ///< Number of cropped frames written, i.e., not reused from the cache or checkpoint.
+  BoundingBoxes tight;    ///< Bounding boxes of the frames (see analyze()) before these were adjusted to the crop mode.
+
+  JobStats() : frames(0), width(0), height(0), analyzed(0), written(0) {}
+};
+
+/// Receiver of the crop regions of the frames of a crop job while it is processed
+///
+/// The crop region of a frame is reported once the frame was written. When the
+/// cropped frames are written to separate files, this happens frame by frame.
+/// The frames of outputs which are written at once, such as a movie file,
+/// compressed textures, indexed frames with a shared palette, a tile atlas, or
+/// delta rectangles, are reported after the output was written.
+class Progress
+{
+public:
+
+  /// Destructor
+  virtual ~Progress() {}
+
+  /// Called when a frame was written
+  ///
+  /// \param frame Index of the frame in the sequence, starting at zero.
+  /// \param box   Crop region of the frame, or of one of its parts if
+  ///              Job::regions is set.
+  virtual void written(int frame, const BoundingBox &box) = 0;
+};
+
+/// Check options of crop job
+///
+/// The same checks apply to the jobs given on the command-line, by a batch
+/// manifest, and by a request of the crop service. The messages name the
+/// corresponding options of the crop-frames tool.
+///
+/// \returns Error message or empty string if the options are valid.
+std::string validate(const Job &job);
+
+/// Option of crop job beyond cropping the frames and writing the CSV spreadsheet
+///
+/// Jobs with such options are not supported by watch(), analyze_shard(), and
+/// crop_shard(), which only crop the frames using the crop mode of the job.
+///
+/// \returns Name of the first such option of crop-frames, or \c NULL if none.
+const char *extra_option(const Job &job);
+
+/// Estimate the amount of work of a job by the size of its input files in bytes
+unsigned long estimate_size(const Job &job);
+
+/// Process crop job
+///
+/// If Job::delta is set, the delta rectangles of the cropped frames are written
+/// instead of the cropped frames (see delta_rects()). If Job::tiles is set, an
+/// atlas of the unique tiles of the cropped frames is written instead, and the
+/// tile maps of the frames to Job::tiles (see tile_maps()). If Job::regions is set,
+/// each separate part of each frame is written instead, and the crop regions
+/// of all parts are returned in order (see write_regions()). If Job::hull is
+/// set, the convex hulls of the crop regions are written as well. If
+/// Job::scales is set, the crop regions are snapped (see snap()) and the
+/// cropped frames are additionally written at each scale (see write_scales()).
+/// If the output is a DDS file, the crop regions are snapped to the pixel blocks
+/// of the texture format (see texture_format()) and the cropped frames are
+/// written as compressed textures (see write_textures()). If Job::colors is set, the cropped frames
+/// are written as indexed PNG files with a palette shared by all frames (see
+/// write_indexed()). If Job::masks is set, the hit-test masks of the cropped
+/// frames are written as well (see write_masks()). If Job::bleed is set, the
+/// crop regions are padded and the colors of the visible pixels are bled into
+/// the transparent pixels of the cropped frames (see bleed()).
+///
+/// \param[in]     job   Crop job.
+/// \param[in,out] seq   Image sequence whose frame buffers are reused.
+/// \param[out]    boxes Crop regions of the frames. Not returned if \c NULL.
+/// \param[out]    stats Statistics of the job. Not returned if \c NULL.
+/// \param[in]     progress Receiver of the crop regions of the written frames.
+///                         Not reported if \c NULL.
+///
+/// \returns Number of processed frames.
+///
+/// \throws cimg_library::CImgException if the job failed.
+int process(const Job &job, Sequence &seq, BoundingBoxes *boxes = NULL, JobStats *stats = NULL,
+            Progress *progress = NULL);
+
+/// Process crop job using the buffers of a frame pool
+///
+/// Processing a sequence of PNG frames whose size does not change allocates
+/// no memory per frame once the pool holds a buffer for each frame.
+///
+/// \param[in]     job   Crop job.
+/// \param[in,out] seq   Image sequence whose frames share the pooled buffers.
+/// \param[in,out] pool  Frame buffer pool which outlives the frames of \p seq.
+/// \param[out]    boxes Crop regions of the frames. Not returned if \c NULL.
+/// \param[out]    stats Statistics of the job. Not returned if \c NULL.
+/// \param[in]     progress Receiver of the crop regions of the written frames.
+///                         Not reported if \c NULL.
+///
+/// \returns Number of processed frames.
+///
+/// \throws cimg_library::CImgException if the job failed.
+int process(const Job &job, Sequence &seq, FramePool &pool, BoundingBoxes *boxes = NULL, JobStats *stats = NULL,
+            Progress *progress = NULL);
+
+/// Process crop job
+int process(const Job &job);
+
+/// Process many crop jobs using a shared pool of worker threads
+///
+/// The jobs are scheduled largest first (see estimate_size()), such that
+/// smaller jobs fill the gaps at the end. Each worker reuses the buffers of
+/// its own FramePool for all jobs it processes. The failure of a job does
+/// not affect the processing of the other jobs.
+///
+/// \param[in]  jobs   Crop jobs.
+/// \param[out] errors Error message of each job, empty if job succeeded.
+///
+/// \returns Number of failed jobs.
+int process(const std::vector<Job> &jobs, std::vector<std::string> &errors);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_H
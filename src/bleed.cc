@@ -0,0 +1,126 @@
+/* Color bleeding of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bleed.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Positions of the nearest visible pixels found so far
+struct Nearest
+{
+  int         w, h;   ///< Size of frame.
+  vector<int> sx, sy; ///< Position of nearest visible pixel, -1 if none.
+
+  /// Propagate nearest visible pixel of neighbor (nx, ny) to pixel (x, y)
+  void relax(int x, int y, int nx, int ny)
+  {
+    if (nx < 0 || ny < 0 || nx >= w || ny >= h) return;
+    const size_t n = size_t(ny) * w + nx;
+    if (sx[n] < 0) return;
+    const size_t i = size_t(y) * w + x;
+    if (sx[i] >= 0 && distance(x, y, sx[i], sy[i]) <= distance(x, y, sx[n], sy[n])) return;
+    sx[i] = sx[n];
+    sy[i] = sy[n];
+  }
+
+  /// Squared distance of pixels
+  static double distance(int x0, int y0, int x1, int y1)
+  {
+    const double dx = x1 - x0, dy = y1 - y0;
+    return dx * dx + dy * dy;
+  }
+};
+
+// ============================================================================
+// Color bleeding
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+void pad(BoundingBoxes &boxes, int n)
+{
+  for (size_t frame = 0; frame < boxes.size(); ++frame) {
+    BoundingBox &b = boxes[frame];
+    if (b.x1 < b.x0 || b.y1 < b.y0) continue;
+    b.x0 -= n, b.y0 -= n;
+    b.x1 += n, b.y1 += n;
+  }
+}
+
+// ----------------------------------------------------------------------------
+void bleed(Frame &frame)
+{
+  const int nc = frame.spectrum();
+  if ((nc != 2 && nc != 4) || frame.is_empty() || frame.depth() != 1) return;
+  const int            w = frame.width();
+  const int            h = frame.height();
+  const size_t         n = size_t(w) * h;
+  const unsigned char *a = frame.data(0, 0, 0, nc - 1);
+  Nearest nearest;
+  nearest.w = w;
+  nearest.h = h;
+  nearest.sx.assign(n, -1);
+  nearest.sy.assign(n, -1);
+  size_t visible = 0;
+  for (int y = 0; y < h; ++y)
+  for (int x = 0; x < w; ++x) {
+    if (a[size_t(y) * w + x]) {
+      nearest.sx[size_t(y) * w + x] = x;
+      nearest.sy[size_t(y) * w + x] = y;
+      ++visible;
+    }
+  }
+  if (visible == 0 || visible == n) return;
+  // Forward scan from top-left, then backward scan from bottom-right
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      nearest.relax(x, y, x - 1, y);
+      nearest.relax(x, y, x - 1, y - 1);
+      nearest.relax(x, y, x,     y - 1);
+      nearest.relax(x, y, x + 1, y - 1);
+    }
+    for (int x = w - 1; x >= 0; --x) nearest.relax(x, y, x + 1, y);
+  }
+  for (int y = h - 1; y >= 0; --y) {
+    for (int x = w - 1; x >= 0; --x) {
+      nearest.relax(x, y, x + 1, y);
+      nearest.relax(x, y, x + 1, y + 1);
+      nearest.relax(x, y, x,     y + 1);
+      nearest.relax(x, y, x - 1, y + 1);
+    }
+    for (int x = 0; x < w; ++x) nearest.relax(x, y, x - 1, y);
+  }
+  // Copy colors of nearest visible pixels
+  unsigned char *p = frame.data();
+  for (size_t i = 0; i < n; ++i) {
+    if (a[i]) continue;
+    const size_t j = size_t(nearest.sy[i]) * w + nearest.sx[i];
+    for (int c = 0; c < nc - 1; ++c) p[c * n + i] = p[c * n + j];
+  }
+}
+
+
+} // namespace animtk
@@ -0,0 +1,52 @@
+/* Color bleeding of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_BLEED_H
+#define ANIMTK_BLEED_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Color bleeding
+// ============================================================================
+
+/// Pad non-empty crop regions by the given number of pixels on each side
+///
+/// The padded regions may extend beyond the frames, whose pixels outside are
+/// transparent as for regions of CROP_FIXED mode.
+void pad(BoundingBoxes &boxes, int n);
+
+/// Fill transparent pixels with the color of the nearest visible pixel
+///
+/// The nearest pixel whose alpha value is not zero is found for all pixels
+/// at once by propagating the positions of the visible pixels in two raster
+/// scans (8SSEDT), which takes linear time. The alpha values are unchanged,
+/// such that bilinear filtering of the frame blends the edges of the
+/// foreground with their own colors instead of black. Frames without alpha
+/// channel or visible pixels are not modified.
+void bleed(Frame &frame);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_BLEED_H
@@ -0,0 +1,327 @@
+/* Analysis cache of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <direct.h>
+#  include <process.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "cache.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// 64-bit FNV-1a hash of file content
+///
+/// \returns Whether the file could be read.
+static bool hash_file(const char *fname, unsigned long long &h)
+{
+  FILE *fp = fopen(fname, "rb");
+  if (!fp) return false;
+  h = 14695981039346656037ULL;
+  unsigned char buffer[65536];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    for (size_t i = 0; i < n; ++i) {
+      h ^= buffer[i];
+      h *= 1099511628211ULL;
+    }
+  }
+  const bool ok = !ferror(fp);
+  fclose(fp);
+  return ok;
+}
+
+// ----------------------------------------------------------------------------
+/// Create directory including its parent directories
+static bool make_directory(const string &dir)
+{
+  struct stat info;
+  if (stat(dir.c_str(), &info) == 0) return (info.st_mode & S_IFDIR) != 0;
+  const size_t pos = dir.find_last_of("/\\");
+  if (pos != string::npos && pos > 0 && !make_directory(dir.substr(0, pos))) return false;
+#ifdef _WIN32
+  return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+#else
+  return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+/// Unique name of temporary file next to the given file
+static string temp_name(const string &fname)
+{
+  static unsigned int counter = 0;
+  unsigned int n;
+#ifdef cimg_use_openmp
+#pragma omp atomic capture
+#endif
+  n = ++counter;
+  char suffix[64];
+#ifdef _WIN32
+  snprintf(suffix, 64, ".%d-%u.tmp", _getpid(), n);
+#else
+  snprintf(suffix, 64, ".%d-%u.tmp", int(getpid()), n);
+#endif
+  return fname + suffix;
+}
+
+// ----------------------------------------------------------------------------
+/// Copy file content
+static bool copy_file(const char *src, const char *dst)
+{
+  FILE *in = fopen(src, "rb");
+  if (!in) return false;
+  FILE *out = fopen(dst, "wb");
+  if (!out) {
+    fclose(in);
+    return false;
+  }
+  char   buffer[65536];
+  size_t n;
+  bool   ok = true;
+  while (ok && (n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    ok = (fwrite(buffer, 1, n, out) == n);
+  }
+  ok = ok && !ferror(in);
+  fclose(in);
+  if (fclose(out) != 0) ok = false;
+  return ok;
+}
+
+// ----------------------------------------------------------------------------
+/// Replace file by hard link to another file, or a copy of it if linking fails
+///
+/// The destination is replaced atomically, i.e., it never contains partial data.
+static bool link_or_copy(const char *src, const char *dst)
+{
+  const string tmp = temp_name(dst);
+#ifndef _WIN32
+  if (link(src, tmp.c_str()) == 0) {
+    // If dst already is a link to src, rename() succeeds without removing tmp
+    const bool ok = (rename(tmp.c_str(), dst) == 0);
+    remove(tmp.c_str());
+    return ok;
+  }
+#else
+  remove(dst);
+#endif
+  if (copy_file(src, tmp.c_str()) && rename(tmp.c_str(), dst) == 0) return true;
+  remove(tmp.c_str());
+  return false;
+}
+
+// ----------------------------------------------------------------------------
+/// Write small text file atomically
+static void write_text(const string &fname, const char *text)
+{
+  const string tmp = temp_name(fname);
+  FILE *fp = fopen(tmp.c_str(), "w");
+  if (!fp) return;
+  const bool ok = (fputs(text, fp) >= 0);
+  if (fclose(fp) == 0 && ok && rename(tmp.c_str(), fname.c_str()) == 0) return;
+  remove(tmp.c_str());
+}
+
+// ----------------------------------------------------------------------------
+/// Name of cache file of encoded crop
+static string crop_name(const string &dir, const string &key, const BoundingBox &box, const char *fname)
+{
+  char name[128];
+  snprintf(name, 128, "/%s-%d_%d_%d_%d.%s", key.c_str(), box.x0, box.y0, box.x1, box.y1,
+           cimg::split_filename(fname));
+  return dir + name;
+}
+
+// ============================================================================
+// Cache
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+Cache::Cache(const string &dir)
+:
+  _dir(dir)
+{
+  while (_dir.size() > 1 && (_dir[_dir.size() - 1] == '/' || _dir[_dir.size() - 1] == '\\')) {
+    _dir.resize(_dir.size() - 1);
+  }
+  if (_dir.empty() || !make_directory(_dir)) {
+    throw CImgIOException("Failed to create cache directory %s!", dir.c_str());
+  }
+}
+
+// ----------------------------------------------------------------------------
+string Cache::key(const char *fname)
+{
+  unsigned long long h;
+  if (!hash_file(fname, h)) {
+    throw CImgIOException("Failed to read file %s!", fname);
+  }
+  char key[32];
+  snprintf(key, 32, "%016llx", h);
+  return key;
+}
+
+// ----------------------------------------------------------------------------
+bool Cache::get(const string &key, int &w, int &h, BoundingBox &box) const
+{
+  FILE *fp = fopen((_dir + "/" + key + ".box").c_str(), "r");
+  if (!fp) return false;
+  char end[8] = "";
+  const int n = fscanf(fp, "%d %d %d %d %d %d %7s", &w, &h, &box.x0, &box.y0, &box.x1, &box.y1, end);
+  fclose(fp);
+  return n == 7 && strcmp(end, "end") == 0;
+}
+
+// ----------------------------------------------------------------------------
+void Cache::put(const string &key, int w, int h, const BoundingBox &box) const
+{
+  char text[128];
+  snprintf(text, 128, "%d %d %d %d %d %d end\n", w, h, box.x0, box.y0, box.x1, box.y1);
+  write_text(_dir + "/" + key + ".box", text);
+}
+
+// ----------------------------------------------------------------------------
+bool Cache::get(const string &key, const BoundingBox &box, const char *fname) const
+{
+  const string crop = crop_name(_dir, key, box, fname);
+  FILE *fp = fopen((crop + ".sum").c_str(), "r");
+  if (!fp) return false;
+  unsigned long long expected = 0, actual = 0;
+  const int n = fscanf(fp, "%llx", &expected);
+  fclose(fp);
+  if (n != 1 || !hash_file(crop.c_str(), actual) || actual != expected) return false;
+  return link_or_copy(crop.c_str(), fname);
+}
+
+// ----------------------------------------------------------------------------
+void Cache::put(const string &key, const BoundingBox &box, const char *fname) const
+{
+  unsigned long long h;
+  if (!hash_file(fname, h)) return;
+  const string crop = crop_name(_dir, key, box, fname);
+  if (!link_or_copy(fname, crop.c_str())) return;
+  char text[32];
+  snprintf(text, 32, "%016llx\n", h);
+  write_text(crop + ".sum", text);
+}
+
+// ============================================================================
+// Jobs
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+int process_cached(const Job &job, Sequence &seq, BoundingBoxes *boxes, JobStats *stats, Progress *progress)
+{
+  const Cache cache(job.cache);
+  const vector<string> fnames = frame_files(job.input, job.fbegin, job.fend, job.fstride);
+  const int n = int(fnames.size());
+  if (n == 0) {
+    throw CImgIOException("Input image sequence %s is empty!", job.input.c_str());
+  }
+  if (int(seq.size()) < n) seq.insert(n - seq.size());
+  if (int(seq.size()) > n) seq.remove(n, seq.size() - 1);
+  // Look up crop regions and decode frames not found in cache
+  vector<string> keys  (n);
+  vector<int>    width (n), height(n);
+  vector<char>   loaded(n, 0);
+  BoundingBoxes  bb    (n);
+  for (int i = 0; i < n; ++i) {
+    keys[i] = Cache::key(fnames[i].c_str());
+    if (!cache.get(keys[i], width[i], height[i], bb[i])) {
+      seq[i].load(fnames[i].c_str());
+      width [i] = seq[i].width();
+      height[i] = seq[i].height();
+      loaded[i] = 1;
+    }
+  }
+  int nloaded = 0;
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic) reduction(+:nloaded)
+#endif
+  for (int i = 0; i < n; ++i) {
+    if (loaded[i]) {
+      bb[i] = analyze(seq[i]);
+      ++nloaded;
+    }
+  }
+  for (int i = 0; i < n; ++i) {
+    if (loaded[i]) cache.put(keys[i], width[i], height[i], bb[i]);
+  }
+  // Adjust crop regions
+  const int w = width [0];
+  const int h = height[0];
+  if (stats) stats->tight = bb;
+  adjust(bb, job.mode, w, h, job.segments);
+  // Write cropped frames, reusing unchanged crops if written to separate files
+  int nwritten = n;
+  if (CImgList<>::is_saveable(job.output.c_str())) {
+    for (int i = 0; i < n; ++i) {
+      if (!loaded[i]) seq[i].load(fnames[i].c_str());
+    }
+    crop_and_write(seq, bb, job.output.c_str());
+    if (progress) {
+      for (int i = 0; i < n; ++i) progress->written(i, bb[i]);
+    }
+  } else {
+    char fname[1024];
+    for (int i = 0; i < n; ++i) {
+      if (n == 1) snprintf(fname, 1024, "%s", job.output.c_str());
+      else        cimg::number_filename(job.output.c_str(), i, 6, fname);
+      const BoundingBox &b = bb[i];
+      if (cache.get(keys[i], b, fname)) {
+        --nwritten;
+      } else {
+        if (!loaded[i]) seq[i].load(fnames[i].c_str());
+        // do not overwrite crop in cache which the output file may be linked to
+        remove(fname);
+        seq[i].crop(b.x0, b.y0, b.x1, b.y1).save(fname);
+        cache.put(keys[i], b, fname);
+      }
+      if (progress) progress->written(i, b);
+    }
+  }
+  if (!job.csv.empty()) {
+    write_csv(job.csv.c_str(), bb, w, h, job.fbegin, job.fstride, job.append);
+  }
+  if (stats) {
+    stats->frames   = n;
+    stats->width    = w;
+    stats->height   = h;
+    stats->analyzed = nloaded;
+    stats->written  = nwritten;
+  }
+  if (boxes) boxes->swap(bb);
+  return n;
+}
+
+
+} // namespace animtk
@@ -0,0 +1,101 @@
+/* Analysis cache of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_CACHE_H
+#define ANIMTK_CACHE_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Cache
+// ============================================================================
+
+/// Content-addressed on-disk cache of crop regions and cropped frames
+///
+/// Entries are keyed by a 64-bit FNV-1a hash of the bytes of an input frame
+/// file. For each key, the cache directory contains a file <key>.box with the
+/// size and crop region of the frame, and optionally encoded crops of the frame
+/// named <key>-<x0>_<y0>_<x1>_<y1>.<ext> together with a checksum file. Crops
+/// are shared with the output files by hard links where possible. A crop which
+/// was modified since, e.g., because its output file was overwritten in place,
+/// fails the checksum test and is re-encoded.
+class Cache
+{
+  std::string _dir;
+
+public:
+
+  /// Open cache, creating its directory if necessary
+  ///
+  /// \throws cimg_library::CImgIOException if the directory could not be created.
+  Cache(const std::string &dir);
+
+  /// Cache directory
+  const std::string &dir() const { return _dir; }
+
+  /// Compute key of input frame file
+  ///
+  /// \throws cimg_library::CImgIOException if the file could not be read.
+  static std::string key(const char *fname);
+
+  /// Look up size and crop region of frame
+  bool get(const std::string &key, int &w, int &h, BoundingBox &box) const;
+
+  /// Store size and crop region of frame
+  void put(const std::string &key, int w, int h, const BoundingBox &box) const;
+
+  /// Reuse encoded crop of frame as output file
+  ///
+  /// \returns Whether a valid crop was found and linked or copied to \p fname.
+  bool get(const std::string &key, const BoundingBox &box, const char *fname) const;
+
+  /// Store encoded crop of frame written to output file
+  void put(const std::string &key, const BoundingBox &box, const char *fname) const;
+};
+
+/// Process crop job using the cache given by Job::cache
+///
+/// Only input frames which are not in the cache are decoded and analyzed.
+/// When the frames are written to separate output files, unchanged crops are
+/// reused instead of being encoded again. The output is identical to the
+/// one of process() without cache.
+///
+/// \param[in]     job   Crop job. The input must be a file name pattern.
+/// \param[in,out] seq   Image sequence whose frame buffers are reused.
+/// \param[out]    boxes Crop regions of the frames. Not returned if \c NULL.
+/// \param[out]    stats Statistics of the job, where JobStats::analyzed is the
+///                      number of frames which were not found in the cache.
+///                      Not returned if \c NULL.
+/// \param[in]     progress Receiver of the crop regions of the written frames
+///                         (see process()). Not reported if \c NULL.
+///
+/// \returns Number of processed frames.
+///
+/// \throws cimg_library::CImgException if the job failed.
+int process_cached(const Job &job, Sequence &seq, BoundingBoxes *boxes = NULL, JobStats *stats = NULL,
+                   Progress *progress = NULL);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_CACHE_H
@@ -0,0 +1,234 @@
+/* Resumable processing of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "checkpoint.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+bool Checkpoint::matches(const Job &job) const
+{
+  return input  == job.input  && output  == job.output  && mode    == job.mode    &&
+         fbegin == job.fbegin && fend    == job.fend    && fstride == job.fstride &&
+         segments == job.segments;
+}
+
+// ----------------------------------------------------------------------------
+/// Read line without trailing newline
+static bool read_line(FILE *fp, string &line)
+{
+  char buffer[4096];
+  if (!fgets(buffer, 4096, fp)) return false;
+  line = buffer;
+  while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r')) {
+    line.resize(line.size() - 1);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool read_checkpoint(const char *fname, Checkpoint &cp)
+{
+  FILE *fp = fopen(fname, "r");
+  if (!fp) return false;
+  string line;
+  int    version = 0, mode = 0;
+  bool   ok = read_line(fp, line) &&
+              sscanf(line.c_str(), "animtk-checkpoint %d %d %d %d %d %d %d %d %d", &version, &mode, &cp.segments,
+                     &cp.fbegin, &cp.fend, &cp.fstride, &cp.nframes, &cp.width, &cp.height) == 9 &&
+              version == 2 && cp.nframes >= 0 &&
+              read_line(fp, line) && line.compare(0, 6, "input ")  == 0 &&
+              read_line(fp, line) && line.compare(0, 7, "output ") == 0;
+  if (ok) {
+    cp.mode = static_cast<CropMode>(mode);
+    cp.analyzed.assign(cp.nframes, 0);
+    cp.written .assign(cp.nframes, 0);
+    cp.boxes   .assign(cp.nframes, BoundingBox());
+    rewind(fp);
+    read_line(fp, line);
+    read_line(fp, line), cp.input  = line.substr(6);
+    read_line(fp, line), cp.output = line.substr(7);
+    while (ok && read_line(fp, line)) {
+      int i = -1;
+      BoundingBox b;
+      if (sscanf(line.c_str(), "box %d %d %d %d %d", &i, &b.x0, &b.y0, &b.x1, &b.y1) == 5) {
+        ok = (0 <= i && i < cp.nframes);
+        if (ok) cp.boxes[i] = b, cp.analyzed[i] = 1;
+      } else if (sscanf(line.c_str(), "done %d", &i) == 1) {
+        ok = (0 <= i && i < cp.nframes);
+        if (ok) cp.written[i] = 1;
+      } else {
+        ok = false;
+      }
+    }
+  }
+  fclose(fp);
+  return ok;
+}
+
+// ----------------------------------------------------------------------------
+void write_checkpoint(const char *fname, const Checkpoint &cp)
+{
+  const string tmp = string(fname) + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "w");
+  if (!fp) {
+    throw CImgIOException("Failed to open checkpoint file %s for writing!", tmp.c_str());
+  }
+  fprintf(fp, "animtk-checkpoint 2 %d %d %d %d %d %d %d %d\n", int(cp.mode), cp.segments,
+          cp.fbegin, cp.fend, cp.fstride, cp.nframes, cp.width, cp.height);
+  fprintf(fp, "input %s\n",  cp.input .c_str());
+  fprintf(fp, "output %s\n", cp.output.c_str());
+  for (int i = 0; i < cp.nframes; ++i) {
+    if (cp.analyzed[i]) {
+      const BoundingBox &b = cp.boxes[i];
+      fprintf(fp, "box %d %d %d %d %d\n", i, b.x0, b.y0, b.x1, b.y1);
+    }
+  }
+  for (int i = 0; i < cp.nframes; ++i) {
+    if (cp.written[i]) fprintf(fp, "done %d\n", i);
+  }
+  const bool ok = (ferror(fp) == 0);
+  if (fclose(fp) != 0 || !ok || rename(tmp.c_str(), fname) != 0) {
+    remove(tmp.c_str());
+    throw CImgIOException("Failed to write checkpoint file %s!", fname);
+  }
+}
+
+// ----------------------------------------------------------------------------
+int process_checkpointed(const Job &job, Sequence &seq, BoundingBoxes *boxes, JobStats *stats, Progress *progress)
+{
+  const vector<string> fnames = frame_files(job.input, job.fbegin, job.fend, job.fstride);
+  const int n = int(fnames.size());
+  if (n == 0) {
+    throw CImgIOException("Input image sequence %s is empty!", job.input.c_str());
+  }
+  const char *fname = job.checkpoint.c_str();
+  // Continue from checkpoint of interrupted run
+  Checkpoint cp;
+  if (job.resume && read_checkpoint(fname, cp)) {
+    if (!cp.matches(job)) {
+      throw CImgArgumentException("Checkpoint %s belongs to a different crop job!", fname);
+    }
+    if (cp.nframes != n) {
+      throw CImgArgumentException("Number of frames changed since checkpoint %s was written!", fname);
+    }
+  } else {
+    cp = Checkpoint();
+    cp.input    = job.input;
+    cp.output   = job.output;
+    cp.mode     = job.mode;
+    cp.segments = job.segments;
+    cp.fbegin   = job.fbegin;
+    cp.fend     = job.fend;
+    cp.fstride  = job.fstride;
+    cp.nframes  = n;
+    cp.analyzed.assign(n, 0);
+    cp.written .assign(n, 0);
+    cp.boxes   .assign(n, BoundingBox());
+  }
+  const int chunk = cimg::max(1, job.interval);
+  const int nbuffers = cimg::min(n, chunk);
+  if (int(seq.size()) < nbuffers) seq.insert(nbuffers - seq.size());
+  // Analyze frames which were not analyzed before
+  vector<int> todo;
+  for (int i = 0; i < n; ++i) {
+    if (!cp.analyzed[i]) todo.push_back(i);
+  }
+  const int nanalyzed = int(todo.size());
+  for (size_t start = 0; start < todo.size(); start += chunk) {
+    const int m = int(cimg::min(todo.size() - start, size_t(chunk)));
+    for (int k = 0; k < m; ++k) seq[k].load(fnames[todo[start + k]].c_str());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int k = 0; k < m; ++k) {
+      const int i = todo[start + k];
+      cp.boxes   [i] = analyze(seq[k]);
+      cp.analyzed[i] = 1;
+    }
+    if (todo[start] == 0) cp.width = seq[0].width(), cp.height = seq[0].height();
+    write_checkpoint(fname, cp);
+  }
+  // Adjust crop regions
+  BoundingBoxes bb = cp.boxes;
+  if (stats) stats->tight = bb;
+  adjust(bb, job.mode, cp.width, cp.height, job.segments);
+  // Write frames which were not written before
+  int nwritten = n;
+  if (CImgList<>::is_saveable(job.output.c_str())) {
+    Sequence all(n);
+    for (int i = 0; i < n; ++i) all[i].load(fnames[i].c_str());
+    crop_and_write(all, bb, job.output.c_str());
+    if (progress) {
+      for (int i = 0; i < n; ++i) progress->written(i, bb[i]);
+    }
+  } else {
+    todo.clear();
+    for (int i = 0; i < n; ++i) {
+      if (!cp.written[i]) todo.push_back(i);
+      else if (progress) progress->written(i, bb[i]);
+    }
+    nwritten = int(todo.size());
+    char ofname[1024];
+    for (size_t start = 0; start < todo.size(); start += chunk) {
+      const int m = int(cimg::min(todo.size() - start, size_t(chunk)));
+      for (int k = 0; k < m; ++k) seq[k].load(fnames[todo[start + k]].c_str());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int k = 0; k < m; ++k) {
+        const BoundingBox &b = bb[todo[start + k]];
+        seq[k].crop(b.x0, b.y0, b.x1, b.y1);
+      }
+      for (int k = 0; k < m; ++k) {
+        const int i = todo[start + k];
+        if (n == 1) snprintf(ofname, 1024, "%s", job.output.c_str());
+        else        cimg::number_filename(job.output.c_str(), i, 6, ofname);
+        seq[k].save(ofname);
+        cp.written[i] = 1;
+        if (progress) progress->written(i, bb[i]);
+      }
+      write_checkpoint(fname, cp);
+    }
+  }
+  if (!job.csv.empty()) {
+    write_csv(job.csv.c_str(), bb, cp.width, cp.height, job.fbegin, job.fstride, job.append);
+  }
+  remove(fname);
+  if (stats) {
+    stats->frames   = n;
+    stats->width    = cp.width;
+    stats->height   = cp.height;
+    stats->analyzed = nanalyzed;
+    stats->written  = nwritten;
+  }
+  if (boxes) boxes->swap(bb);
+  return n;
+}
+
+
+} // namespace animtk
@@ -0,0 +1,105 @@
+/* Resumable processing of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_CHECKPOINT_H
+#define ANIMTK_CHECKPOINT_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+/// Progress of a crop job
+///
+/// A checkpoint is stored as text file which identifies the job and lists
+/// the unadjusted crop regions of the analyzed frames and the positions of
+/// the frames whose output file was written:
+///
+///   animtk-checkpoint 2 <mode> <segments> <fbegin> <fend> <fstride> <nframes> <width> <height>
+///   input <file name pattern>
+///   output <file name>
+///   box <index> <x0> <y0> <x1> <y1>
+///   done <index>
+struct Checkpoint
+{
+  std::string       input;    ///< Input sequence of the job.
+  std::string       output;   ///< Output sequence of the job.
+  CropMode          mode;     ///< Crop mode of the job.
+  int               segments; ///< Cost of each segment of the job.
+  int               fbegin;   ///< Index of first frame.
+  int               fend;     ///< Index of last frame or -1.
+  int               fstride;  ///< Increment of frame indices.
+  int               nframes;  ///< Number of frames of the input sequence.
+  int               width;    ///< Width of input frames.
+  int               height;   ///< Height of input frames.
+  std::vector<char> analyzed; ///< Whether the crop region of a frame is known.
+  std::vector<char> written;  ///< Whether the output of a frame was written.
+  BoundingBoxes     boxes;    ///< Unadjusted crop regions of analyzed frames.
+
+  Checkpoint() : mode(CROP_TIGHT), segments(0), fbegin(0), fend(-1), fstride(1), nframes(0), width(0), height(0) {}
+
+  /// Whether checkpoint belongs to the given job
+  bool matches(const Job &job) const;
+};
+
+/// Read checkpoint
+///
+/// \returns Whether the checkpoint file exists and is valid.
+bool read_checkpoint(const char *fname, Checkpoint &checkpoint);
+
+/// Write checkpoint atomically, i.e., a previous checkpoint is only replaced
+/// once the new one was written completely
+///
+/// \throws cimg_library::CImgIOException if the file could not be written.
+void write_checkpoint(const char *fname, const Checkpoint &checkpoint);
+
+/// Process crop job, saving its progress to the checkpoint given by Job::checkpoint
+///
+/// The frames are processed in chunks of Job::interval frames, after each of
+/// which the checkpoint is updated. Frames are first analyzed and then cropped
+/// and written. When Job::resume is set and the checkpoint of an interrupted
+/// run of the same job exists, only frames which were not analyzed yet are
+/// decoded for analysis, and only frames whose output was not written yet are
+/// decoded and written. Output formats which store the sequence in a single
+/// file are always written at once. The checkpoint is removed when the job
+/// is completed.
+///
+/// \param[in]     job       Crop job. The input must be a file name pattern.
+/// \param[in,out] seq       Image sequence whose frame buffers are reused.
+/// \param[out]    boxes     Crop regions of the frames. Not returned if \c NULL.
+/// \param[out]    stats     Statistics of this run. Not returned if \c NULL.
+/// \param[in]     progress  Receiver of the crop regions of the written frames
+///                          (see process()), where the frames written by an
+///                          interrupted run are reported first. Not reported if \c NULL.
+///
+/// \returns Number of frames of the sequence.
+///
+/// \throws cimg_library::CImgException if the job failed.
+int process_checkpointed(const Job &job, Sequence &seq, BoundingBoxes *boxes = NULL, JobStats *stats = NULL,
+                         Progress *progress = NULL);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_CHECKPOINT_H
@@ -0,0 +1,233 @@
+/* Connected components of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "components.h"
+#include "pool.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Horizontal run of foreground pixels
+struct Run
+{
+  int x0, x1;  ///< First and last column.
+  int label;   ///< Label of run, which is joined with the labels of its component.
+};
+
+// ----------------------------------------------------------------------------
+/// Find representative label of component
+static int find(vector<int> &parent, int i)
+{
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+// ----------------------------------------------------------------------------
+/// Join components of two labels
+static void unite(vector<int> &parent, int i, int j)
+{
+  i = find(parent, i);
+  j = find(parent, j);
+  if (i < j) parent[j] = i;
+  else       parent[i] = j;
+}
+
+// ----------------------------------------------------------------------------
+/// Whether two boxes are at most gap pixels apart in both directions
+static bool close(const BoundingBox &a, const BoundingBox &b, int gap)
+{
+  return cimg::max(a.x0 - b.x1, b.x0 - a.x1) - 1 <= gap &&
+         cimg::max(a.y0 - b.y1, b.y0 - a.y1) - 1 <= gap;
+}
+
+// ----------------------------------------------------------------------------
+/// Order of regions by their top and then left edge
+static bool top_left(const BoundingBox &a, const BoundingBox &b)
+{
+  return a.y0 < b.y0 || (a.y0 == b.y0 && a.x0 < b.x0);
+}
+
+// ============================================================================
+// Regions
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+BoundingBoxes find_regions(const Frame &frame, int gap)
+{
+  if (frame.is_empty() || frame.depth() > 1 || frame.spectrum() > 16) {
+    return BoundingBoxes(1, analyze(frame));
+  }
+  const int w = frame.width(), h = frame.height();
+  unsigned char bg[16];
+  for (int c = 0; c < frame.spectrum(); ++c) bg[c] = frame(0, 0, 0, c);
+  // Label runs of foreground pixels, joining the labels of 8-connected runs
+  // of consecutive rows
+  vector<unsigned char> mask(w);
+  vector<Run>           runs;
+  vector<int>           parent;
+  vector<int>           rows;
+  size_t prev_begin = 0, prev_end = 0;
+  for (int y = 0; y < h; ++y) {
+    fill(mask.begin(), mask.end(), 0);
+    for (int c = 0; c < frame.spectrum(); ++c) {
+      const unsigned char *p = frame.data(0, y, 0, c);
+      const unsigned char  v = bg[c];
+      for (int x = 0; x < w; ++x) mask[x] |= (p[x] != v);
+    }
+    const size_t begin = runs.size();
+    size_t       i     = prev_begin;
+    int          x     = 0;
+    while (x < w) {
+      while (x < w && !mask[x]) ++x;
+      if (x == w) break;
+      Run run;
+      run.x0 = x;
+      while (x < w && mask[x]) ++x;
+      run.x1    = x - 1;
+      run.label = static_cast<int>(parent.size());
+      parent.push_back(run.label);
+      while (i < prev_end && runs[i].x1 + 1 < run.x0) ++i;
+      for (size_t j = i; j < prev_end && runs[j].x0 <= run.x1 + 1; ++j) {
+        unite(parent, runs[j].label, run.label);
+      }
+      runs.push_back(run);
+      rows.push_back(y);
+    }
+    prev_begin = begin;
+    prev_end   = runs.size();
+  }
+  if (runs.empty()) return BoundingBoxes(1, analyze(frame));
+  // Bounding boxes of components
+  BoundingBoxes boxes;
+  vector<int>   index(parent.size(), -1);
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const Run &run  = runs[i];
+    const int  root = find(parent, run.label);
+    if (index[root] < 0) {
+      if (static_cast<int>(boxes.size()) == MAX_LABELED_COMPONENTS) return BoundingBoxes(1, analyze(frame));
+      index[root] = static_cast<int>(boxes.size());
+      boxes.push_back(BoundingBox(run.x0, rows[i], run.x1, rows[i]));
+    } else {
+      BoundingBox &b = boxes[index[root]];
+      b.x0 = cimg::min(b.x0, run.x0);
+      b.x1 = cimg::max(b.x1, run.x1);
+      b.y1 = rows[i];
+    }
+  }
+  // Merge boxes of nearby components
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t i = 0; i < boxes.size(); ++i)
+    for (size_t j = i + 1; j < boxes.size(); ) {
+      if (close(boxes[i], boxes[j], gap)) {
+        boxes[i].x0 = cimg::min(boxes[i].x0, boxes[j].x0);
+        boxes[i].x1 = cimg::max(boxes[i].x1, boxes[j].x1);
+        boxes[i].y0 = cimg::min(boxes[i].y0, boxes[j].y0);
+        boxes[i].y1 = cimg::max(boxes[i].y1, boxes[j].y1);
+        boxes.erase(boxes.begin() + j);
+        merged = true;
+      } else {
+        ++j;
+      }
+    }
+  }
+  sort(boxes.begin(), boxes.end(), top_left);
+  // Ensure that center is well defined
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    boxes[i].x1 += (boxes[i].x1 - boxes[i].x0 + 1) % 2;
+    boxes[i].y1 += (boxes[i].y1 - boxes[i].y0 + 1) % 2;
+  }
+  return boxes;
+}
+
+// ----------------------------------------------------------------------------
+FrameRegions find_regions(const Sequence &frames, int gap)
+{
+  FrameRegions regions(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    regions[frame] = find_regions(frames[frame], gap);
+  }
+  return regions;
+}
+
+// ----------------------------------------------------------------------------
+void write_regions(const Sequence &frames, const FrameRegions &regions, const char *fname, FramePool &pool)
+{
+  if (regions.size() != frames.size()) {
+    throw CImgArgumentException("write_regions(): Number of frame regions (%u) does not match number of frames (%u)",
+                                (unsigned int)regions.size(), frames.size());
+  }
+  char ofname[1024];
+  int  k = 0;
+  cimglist_for(frames,frame) {
+    for (size_t i = 0; i < regions[frame].size(); ++i, ++k) {
+      const BoundingBox &b = regions[frame][i];
+      cimg::number_filename(fname, k, 6, ofname);
+      pool.save(frames[frame].get_crop(b.x0, b.y0, b.x1, b.y1), ofname);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+void write_regions_csv(const char *fname, const FrameRegions &regions, int w, int h,
+                       int fbegin, int fstride, bool append)
+{
+  FILE *csv = NULL;
+  if (append) {
+    csv = fopen(fname, "r");
+    if (csv) {
+      fclose(csv);
+      csv = fopen(fname, "a");
+    }
+  }
+  if (!csv) {
+    csv = fopen(fname, "w");
+    if (csv) write_csv_header(csv);
+  }
+  if (!csv) {
+    throw CImgIOException("Failed to open spreadsheet file %s!", fname);
+  }
+  for (size_t frame = 0; frame < regions.size(); ++frame) {
+    for (size_t i = 0; i < regions[frame].size(); ++i) {
+      const BoundingBox *prev = NULL;
+      if (frame > 0 && i < regions[frame - 1].size()) prev = &regions[frame - 1][i];
+      write_csv_row(csv, fbegin + int(frame) * fstride, regions[frame][i], w, h, prev);
+    }
+  }
+  fclose(csv);
+}
+
+
+} // namespace animtk
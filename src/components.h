@@ -0,0 +1,79 @@
+/* Connected components of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_COMPONENTS_H
+#define ANIMTK_COMPONENTS_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Regions
+// ============================================================================
+
+/// Crop regions of the separate parts of each frame of an image sequence
+typedef std::vector<BoundingBoxes> FrameRegions;
+
+/// Maximum number of connected components of a frame which are merged into
+/// regions, a frame with more components has the single region of analyze()
+const int MAX_LABELED_COMPONENTS = 4096;
+
+/// Determine crop regions of the separate parts of a frame
+///
+/// The pixels which differ from the background color, which is guessed as by
+/// analyze(), are labeled by their 8-connected components. The bounding boxes
+/// of components which are at most \p gap pixels apart, both horizontally and
+/// vertically, are merged until all regions are further apart. Like the box
+/// determined by analyze(), each region is enlarged to even width and height.
+///
+/// \returns Crop regions ordered by their top and then left edge. A frame
+///          without foreground has the single empty region of analyze().
+BoundingBoxes find_regions(const Frame &frame, int gap = 16);
+
+/// Determine crop regions of the separate parts of all frames
+FrameRegions find_regions(const Sequence &frames, int gap = 16);
+
+/// Write each region of each frame to its own image file
+///
+/// The image files are numbered consecutively, starting at zero, in order of
+/// the frames and their regions, as by CImgList::save() for sequences of more
+/// than one image.
+///
+/// \throws cimg_library::CImgIOException if an image could not be written.
+void write_regions(const Sequence &frames, const FrameRegions &regions, const char *fname, FramePool &pool);
+
+/// Write crop regions to CSV spreadsheet
+///
+/// The spreadsheet has the same columns as written by write_csv(), with one
+/// row per region, such that the k-th row corresponds to the k-th image file
+/// written by write_regions(). The offsets dx and dy of a region are relative
+/// to the region of the previous frame at the same position in order, and
+/// zero if the previous frame has fewer regions.
+///
+/// \throws cimg_library::CImgIOException if file could not be opened.
+void write_regions_csv(const char *fname, const FrameRegions &regions, int w, int h,
+                       int fbegin = 0, int fstride = 1, bool append = false);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_COMPONENTS_H
@@ -16,89 +16,297 @@
  */
 
 #include <string>
+#include <vector>
 #include "config.h"
+#include "animtk.h"
+#include "pool.h"
+#include "scale.h"
+#include "service.h"
+#include "shard.h"
+#include "texture.h"
+#include "watch.h"
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
 
 using namespace std;
+using namespace cimg_library;
+using namespace animtk;
 
 // ----------------------------------------------------------------------------
-// CImg
-#define cimg_display   0
-#define cimg_verbosity 0
-#define cimg_plugin "CImgPlugin.h"
-#include "CImg.h"
-using namespace cimg_library;
+// Parse options of a crop job given either on the command-line or by a line
+// of a batch manifest
+Job parse_job(int argc, char *argv[])
+{
+  Job job;
+  bool   append         = cimg_option("-a", false, "Process single image file and append to existing CSV spreadsheet.");
+  string ifname         = cimg_option("-i", "animation_000000.png",   "Input sequence, e.g., movie.mov, movie_000.png, or movie_\%06d.png.");
+  string default_ofname = append ? ifname : remove_pattern(ifname);
+  string ofname  = cimg_option("-o", default_ofname.c_str(),  "Output sequence, e.g., cropped.mov or cropped.png.");
+  string default_csvname = replace_extension(append ? remove_pattern(ofname) : ofname, ".csv");
+  string csvname = cimg_option("-c", default_csvname.c_str(), "Output CSV spreadsheet for pixel coordinates. (false: no output)");
+  // Replace _[0-9]+ pattern of input filename by format string
+  int fbegin = get_frame_number(ifname);
+  if (default_ofname != ifname) ifname = replace_pattern (ifname, fbegin);
+  // Remaining command-line options
+         fbegin  = cimg_option("-b", fbegin, "Index of first frame of image sequence.");
+  int    fend    = cimg_option("-e", -1,     "Index of last frame of image sequence.");
+  int    fstride = cimg_option("-s", 1,      "Increment/Stride of image frame indices.");
+  bool   bbunion = cimg_option("-u", false,  "Crop all images using the union of all bounding boxes.");
+  bool   bbfixed = cimg_option("-f", false,  "Crop all images using a fixed size bounding box.");
+  string cache   = cimg_option("--cache", "", "Cache directory of crop regions and cropped frames of unchanged input frames.");
+  string ckpt    = cimg_option("--checkpoint", "", "Checkpoint file to which the progress is saved periodically.");
+  bool   resume  = cimg_option("--resume", false, "Continue from checkpoint of interrupted run.");
+  int    ckptint = cimg_option("--interval", 100, "Number of frames processed between checkpoints.");
+  bool   stack   = cimg_option("--stack", false, "Store frames in one contiguous block of memory.");
+  string delta   = cimg_option("--delta", "", "Output CSV table of delta rectangles, whose regions are written instead of the cropped frames.");
+  int    keyint  = cimg_option("--keyframes", 30, "Interval of keyframes of delta output. (0: first frame only)");
+  bool   regions = cimg_option("--regions", false, "Crop each separate part of each frame to its own output file.");
+  int    gap     = cimg_option("--gap", 16, "Maximum distance in pixels of parts which are cropped together.");
+  string hull    = cimg_option("--hull", "", "Output CSV table of convex hulls of the foreground of the cropped frames.");
+  int    nverts  = cimg_option("--vertices", 8, "Maximum number of vertices of convex hulls.");
+  string scales  = cimg_option("--scales", "", "Comma separated scales of additional resampled outputs, e.g., 1,0.5,0.25.");
+  string texture = cimg_option("--texture", "", "BCn compression format of DDS output (-o *.dds): bc1, bc3 (default), or bc7.");
+  bool   hq      = cimg_option("--hq", false, "Compress textures using the slower high quality preset.");
+  int    colors  = cimg_option("--colors", 0, "Number of colors of indexed PNG output with a palette shared by all frames. (0: not indexed)");
+  string masks   = cimg_option("--masks", "", "Output file of 1-bit hit-test masks of the cropped frames.");
+  int    thres   = cimg_option("--threshold", 0, "Alpha value above which pixels of hit-test masks are hit.");
+  int    bleed   = cimg_option("--bleed", 0, "Pad crop regions by n pixels and fill transparent pixels with the colors of the nearest visible pixels.");
+  string tiles   = cimg_option("--tiles", "", "Output CSV table of tile maps, whose unique tiles are written to an atlas instead of the cropped frames.");
+  int    tilesz  = cimg_option("--tilesize", 16, "Width and height of tiles of tile maps.");
+  int    segcost = cimg_option("--segments", 0, "Crop contiguous segments of frames using the union of their bounding boxes, where each segment costs the given number of pixels.");
+  // Ensure that all frames of output sequence have same size
+  // if output format can store sequence in single file
+  bbfixed = bbfixed || CImgList<>::is_saveable(ofname.c_str());
+  if (csvname == "false" || csvname == "no" || csvname == "0") csvname.clear();
+  job.input   = ifname;
+  job.output  = ofname;
+  job.csv     = csvname;
+  job.fbegin  = fbegin;
+  job.fend    = fend;
+  job.fstride = fstride;
+  job.mode    = bbunion ? CROP_UNION : (bbfixed ? CROP_FIXED : (segcost > 0 ? CROP_SEGMENTED : CROP_TIGHT));
+  job.append  = append;
+  job.cache      = cache;
+  job.checkpoint = ckpt;
+  job.resume     = resume;
+  job.interval   = ckptint;
+  job.stack      = stack;
+  job.delta      = delta;
+  job.keyframes  = keyint;
+  job.regions    = regions;
+  job.gap        = gap;
+  job.hull       = hull;
+  job.vertices   = nverts;
+  job.scales     = parse_scales(scales.c_str());
+  job.texture    = texture;
+  job.hq         = hq;
+  job.colors     = colors;
+  job.masks      = masks;
+  job.threshold  = thres;
+  job.bleed      = bleed;
+  job.tiles      = tiles;
+  job.tilesize   = tilesz;
+  job.segments   = segcost;
+  if (resume && ckpt.empty()) job.checkpoint = replace_extension(ofname, ".ckpt");
+  return job;
+}
 
 // ----------------------------------------------------------------------------
-// Checks if given filename contains a format pattern such as in test_%05d.png
-bool contains_pattern(const string &str)
+// Split line of batch manifest into arguments, which are separated by white
+// space unless enclosed in double quotes
+vector<string> split_arguments(const string &line)
 {
-  const char *p = str.c_str();
-  while ((p = strchr(p, '%')) && ++p) {
-    while ('0' <= *p && *p <= '9') ++p;
-    if (*p == 'd') return true;
+  vector<string> args;
+  const char *p = line.c_str();
+  while (*p) {
+    while (*p && isspace(*p)) ++p;
+    if (!*p || *p == '#') break;
+    string arg;
+    bool quoted = false;
+    while (*p && (quoted || !isspace(*p))) {
+      if (*p == '"') quoted = !quoted;
+      else arg.push_back(*p);
+      ++p;
+    }
+    args.push_back(arg);
   }
-  return false;
+  return args;
 }
 
 // ----------------------------------------------------------------------------
-// Remove '_[0-9]+' pattern from string matching regular expression '*_[0-9]+\.*'
-string remove_pattern(const string &str)
+// Read crop jobs of a batch manifest with one job per line
+//
+// \returns Number of invalid jobs, which are reported to stderr.
+int read_manifest(const char *prog, const string &manifest, vector<Job> &jobs, vector<int> &lines)
 {
-  string res;
-  const char *p = str.c_str();
-  while (*p && *p != '_') res.push_back(*p++);
-  p++;
-  while ('0' <= *p && *p <= '9') p++;
-  if (*p != '.') return str;
-  return res + p;
+  FILE *fp = fopen(manifest.c_str(), "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Failed to open batch manifest %s!\n", manifest.c_str());
+    return 1;
+  }
+  int  nerrors = 0;
+  int  lineno  = 0;
+  char buffer[4096];
+  while (fgets(buffer, 4096, fp)) {
+    ++lineno;
+    vector<string> args = split_arguments(buffer);
+    if (args.empty()) continue;
+    vector<char *> argv(1, const_cast<char *>(prog));
+    for (size_t i = 0; i < args.size(); ++i) argv.push_back(const_cast<char *>(args[i].c_str()));
+    const Job job = parse_job(int(argv.size()), &argv[0]);
+    const string msg = validate(job);
+    if (!msg.empty()) {
+      fprintf(stderr, "Error: %s:%d: %s\n", manifest.c_str(), lineno, msg.c_str());
+      ++nerrors;
+      continue;
+    }
+    jobs .push_back(job);
+    lines.push_back(lineno);
+  }
+  fclose(fp);
+  return nerrors;
 }
 
 // ----------------------------------------------------------------------------
-// Replace '_[0-9]+' pattern from string matching regular expression '*_[0-9]+\.*'
-string replace_pattern(const string &str, int &b)
+// Process all crop jobs of a batch manifest
+int run_batch(const char *prog, const string &manifest, int verbose)
 {
-  string res;
-  string n;
-  const char *p = str.c_str();
-  while (*p && *p != '_') res.push_back(*p++);
-  p++;
-  while ('0' <= *p && *p <= '9') n.push_back(*p++);
-  if (!n.empty()) b = atoi(n.c_str());
-  if (*p != '.') return str;
-  char d[32];
-  snprintf(d, 32, "%lu", n.size());
-  return (res + "_%0" + d + "d") + p;
+  vector<Job> jobs;
+  vector<int> lines;
+  if (read_manifest(prog, manifest, jobs, lines) > 0) return 1;
+  if (verbose) { printf("Processing %d jobs of batch manifest %s...", int(jobs.size()), manifest.c_str()); fflush(stdout); }
+  vector<string> errors;
+  const int nfailed = process(jobs, errors);
+  if (verbose) { printf(nfailed ? " failed\n" : " done\n"); fflush(stdout); }
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    if (!errors[i].empty()) {
+      fprintf(stderr, "Error: %s:%d: %s\n", manifest.c_str(), lines[i], errors[i].c_str());
+    }
+  }
+  return nfailed ? 1 : 0;
 }
 
 // ----------------------------------------------------------------------------
-// Replace filename extension
-string replace_extension(const string &str, const char *ext)
+// Make file path absolute as it is interpreted by the crop service
+string absolute_path(const string &path)
 {
-  string res(str);
-  size_t pos = res.rfind('.');
-  if (pos != string::npos) res.replace(pos, string::npos, ext);
-  return res;
+#ifndef _WIN32
+  char cwd[4096];
+  if (!path.empty() && path[0] != '/' && getcwd(cwd, 4096)) return string(cwd) + "/" + path;
+#endif
+  return path;
 }
 
 // ----------------------------------------------------------------------------
-// Get frame number from filename matching regular expression '*_[0-9]+\.*'
-int get_frame_number(const string &str)
+// Submit crop job(s) to crop service and wait for their completion
+int run_client(const char *prog, const string &socket, const Job &job, const string &manifest, int verbose)
 {
-  string n;
-  const char *p = str.c_str();
-  while (*p && *p != '_') { p++; } p++;
-  while ('0' <= *p && *p <= '9') n.push_back(*p++);
-  return n.empty() ? 0 : atoi(n.c_str());
+  vector<Job> jobs;
+  vector<int> lines;
+  if (manifest.empty()) {
+    const string msg = validate(job);
+    if (!msg.empty()) {
+      fprintf(stderr, "%s\n", msg.c_str());
+      return 1;
+    }
+    jobs.push_back(job);
+  } else if (read_manifest(prog, manifest, jobs, lines) > 0) {
+    return 1;
+  }
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    jobs[i].input  = absolute_path(jobs[i].input);
+    jobs[i].output = absolute_path(jobs[i].output);
+    jobs[i].csv    = absolute_path(jobs[i].csv);
+    jobs[i].cache  = absolute_path(jobs[i].cache);
+    jobs[i].delta  = absolute_path(jobs[i].delta);
+    jobs[i].hull   = absolute_path(jobs[i].hull);
+    jobs[i].masks  = absolute_path(jobs[i].masks);
+    jobs[i].tiles  = absolute_path(jobs[i].tiles);
+    jobs[i].checkpoint = absolute_path(jobs[i].checkpoint);
+  }
+  try {
+    const int nfailed = submit(socket, jobs, verbose ? stdout : NULL);
+    if (nfailed) fprintf(stderr, "Error: %d of %d jobs failed!\n", nfailed, int(jobs.size()));
+    return nfailed ? 1 : 0;
+  } catch (const CImgException &err) {
+    fprintf(stderr, "Error: %s\n", err.what());
+    return 1;
+  }
 }
 
 // ----------------------------------------------------------------------------
-int main(int argc, char *argv[])
+// Analyze or crop part of a sequence, or merge box tables of all parts
+int run_shard(const Job &job, const string &shard, const string &table,
+              const string &merged, const string &boxes, int verbose)
 {
-  int px = -1, py = -1;
+  int i = 0, n = 0;
+  if (!shard.empty() && !parse_shard(shard.c_str(), i, n)) {
+    fprintf(stderr, "Invalid shard %s, must be i/n with 1 <= i <= n!\n", shard.c_str());
+    return 1;
+  }
+  if (!merged.empty() && !shard.empty()) {
+    fprintf(stderr, "Options --shard and --merge are mutually exclusive!\n");
+    return 1;
+  }
+  if (boxes.empty() && table.empty()) {
+    fprintf(stderr, "Missing output box table (-t)!\n");
+    return 1;
+  }
+  const string msg = validate(job);
+  if (!msg.empty()) {
+    fprintf(stderr, "%s\n", msg.c_str());
+    return 1;
+  }
+  const char *option = extra_option(job);
+  if (option) {
+    fprintf(stderr, "Option %s cannot be combined with --shard or --merge!\n", option);
+    return 1;
+  }
+  try {
+    if (!merged.empty()) {
+      vector<BoxTable> tables;
+      size_t pos = 0, end;
+      do {
+        end = merged.find(',', pos);
+        tables.push_back(read_table(merged.substr(pos, end == string::npos ? end : end - pos).c_str()));
+        pos = end + 1;
+      } while (end != string::npos);
+      const BoxTable res = merge(tables, job.mode, job.segments);
+      write_table(table.c_str(), res);
+      if (!job.csv.empty()) {
+        write_csv(job.csv.c_str(), res.boxes, res.width, res.height, res.fbegin, res.fstride, job.append);
+      }
+      if (verbose) printf("Merged %d box tables of %d frames\n", int(tables.size()), res.nframes);
+    } else if (!boxes.empty()) {
+      const int m = crop_shard(job, read_table(boxes.c_str()), i, n);
+      if (verbose) printf("Cropped %d frames of shard %d/%d\n", m, i, n);
+    } else {
+      const BoxTable res = analyze_shard(job, i, n);
+      write_table(table.c_str(), res);
+      if (verbose) printf("Analyzed %d of %d frames in shard %d/%d\n", int(res.index.size()), res.nframes, i, n);
+    }
+  } catch (const CImgException &err) {
+    fprintf(stderr, "Error: %s\n", err.what());
+    return 1;
+  }
+  return 0;
+}
 
+// ----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
   // Command help
   cimg_usage("[options] -i animation.mov  -o frames.png [-c coords.csv]\n"
 "              [options] -i frames_\%6d.png -o frames.png [-c coords.csv]\n"
+"              [-v <int>] -m jobs.txt\n"
+"              [-v <int>] [-j <int>] --serve /run/animtk.sock\n"
+"              [options] --client /run/animtk.sock [-m jobs.txt]\n"
+"              [options] --watch [--idle <sec>] -i frames_\%6d.png -o frames.png\n"
+"              [options] --shard i/n -t part_i.txt -i frames_\%6d.png\n"
+"              [options] --merge part_1.txt,...,part_n.txt -t boxes.txt [-c coords.csv]\n"
+"              [options] --shard i/n --boxes boxes.txt -i frames_\%6d.png -o frames.png\n"
 "\n version: " VERSION);
   cimg_help(" This program can be used to crop all frames of an image sequence such as an animation.\n"
             " All frames of the sequence are expected to have the same size. Each frame is by\n"
@@ -106,25 +314,24 @@ int main(int argc, char *argv[])
             " and maximum pixel indices of the region used to crop each frame is optionally\n"
             " stored along with the cropped images. Additionally, relative pixel offsets for\n"
             " the center of the bounding boxes are computed and stored in the CSV file. This\n"
-            " allows the recovery of the global animation from the cropped image sequence.\n");
+            " allows the recovery of the global animation from the cropped image sequence.\n"
+            " Many image sequences can be processed at once by listing the options of each\n"
+            " crop job on a separate line of a batch manifest file. Alternatively, crop jobs can\n"
+            " be submitted to a crop service which keeps running in the background.\n");
   // Command-line options
-  char default_ifname[32];
-  bool   append         = cimg_option("-a", false, "Process single image file and append to existing CSV spreadsheet.");
-  string ifname         = cimg_option("-i", "animation_000000.png",   "Input sequence, e.g., movie.mov, movie_000.png, or movie_\%06d.png.");
-  string default_ofname = append ? ifname : remove_pattern(ifname);
-  string ofname  = cimg_option("-o", default_ofname.c_str(),  "Output sequence, e.g., cropped.mov or cropped.png.");
-  string default_csvname = replace_extension(append ? remove_pattern(ofname) : ofname, ".csv");
-  string csvname = cimg_option("-c", default_csvname.c_str(), "Output CSV spreadsheet for pixel coordinates. (false: no output)");
-  // Replace _[0-9]+ pattern of input filename by format string
-  int fbegin = get_frame_number(ifname);
-  if (default_ofname != ifname) ifname = replace_pattern (ifname, fbegin);
-  // Remaining command-line options
-         fbegin  = cimg_option("-b", fbegin, "Index of first frame of image sequence.");
-  int    fend    = cimg_option("-e", -1,     "Index of last frame of image sequence.");
-  int    fstride = cimg_option("-s", 1,      "Increment/Stride of image frame indices.");
-  bool   bbunion = cimg_option("-u", false,  "Crop all images using the union of all bounding boxes.");
-  bool   bbfixed = cimg_option("-f", false,  "Crop all images using a fixed size bounding box.");
-  int    verbose = cimg_option("-v", 0,      "Verbosity of output messages. (0: none, 1: status, 2: debug)");
+  const Job job  = parse_job(argc, argv);
+  string manifest = cimg_option("-m", "",  "Batch manifest with the job options of the command line, one job per line.");
+  int    verbose  = cimg_option("-v", 0,   "Verbosity of output messages. (0: none, 1: status, 2: debug)");
+  string server   = cimg_option("--serve",    "", "Run crop service listening on the given local socket.");
+  string client   = cimg_option("--client",   "", "Submit crop job(s) to the crop service listening on the given socket.");
+  bool   shutdown = cimg_option("--shutdown", false, "Shut down crop service given by --client after pending jobs are done.");
+  int    nthreads = cimg_option("-j", 0,   "Number of worker threads of crop service. (0: number of CPUs)");
+  bool   watching = cimg_option("--watch", false, "Crop frames as they are written to the input directory.");
+  int    idle     = cimg_option("--idle", 0, "Seconds without new frame after which watched sequence is complete. (0: wait for -e)");
+  string shard    = cimg_option("--shard", "", "Process i-th of n parts of the sequence given as i/n, e.g., 2/4.");
+  string table    = cimg_option("-t", "", "Output box table of --shard or --merge.");
+  string merged   = cimg_option("--merge", "", "Comma separated box tables of all shards to merge.");
+  string boxes    = cimg_option("--boxes", "", "Merged box table used by --shard to crop the frames of its part.");
   // CImg info
   if (verbose > 2) cimg::info();
   // Check arguments
@@ -135,194 +342,94 @@ int main(int argc, char *argv[])
       exit(0);
     }
   }
-  if (ifname.empty() || ofname.empty()) {
-    fprintf(stderr, "No input or output image sequence specified!\n");
-    exit(1);
-  }
-  if (fbegin < 0) {
-    fprintf(stderr, "Invalid frame start index (-b): %d\n", fbegin);
-    exit(1);
-  }
-  if (fstride < 1) {
-    fprintf(stderr, "Invalid frame index increment (-s): %d\n", fstride);
-    exit(1);
-  }
-  // Ensure that all frames of output sequence have same size
-  // if output format can store sequence in single file
-  bbfixed = bbfixed || CImgList<>::is_saveable(ofname.c_str());
-  // Read input sequence
-  if (verbose > 1) { printf("Read image sequence from %s...", ifname.c_str()); fflush(stdout); }
-  CImgList<unsigned char> seq;
-  try {
-    if (contains_pattern(ifname)) {
-      char buffer[1024];
-      for (int frame = fbegin; fend < 0 || frame <= fend; frame += fstride) {
-        if (frame > 1e6) {
-          if (verbose > 1) { printf(" failed\n"); fflush(stdout); }
-          fprintf(stderr, "Error: Too many input frames...!\n");
-          exit(1);
-        }
-        snprintf(buffer, 1024, ifname.c_str(), frame);
-        FILE *tmp = fopen(buffer, "r");
-        if (!tmp) {
-          if (frame > fbegin && fend < 0) break;
-          if (verbose > 1) { printf(" failed\n"); fflush(stdout); }
-          fprintf(stderr, "Error: Cannot read frame %d of image sequence."
-                          " Expected to find it in file %s!\n", frame, buffer);
-          exit(1);
-        }
-        fclose(tmp);
-        CImg<unsigned char> img(buffer);
-        seq.push_back(img);
-      }
-    } else {
-      seq.assign(ifname.c_str());
+  // Crop service
+  if (!server.empty()) {
+    try {
+      serve(server, nthreads, verbose);
+    } catch (const CImgException &err) {
+      fprintf(stderr, "Error: %s\n", err.what());
+      exit(1);
     }
-  } catch(const CImgException &err) {
-    if (verbose > 1) { printf(" failed\n"); fflush(stdout); }
-    fprintf(stderr, "Error: %s\n", err.what());
-    exit(1);
+    return 0;
   }
-  if (seq.size() < 1) {
-    if (verbose > 1) { printf(" failed\n"); fflush(stdout); }
-    fprintf(stderr, "Error: Input image sequence is empty!\n");
-    exit(1);
-  }
-  if (verbose > 1) { printf(" done\n"); fflush(stdout); }
-  const int w = seq.front().width();
-  const int h = seq.front().height();
-  if (verbose) {
-    printf("\n");
-    printf("#frames: %d\n", seq.size());
-    printf("width:   %d\n", w);
-    printf("height:  %d\n", h);
-    printf("\n");
-  }
-  // Determine crop regions
-  if (verbose > 1) {
-    printf("Determine bounding boxes...");
-    if (verbose > 1) printf("\n\n");
-    fflush(stdout);
-  }
-  CImgList<int> bb(seq.size());
-  cimglist_for(seq,frame) {
-    // Get crop region
-    bb[frame] = seq[frame].get_autocrop_region(0, "yx");
-    // Ensure that center is well defined
-    bb[frame](0,1) += (bb[frame](0,1) - bb[frame](0,0) + 1) % 2;
-    bb[frame](1,1) += (bb[frame](1,1) - bb[frame](1,0) + 1) % 2;
-    // Print crop region
-    if (verbose) {
-      const int x0 = bb[frame](0,0);
-      const int x1 = bb[frame](0,1);
-      const int y0 = bb[frame](1,0);
-      const int y1 = bb[frame](1,1);
-      const int rw = x1 - x0 + 1;
-      const int rh = y1 - y0 + 1;
-      const int cx = (x0 + x1)/2;
-      const int cy = (y0 + y1)/2;
-      const int dx = (px == -1) ? 0 : (cx - px);
-      const int dy = (py == -1) ? 0 : (cy - py);
-      printf("%6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d\n",
-             fbegin + frame * fstride, w, h, rw, rh, cx, cy, dx, dy, x0, y0, x1, y1);
-      fflush(stdout);
-      px = cx, py = cy;
+  if (!client.empty()) {
+    if (shutdown) {
+      try {
+        shutdown_service(client);
+      } catch (const CImgException &err) {
+        fprintf(stderr, "Error: %s\n", err.what());
+        exit(1);
+      }
+      return 0;
     }
+    return run_client(argv[0], client, job, manifest, verbose);
   }
-  // Adjust bounding boxes
-  if (bbunion) {
-    int x0 = seq.front().width();
-    int x1 = -1;
-    int y0 = seq.front().height();
-    int y1 = -1;
-    cimglist_for(bb,frame) {
-      x0 = cimg::min(x0,bb[frame](0,0));
-      x1 = cimg::max(x1,bb[frame](0,1));
-      y0 = cimg::min(y0,bb[frame](1,0));
-      y1 = cimg::max(y1,bb[frame](1,1));
-    }
-    cimglist_for(bb,frame) {
-      bb[frame](0,0) = x0;
-      bb[frame](0,1) = x1;
-      bb[frame](1,0) = y0;
-      bb[frame](1,1) = y1;
-    }
-    if (verbose) {
-      const int cx = (x0 + x1)/2;
-      const int cy = (y0 + y1)/2;
-      printf("union:     x=[%6d,%6d], y=[%6d,%6d], c=[%6d,%6d]\n", x0, x1, y0, y1, cx, cy);
-    }
-  } else if (bbfixed) {
-    int fx = 0;
-    int fy = 0;
-    cimglist_for(bb,frame) {
-      fx = cimg::max(fx, bb[frame](0,1) - bb[frame](0,0) + 1);
-      fy = cimg::max(fy, bb[frame](1,1) - bb[frame](1,0) + 1);
+  // Batch mode
+  if (!manifest.empty()) return run_batch(argv[0], manifest, verbose);
+  // Sharded processing
+  if (!shard.empty() || !merged.empty()) return run_shard(job, shard, table, merged, boxes, verbose);
+  // Watch-folder mode
+  if (watching) {
+    const string msg = validate(job);
+    if (!msg.empty()) {
+      fprintf(stderr, "%s\n", msg.c_str());
+      exit(1);
     }
-    cimglist_for(bb,frame) {
-      const int sx = bb[frame](0,1) - bb[frame](0,0);
-      const int sy = bb[frame](1,1) - bb[frame](1,0);
-      bb[frame](0,0) -= (fx - sx)     / 2;
-      bb[frame](0,1) += (fx - sx + 1) / 2;
-      bb[frame](1,0) -= (fy - sy)     / 2;
-      bb[frame](1,1) += (fy - sy + 1) / 2;
+    try {
+      watch(job, idle, verbose);
+    } catch (const CImgException &err) {
+      fprintf(stderr, "Error: %s\n", err.what());
+      exit(1);
     }
+    return 0;
   }
-  if (verbose > 1) { if (verbose == 1) printf(" done"); printf("\n"); fflush(stdout); }
-  // Crop images
-  if (verbose > 1) { printf("Crop frames of image sequence..."); fflush(stdout); }
-  cimglist_for(seq,frame) {
-    seq[frame].crop(bb[frame](0,0), bb[frame](1,0), bb[frame](0,1), bb[frame](1,1));
+  // Single crop job
+  const string msg = validate(job);
+  if (!msg.empty()) {
+    fprintf(stderr, "%s\n", msg.c_str());
+    exit(1);
   }
-  if (verbose > 1) { printf(" done\n"); fflush(stdout); }
-  // Write output sequence
+  // Read, analyze, crop, and write image sequence, where the crop regions
+  // and cropped frames of unchanged input frames are reused from the cache,
+  // and the progress is saved to the checkpoint if given
+  if (verbose > 1) { printf("Crop image sequence %s...", job.input.c_str()); fflush(stdout); }
+  FramePool     pool;
+  Sequence      seq;
+  BoundingBoxes bb;
+  JobStats      stats;
   try {
-    if (verbose > 1) { printf("Writing cropped sequence to %s...", ofname.c_str()); fflush(stdout); }
-    seq.save(ofname.c_str());
-    if (verbose > 1) { printf(" done\n"); fflush(stdout); }
+    process(job, seq, pool, &bb, verbose ? &stats : NULL);
   } catch (const CImgException &err) {
-    printf(" failed\n");
-    fflush(stdout);
+    if (verbose > 1) { printf(" failed\n"); fflush(stdout); }
     fprintf(stderr, "Error: %s\n", err.what());
     exit(1);
   }
-  // Write spreadsheet
-  if (!csvname.empty() && csvname != "false" && csvname != "no" && csvname != "0") {
-    FILE *csv = NULL;
-    if (append) {
-      csv = fopen(csvname.c_str(), "r");
-      if (csv) {
-        fclose(csv);
-        csv = fopen(csvname.c_str(), "a");
-      }
-    }
-    if (!csv) {
-      csv = fopen(csvname.c_str(), "w");
-      if (csv) fprintf(csv, " frame,     iw,     ih,     ow,     oh,     cx,     cy,     dx,     dy,     x0,     y0,     x1,     y1\n");
-    }
-    if (!csv) {
-      fprintf(stderr, "Failed to open spreadsheet file %s!\n", csvname.c_str());
-      exit(1);
+  if (verbose > 1) printf(" done\n");
+  if (verbose) {
+    const bool pattern = contains_pattern(job.input);
+    printf("\n");
+    if (!job.checkpoint.empty() && pattern) {
+      printf("#frames:   %d\n", stats.frames);
+      printf("#analyzed: %d\n", stats.analyzed);
+      printf("#written:  %d\n", stats.written);
+    } else if (!job.cache.empty() && pattern) {
+      printf("#frames: %d\n", stats.frames);
+      printf("#new:    %d\n", stats.analyzed);
+    } else {
+      printf("#frames: %d\n", stats.frames);
+      printf("width:   %d\n", stats.width);
+      printf("height:  %d\n", stats.height);
     }
-    if (verbose > 1) { printf("Writing crop regions to %s...", csvname.c_str()); fflush(stdout); }
-    px = -1, py = -1;
-    cimglist_for(bb,frame) {
-      const int x0 = bb [frame](0,0);
-      const int x1 = bb [frame](0,1);
-      const int y0 = bb [frame](1,0);
-      const int y1 = bb [frame](1,1);
-      const int rw = x1 - x0 + 1;
-      const int rh = y1 - y0 + 1;
-      const int cx = (x0 + x1)/2;
-      const int cy = (y0 + y1)/2;
-      const int dx = (px == -1) ? 0 : (cx - px);
-      const int dy = (py == -1) ? 0 : (cy - py);
-      fprintf(csv, "%6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d, %6d\n",
-                   fbegin + frame * fstride, w, h, rw, rh, cx, cy, dx, dy, x0, y0, x1, y1);
-      px = cx, py = cy;
+    printf("\n");
+    // Print bounding boxes of frames and union crop region
+    if (!job.regions) {
+      write_csv(stdout, stats.tight, stats.width, stats.height, job.fbegin, job.fstride);
+      if (job.mode == CROP_UNION && !bb.empty()) {
+        const BoundingBox &u = bb.front();
+        printf("union:     x=[%6d,%6d], y=[%6d,%6d], c=[%6d,%6d]\n", u.x0, u.x1, u.y0, u.y1, u.cx(), u.cy());
+      }
     }
-    fclose(csv);
-    if (verbose > 1) { printf(" done\n"); fflush(stdout); }
+    fflush(stdout);
   }
   return 0;
 }
@@ -0,0 +1,185 @@
+/* Delta output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "delta.h"
+#include "pool.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Whether any pixel of row y within columns [x0, x1] differs
+static bool changed(const Frame &prev, const Frame &frame, int x0, int x1, int y)
+{
+  for (int c = 0; c < frame.spectrum(); ++c) {
+    const unsigned char *p = prev .data(x0, y, 0, c);
+    const unsigned char *q = frame.data(x0, y, 0, c);
+    for (int n = x1 - x0 + 1; n > 0; --n, ++p, ++q) {
+      if (*p != *q) return true;
+    }
+  }
+  return false;
+}
+
+// ----------------------------------------------------------------------------
+/// Split band of rows at columns without changes
+///
+/// \param[in]  lo      Leftmost changed column of each row.
+/// \param[in]  hi      Rightmost changed column of each row, -1 if none.
+/// \param[in]  band    Bounding box of changes of the band.
+/// \param[out] regions Rectangles of the parts of the band.
+static void split_band(const Frame &prev, const Frame &frame, const vector<int> &lo, const vector<int> &hi,
+                       const BoundingBox &band, int gap, BoundingBoxes &regions)
+{
+  // Columns with changed pixels
+  vector<unsigned char> column(frame.width(), 0);
+  for (int y = band.y0; y <= band.y1; ++y) {
+    if (hi[y] < 0) continue;
+    for (int c = 0; c < frame.spectrum(); ++c) {
+      const unsigned char *p = prev .data(0, y, 0, c);
+      const unsigned char *q = frame.data(0, y, 0, c);
+      for (int x = lo[y]; x <= hi[y]; ++x) column[x] |= (p[x] != q[x]);
+    }
+  }
+  // Parts separated by more than gap unchanged columns
+  int x = band.x0;
+  while (x <= band.x1) {
+    int x0 = x, x1 = x;
+    for (++x; x <= band.x1; ++x) {
+      if (column[x]) x1 = x;
+      else if (x - x1 > gap) break;
+    }
+    // Shrink part to rows with changes
+    int y0 = band.y0, y1 = band.y1;
+    while (y0 < y1 && (hi[y0] < x0 || lo[y0] > x1 || !changed(prev, frame, x0, x1, y0))) ++y0;
+    while (y1 > y0 && (hi[y1] < x0 || lo[y1] > x1 || !changed(prev, frame, x0, x1, y1))) --y1;
+    regions.push_back(BoundingBox(x0, y0, x1, y1));
+    while (x <= band.x1 && !column[x]) ++x;
+  }
+}
+
+// ============================================================================
+// Delta rectangles
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+BoundingBoxes changed_regions(const Frame &prev, const Frame &frame, int gap, int max)
+{
+  if (!prev.is_sameXYZC(frame) || frame.depth() > 1) {
+    throw CImgArgumentException("changed_regions(): Frames must be 2D images of the same size");
+  }
+  const int w = frame.width(), h = frame.height();
+  // Leftmost and rightmost changed pixel of each row
+  vector<int> lo(h, w), hi(h, -1);
+  for (int y = 0; y < h; ++y) {
+    for (int c = 0; c < frame.spectrum(); ++c) {
+      const unsigned char *p = prev .data(0, y, 0, c);
+      const unsigned char *q = frame.data(0, y, 0, c);
+      for (int x = 0;     x < lo[y]; ++x) if (p[x] != q[x]) { lo[y] = x; break; }
+      for (int x = w - 1; x > hi[y]; --x) if (p[x] != q[x]) { hi[y] = x; break; }
+    }
+  }
+  // Bands of rows separated by more than gap unchanged rows
+  BoundingBoxes regions;
+  BoundingBox   all(w, h, -1, -1);
+  int y = 0;
+  while (y < h) {
+    if (hi[y] < 0) { ++y; continue; }
+    BoundingBox band(lo[y], y, hi[y], y);
+    for (++y; y < h; ++y) {
+      if (hi[y] < 0) {
+        if (y - band.y1 > gap) break;
+        continue;
+      }
+      band.x0 = cimg::min(band.x0, lo[y]);
+      band.x1 = cimg::max(band.x1, hi[y]);
+      band.y1 = y;
+    }
+    split_band(prev, frame, lo, hi, band, gap, regions);
+    all.x0 = cimg::min(all.x0, band.x0);
+    all.x1 = cimg::max(all.x1, band.x1);
+    all.y0 = cimg::min(all.y0, band.y0);
+    all.y1 = cimg::max(all.y1, band.y1);
+  }
+  if (static_cast<int>(regions.size()) > max) regions.assign(1, all);
+  return regions;
+}
+
+// ----------------------------------------------------------------------------
+DeltaRects delta_rects(const Sequence &frames, int keyframes)
+{
+  vector<BoundingBoxes> regions(frames.size());
+  vector<char>          key    (frames.size(), 0);
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,i) {
+    const Frame &frame = frames[i];
+    if (frame.is_empty()) continue;
+    key[i] = (i == 0 || (keyframes > 0 && i % keyframes == 0) || !frame.is_sameXYZC(frames[i - 1]));
+    if (key[i]) regions[i].push_back(BoundingBox(0, 0, frame.width() - 1, frame.height() - 1));
+    else        regions[i] = changed_regions(frames[i - 1], frame);
+  }
+  DeltaRects rects;
+  for (size_t i = 0; i < regions.size(); ++i) {
+    for (size_t j = 0; j < regions[i].size(); ++j) {
+      rects.push_back(DeltaRect(static_cast<int>(i), key[i] != 0, regions[i][j]));
+    }
+  }
+  return rects;
+}
+
+// ----------------------------------------------------------------------------
+void write_delta(const Sequence &frames, const DeltaRects &rects, const char *fname, FramePool &pool)
+{
+  char ofname[1024];
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const DeltaRect &r     = rects[i];
+    const Frame     &frame = frames[r.index];
+    cimg::number_filename(fname, static_cast<int>(i), 6, ofname);
+    if (r.key) pool.save(frame, ofname);
+    else       pool.save(frame.get_crop(r.box.x0, r.box.y0, r.box.x1, r.box.y1), ofname);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void write_delta_csv(const char *fname, const DeltaRects &rects, int fbegin, int fstride)
+{
+  FILE *csv = fopen(fname, "w");
+  if (!csv) {
+    throw CImgIOException("Failed to open spreadsheet file %s!", fname);
+  }
+  fprintf(csv, " frame,    key,  image,     x0,     y0,     x1,     y1\n");
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const DeltaRect &r = rects[i];
+    fprintf(csv, "%6d, %6d, %6d, %6d, %6d, %6d, %6d\n", fbegin + r.index * fstride, r.key ? 1 : 0,
+                 static_cast<int>(i), r.box.x0, r.box.y0, r.box.x1, r.box.y1);
+  }
+  fclose(csv);
+}
+
+
+} // namespace animtk
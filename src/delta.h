@@ -0,0 +1,91 @@
+/* Delta output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_DELTA_H
+#define ANIMTK_DELTA_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Delta rectangles
+// ============================================================================
+
+/// Region of a cropped frame which is written as a separate image
+///
+/// The region of a keyframe is the whole cropped frame. The regions of other
+/// frames contain the pixels which differ from the previous cropped frame.
+struct DeltaRect
+{
+  int         index; ///< Position of frame in the sequence.
+  bool        key;   ///< Whether the frame is a keyframe.
+  BoundingBox box;   ///< Region of the cropped frame.
+
+  DeltaRect() : index(0), key(false) {}
+  DeltaRect(int index, bool key, const BoundingBox &box) : index(index), key(key), box(box) {}
+};
+
+/// Delta rectangles of all frames of an image sequence in order
+typedef std::vector<DeltaRect> DeltaRects;
+
+/// Determine a small set of rectangles which contain all pixels which differ
+/// between two frames of the same size
+///
+/// Rows with changed pixels are grouped into bands which are separated by more
+/// than \p gap unchanged rows. Each band is split likewise at columns without
+/// changes, and each part is shrunk to the rows with changes. If this yields
+/// more than \p max rectangles, the bounding box of all changes is used.
+///
+/// \returns Disjoint rectangles, none if the frames are identical.
+BoundingBoxes changed_regions(const Frame &prev, const Frame &frame, int gap = 8, int max = 16);
+
+/// Determine delta rectangles of the frames of a cropped image sequence
+///
+/// The first frame, every \p keyframes-th frame thereafter, and each frame
+/// whose size differs from the previous frame are keyframes. Frames which are
+/// identical to the previous frame have no rectangle.
+///
+/// \param frames    Cropped image sequence.
+/// \param keyframes Interval of keyframes. Only the first frame and frames of
+///                  different size are keyframes if not positive.
+DeltaRects delta_rects(const Sequence &frames, int keyframes = 30);
+
+/// Write the region of each delta rectangle to its own image file
+///
+/// The image files are numbered by the position of the rectangle in \p rects,
+/// starting at zero, as by CImgList::save() for sequences of more than one image.
+///
+/// \throws cimg_library::CImgIOException if an image could not be written.
+void write_delta(const Sequence &frames, const DeltaRects &rects, const char *fname, FramePool &pool);
+
+/// Write table of delta rectangles in CSV format
+///
+/// Each row lists the frame number, whether it is a keyframe, the number of
+/// the image file written by write_delta(), and the rectangle.
+///
+/// \throws cimg_library::CImgIOException if file could not be opened.
+void write_delta_csv(const char *fname, const DeltaRects &rects, int fbegin = 0, int fstride = 1);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_DELTA_H
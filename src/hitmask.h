@@ -0,0 +1,235 @@
+/* Hit-test masks of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This header has no dependencies on the rest of The Animation Toolkit, such
+// that it can be copied into the sources of a game which loads the masks
+// written by crop-frames --masks.
+
+#ifndef ANIMTK_HITMASK_H
+#define ANIMTK_HITMASK_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+
+namespace animtk {
+
+
+// ============================================================================
+// File format
+// ============================================================================
+
+// A file of hit-test masks consists of a header, a table of frames, and the
+// masks of the frames. All integers are little-endian.
+//
+//   header: "ATKM", uint32 version, uint32 number of frames, uint32 threshold
+//   table:  int32 x, int32 y, uint32 width, uint32 height, uint32 offset
+//           of each frame, where (x, y) is the top-left corner of the crop
+//           region in the input frame and offset the position of the mask
+//   mask:   summary of 8x8 cells followed by one bit per pixel, both stored
+//           row by row with the least significant bit of each byte first
+//
+// A bit of the mask is set if the alpha value of the pixel is greater than the
+// threshold. A bit of the summary is set if any bit of its cell is set, where
+// a cell of 8x8 pixels corresponds to one byte in each of eight mask rows.
+
+/// Size of the file header in bytes
+const int HITMASK_HEADER_SIZE = 16;
+
+/// Size of the table entry of a frame in bytes
+const int HITMASK_ENTRY_SIZE = 20;
+
+/// Version of the file format
+const int HITMASK_VERSION = 1;
+
+/// Width and height of the cells of the summary
+const int HITMASK_CELL_SIZE = 8;
+
+/// Size of the mask of a frame including its summary in bytes
+inline size_t hitmask_size(int width, int height)
+{
+  const size_t cw = size_t(width + 7) / 8, ch = size_t(height + 7) / 8;
+  return ch * ((cw + 7) / 8) + size_t(height) * cw;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+/// Hit-test masks of the cropped frames of an image sequence
+///
+/// Coordinates are relative to the cropped frame. The properties of a frame
+/// require 0 <= frame < frames(), while queries of other frames miss.
+class HitMasks
+{
+public:
+
+  /// Constructor
+  HitMasks() : _data(NULL), _size(0), _frames(0) {}
+
+  /// Load masks from file
+  ///
+  /// \returns Whether the file was read and is valid.
+  bool load(const char *fname)
+  {
+    clear();
+    FILE *fp = fopen(fname, "rb");
+    if (!fp) return false;
+    unsigned char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) _buffer.insert(_buffer.end(), buffer, buffer + n);
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    if (!ok || _buffer.empty() || !assign(&_buffer[0], _buffer.size())) {
+      std::vector<unsigned char>().swap(_buffer);
+      return false;
+    }
+    return true;
+  }
+
+  /// Use masks in memory, e.g., of a memory-mapped file, which is not copied
+  ///
+  /// \returns Whether the data is valid.
+  bool assign(const unsigned char *data, size_t size)
+  {
+    _data = data, _size = size, _frames = 0;
+    if (size < size_t(HITMASK_HEADER_SIZE) || data[0] != 'A' || data[1] != 'T' || data[2] != 'K' || data[3] != 'M' ||
+        u32(data + 4) != unsigned(HITMASK_VERSION)) {
+      _data = NULL, _size = 0;
+      return false;
+    }
+    const size_t n = u32(data + 8);
+    if (n > (size - HITMASK_HEADER_SIZE) / HITMASK_ENTRY_SIZE) {
+      _data = NULL, _size = 0;
+      return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      const unsigned char *e = data + HITMASK_HEADER_SIZE + i * HITMASK_ENTRY_SIZE;
+      const unsigned int   w = u32(e + 8), h = u32(e + 12), offset = u32(e + 16);
+      if (w > 0x7fff0000u || h > 0x7fff0000u || offset > size || hitmask_size(int(w), int(h)) > size - offset) {
+        _data = NULL, _size = 0;
+        return false;
+      }
+    }
+    _frames = int(n);
+    return true;
+  }
+
+  /// Release masks
+  void clear()
+  {
+    std::vector<unsigned char>().swap(_buffer);
+    _data = NULL, _size = 0, _frames = 0;
+  }
+
+  /// Number of frames
+  int frames() const { return _frames; }
+
+  /// Alpha value above which pixels are hit
+  int threshold() const { return _data ? int(u32(_data + 12)) : 0; }
+
+  /// Left edge of crop region of frame in the input frame
+  int x(int frame) const { return int(u32(entry(frame))); }
+
+  /// Top edge of crop region of frame in the input frame
+  int y(int frame) const { return int(u32(entry(frame) + 4)); }
+
+  /// Width of cropped frame
+  int width(int frame) const { return int(u32(entry(frame) + 8)); }
+
+  /// Height of cropped frame
+  int height(int frame) const { return int(u32(entry(frame) + 12)); }
+
+  /// Whether pixel (x, y) of frame is hit
+  bool hit(int frame, int x, int y) const
+  {
+    if (frame < 0 || frame >= _frames) return false;
+    const int w = width(frame), h = height(frame);
+    if (x < 0 || y < 0 || x >= w || y >= h) return false;
+    return (mask(frame)[size_t(y) * ((w + 7) / 8) + (x >> 3)] >> (x & 7)) & 1;
+  }
+
+  /// Whether any pixel of the rectangle [x0, x1] x [y0, y1] of frame is hit
+  ///
+  /// Cells of the summary which are empty are skipped, and the pixels of other
+  /// cells are tested eight at a time.
+  bool hit(int frame, int x0, int y0, int x1, int y1) const
+  {
+    if (frame < 0 || frame >= _frames) return false;
+    const int w = width(frame), h = height(frame);
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= w) x1 = w - 1;
+    if (y1 >= h) y1 = h - 1;
+    if (x0 > x1 || y0 > y1) return false;
+    const size_t         cw      = size_t(w + 7) / 8;
+    const size_t         sstride = (cw + 7) / 8;
+    const unsigned char *summary = _data + u32(entry(frame) + 16);
+    const unsigned char *bits    = mask(frame);
+    for (int cy = y0 >> 3; cy <= (y1 >> 3); ++cy) {
+      const unsigned char *srow = summary + size_t(cy) * sstride;
+      const int ya = (cy * 8 > y0 ? cy * 8 : y0), yb = (cy * 8 + 7 < y1 ? cy * 8 + 7 : y1);
+      for (int cx = x0 >> 3; cx <= (x1 >> 3); ++cx) {
+        if (!((srow[cx >> 3] >> (cx & 7)) & 1)) continue;
+        const int xa = (cx * 8 > x0 ? cx * 8 : x0) & 7, xb = (cx * 8 + 7 < x1 ? cx * 8 + 7 : x1) & 7;
+        const unsigned char m = static_cast<unsigned char>((0xff >> (7 - xb)) & (0xff << xa));
+        for (int y = ya; y <= yb; ++y) {
+          if (bits[size_t(y) * cw + cx] & m) return true;
+        }
+      }
+    }
+    return false;
+  }
+
+private:
+
+  /// Read little-endian 32-bit integer
+  static unsigned int u32(const unsigned char *p)
+  {
+    return unsigned(p[0]) | (unsigned(p[1]) << 8) | (unsigned(p[2]) << 16) | (unsigned(p[3]) << 24);
+  }
+
+  /// Table entry of frame
+  const unsigned char *entry(int frame) const
+  {
+    return _data + HITMASK_HEADER_SIZE + size_t(frame) * HITMASK_ENTRY_SIZE;
+  }
+
+  /// Bits of the pixels of frame, which follow the summary
+  const unsigned char *mask(int frame) const
+  {
+    const size_t cw = size_t(width(frame) + 7) / 8, ch = size_t(height(frame) + 7) / 8;
+    return _data + u32(entry(frame) + 16) + ch * ((cw + 7) / 8);
+  }
+
+  // Copies would refer to the buffer of the original
+  HitMasks(const HitMasks &);
+  HitMasks &operator =(const HitMasks &);
+
+  std::vector<unsigned char> _buffer; ///< Contents of loaded file.
+  const unsigned char       *_data;   ///< Masks in memory.
+  size_t                     _size;   ///< Size of masks in bytes.
+  int                        _frames; ///< Number of frames.
+};
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_HITMASK_H
@@ -0,0 +1,185 @@
+/* Polygon trimming of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "hull.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Cross product of the vectors from o to a and from o to b
+static inline double cross(const Vertex &o, const Vertex &a, const Vertex &b)
+{
+  return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// ----------------------------------------------------------------------------
+/// Order of vertices by their x and then y coordinate
+static bool lexicographic(const Vertex &a, const Vertex &b)
+{
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+// ----------------------------------------------------------------------------
+/// Convex hull of points using Andrew's monotone chain algorithm
+static Polygon monotone_chain(vector<Vertex> &points)
+{
+  sort(points.begin(), points.end(), lexicographic);
+  const int n = static_cast<int>(points.size());
+  Polygon hull(2 * n);
+  int k = 0;
+  for (int i = 0; i < n; ++i) {
+    while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.) --k;
+    hull[k++] = points[i];
+  }
+  for (int i = n - 2, t = k + 1; i >= 0; --i) {
+    while (k >= t && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.) --k;
+    hull[k++] = points[i];
+  }
+  hull.resize(k > 1 ? k - 1 : k);
+  return hull;
+}
+
+// ----------------------------------------------------------------------------
+/// Intersection of the edge before vertex i, extended beyond vertex i, with
+/// the edge after vertex i + 1, extended before vertex i + 1
+///
+/// \returns Whether the extended edges intersect.
+static bool extend_edges(const Polygon &p, int i, Vertex &v)
+{
+  const int n = static_cast<int>(p.size());
+  const Vertex &a = p[(i + n - 1) % n], &b = p[i];
+  const Vertex &c = p[(i + 1) % n],     &d = p[(i + 2) % n];
+  const double d1x = b.x - a.x, d1y = b.y - a.y;
+  const double d2x = c.x - d.x, d2y = c.y - d.y;
+  const double det = d1x * d2y - d1y * d2x;
+  if (det == 0.) return false;
+  // Solve b + s * d1 = c + t * d2 for s and t
+  const double s = ((c.x - b.x) * d2y - (c.y - b.y) * d2x) / det;
+  const double t = ((c.x - b.x) * d1y - (c.y - b.y) * d1x) / det;
+  if (s <= 0. || t <= 0.) return false;
+  v = Vertex(b.x + s * d1x, b.y + s * d1y);
+  return true;
+}
+
+// ============================================================================
+// Convex hulls
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+Polygon convex_hull(const Frame &frame, const BoundingBox &box, int max_vertices)
+{
+  if (frame.is_empty() || frame.depth() > 1) return Polygon();
+  // Corners of outermost foreground pixels of each row
+  const int x0 = cimg::max(box.x0, 0), x1 = cimg::min(box.x1, frame.width()  - 1);
+  const int y0 = cimg::max(box.y0, 0), y1 = cimg::min(box.y1, frame.height() - 1);
+  vector<Vertex> points;
+  for (int y = y0; y <= y1; ++y) {
+    int l = x1 + 1, r = x0 - 1;
+    for (int c = 0; c < frame.spectrum(); ++c) {
+      const unsigned char *p = frame.data(0, y, 0, c);
+      const unsigned char  v = frame(0, 0, 0, c);
+      for (int x = x0; x < l; ++x) if (p[x] != v) { l = x; break; }
+      for (int x = x1; x > r; --x) if (p[x] != v) { r = x; break; }
+    }
+    if (l > r) continue;
+    const double u0 = l - box.x0, u1 = r + 1 - box.x0;
+    const double v0 = y - box.y0, v1 = y + 1 - box.y0;
+    points.push_back(Vertex(u0, v0));
+    points.push_back(Vertex(u0, v1));
+    points.push_back(Vertex(u1, v0));
+    points.push_back(Vertex(u1, v1));
+  }
+  if (points.empty()) return Polygon();
+  Polygon hull = monotone_chain(points);
+  // Remove edges which add the least area until few enough vertices remain
+  const double w = box.width(), h = box.height();
+  while (static_cast<int>(hull.size()) > cimg::max(max_vertices, 3)) {
+    const int n = static_cast<int>(hull.size());
+    int       best = -1;
+    double    area = 0.;
+    Vertex    vertex, v;
+    for (int i = 0; i < n; ++i) {
+      if (!extend_edges(hull, i, v)) continue;
+      if (v.x < 0. || v.x > w || v.y < 0. || v.y > h) continue;
+      const double a = .5 * cimg::abs(cross(v, hull[i], hull[(i + 1) % n]));
+      if (best < 0 || a < area) best = i, area = a, vertex = v;
+    }
+    if (best < 0) break;
+    hull[best] = vertex;
+    hull.erase(hull.begin() + (best + 1) % n);
+  }
+  return hull;
+}
+
+// ----------------------------------------------------------------------------
+Polygons convex_hulls(const Sequence &frames, const BoundingBoxes &boxes, int max_vertices)
+{
+  if (boxes.size() != frames.size()) {
+    throw CImgArgumentException("convex_hulls(): Number of bounding boxes (%u) does not match number of frames (%u)",
+                                (unsigned int)boxes.size(), frames.size());
+  }
+  Polygons polygons(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    polygons[frame] = convex_hull(frames[frame], boxes[frame], max_vertices);
+  }
+  return polygons;
+}
+
+// ----------------------------------------------------------------------------
+void write_hulls(const char *fname, const Polygons &polygons, int fbegin, int fstride, bool append)
+{
+  FILE *fp = NULL;
+  if (append) {
+    fp = fopen(fname, "r");
+    if (fp) {
+      fclose(fp);
+      fp = fopen(fname, "a");
+    }
+  }
+  if (!fp) {
+    fp = fopen(fname, "w");
+    if (fp) fprintf(fp, " frame,      n, vertices (x, y)\n");
+  }
+  if (!fp) {
+    throw CImgIOException("Failed to open polygon table %s!", fname);
+  }
+  for (size_t frame = 0; frame < polygons.size(); ++frame) {
+    const Polygon &p = polygons[frame];
+    fprintf(fp, "%6d, %6d", fbegin + int(frame) * fstride, int(p.size()));
+    for (size_t i = 0; i < p.size(); ++i) fprintf(fp, ", %.2f, %.2f", p[i].x, p[i].y);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+}
+
+
+} // namespace animtk
@@ -0,0 +1,80 @@
+/* Polygon trimming of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_HULL_H
+#define ANIMTK_HULL_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Convex hulls
+// ============================================================================
+
+/// Vertex of a polygon
+///
+/// Vertices are given in pixel corner coordinates relative to the crop region,
+/// i.e., the pixel (x, y) of the cropped frame covers [x, x + 1] x [y, y + 1].
+struct Vertex
+{
+  double x, y;
+
+  Vertex() : x(0.), y(0.) {}
+  Vertex(double x, double y) : x(x), y(y) {}
+};
+
+/// Convex polygon given by its vertices in clockwise order as displayed,
+/// i.e., with the y axis pointing down
+typedef std::vector<Vertex> Polygon;
+
+/// Polygons of the frames of an image sequence
+typedef std::vector<Polygon> Polygons;
+
+/// Determine simplified convex hull of the foreground pixels of a crop region
+///
+/// The foreground pixels differ from the background color, which is guessed
+/// as by analyze(). The convex hull of their pixel squares is simplified to at
+/// most \p max_vertices vertices by repeatedly replacing the edge whose removal
+/// adds the least area by the intersection of its neighboring edges, as long
+/// as this intersection lies inside the crop region. The polygon thus contains
+/// all foreground pixels, but may have more vertices if the crop region does
+/// not leave enough room.
+///
+/// \returns Polygon of at least 3 vertices, or none if the crop region of the
+///          frame contains no foreground pixels.
+Polygon convex_hull(const Frame &frame, const BoundingBox &box, int max_vertices = 8);
+
+/// Determine simplified convex hulls of the crop regions of all frames
+Polygons convex_hulls(const Sequence &frames, const BoundingBoxes &boxes, int max_vertices = 8);
+
+/// Write polygons to CSV table
+///
+/// Each row lists the frame number, the number of vertices, and the x and y
+/// coordinates of each vertex.
+///
+/// \throws cimg_library::CImgIOException if file could not be opened.
+void write_hulls(const char *fname, const Polygons &polygons, int fbegin = 0, int fstride = 1, bool append = false);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_HULL_H
@@ -0,0 +1,118 @@
+/* Hit-test mask output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mask.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Append little-endian 32-bit integer
+static inline void put_u32(vector<unsigned char> &data, unsigned int v)
+{
+  for (int i = 0; i < 4; ++i) data.push_back(static_cast<unsigned char>(v >> (8 * i)));
+}
+
+// ============================================================================
+// Hit-test masks
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+void pack_mask(const Frame &frame, int threshold, vector<unsigned char> &data)
+{
+  const int    w       = frame.width();
+  const int    h       = frame.height();
+  const size_t cw      = size_t(w + 7) / 8;
+  const size_t ch      = size_t(h + 7) / 8;
+  const size_t sstride = (cw + 7) / 8;
+  data.assign(hitmask_size(w, h), 0);
+  if (data.empty()) return;
+  unsigned char *summary = &data[0];
+  unsigned char *bits    = summary + ch * sstride;
+  const int      alpha   = (frame.spectrum() == 2 ? 1 : (frame.spectrum() >= 4 ? 3 : -1));
+  for (int y = 0; y < h; ++y) {
+    unsigned char *row = bits + size_t(y) * cw;
+    if (alpha < 0) {
+      for (int x = 0; x < w; ++x) row[x >> 3] |= static_cast<unsigned char>(1 << (x & 7));
+    } else {
+      const unsigned char *a = frame.data(0, y, 0, alpha);
+      for (int x = 0; x < w; ++x) {
+        if (a[x] > threshold) row[x >> 3] |= static_cast<unsigned char>(1 << (x & 7));
+      }
+    }
+    // Each byte of a mask row is one cell of the summary
+    unsigned char *srow = summary + size_t(y / HITMASK_CELL_SIZE) * sstride;
+    for (size_t cx = 0; cx < cw; ++cx) {
+      if (row[cx]) srow[cx >> 3] |= static_cast<unsigned char>(1 << (cx & 7));
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+void write_masks(const char *fname, const Sequence &frames, const BoundingBoxes &boxes, int threshold)
+{
+  // Pack masks in parallel
+  vector<vector<unsigned char> > masks(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    pack_mask(frames[frame], threshold, masks[frame]);
+  }
+  // Header and table of frames
+  vector<unsigned char> header;
+  header.push_back('A'), header.push_back('T'), header.push_back('K'), header.push_back('M');
+  put_u32(header, HITMASK_VERSION);
+  put_u32(header, frames.size());
+  put_u32(header, static_cast<unsigned int>(threshold));
+  size_t offset = HITMASK_HEADER_SIZE + size_t(frames.size()) * HITMASK_ENTRY_SIZE;
+  cimglist_for(frames,frame) {
+    const BoundingBox box = (size_t(frame) < boxes.size() ? boxes[frame] : BoundingBox());
+    put_u32(header, static_cast<unsigned int>(box.x0));
+    put_u32(header, static_cast<unsigned int>(box.y0));
+    put_u32(header, frames[frame].width());
+    put_u32(header, frames[frame].height());
+    put_u32(header, static_cast<unsigned int>(offset));
+    offset += masks[frame].size();
+  }
+  if (offset > 0xffffffffu) {
+    throw CImgIOException("Hit-test masks too large for file %s!", fname);
+  }
+  FILE *fp = fopen(fname, "wb");
+  if (!fp) {
+    throw CImgIOException("Failed to open mask file %s for writing!", fname);
+  }
+  bool ok = (fwrite(&header[0], 1, header.size(), fp) == header.size());
+  for (size_t i = 0; ok && i < masks.size(); ++i) {
+    ok = masks[i].empty() || fwrite(&masks[i][0], 1, masks[i].size(), fp) == masks[i].size();
+  }
+  if (fclose(fp) != 0 || !ok) {
+    throw CImgIOException("Failed to write mask file %s!", fname);
+  }
+}
+
+
+} // namespace animtk
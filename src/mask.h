@@ -0,0 +1,59 @@
+/* Hit-test mask output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_MASK_H
+#define ANIMTK_MASK_H
+
+#include "animtk.h"
+#include "hitmask.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Hit-test masks
+// ============================================================================
+
+/// Pack hit-test mask of frame including its summary of 8x8 cells
+///
+/// Pixels whose alpha value is greater than \p threshold are hit, all pixels
+/// of frames without alpha channel are hit.
+///
+/// \param[in]  frame     Cropped frame.
+/// \param[in]  threshold Alpha threshold.
+/// \param[out] data      Mask of hitmask_size() bytes as stored in the file.
+void pack_mask(const Frame &frame, int threshold, std::vector<unsigned char> &data);
+
+/// Write hit-test masks of cropped frames to a binary file (see hitmask.h)
+///
+/// The masks are packed by multiple threads and can be queried by HitMasks.
+///
+/// \param fname     Output file name.
+/// \param frames    Cropped frames.
+/// \param boxes     Crop regions of the frames.
+/// \param threshold Alpha value above which pixels are hit.
+///
+/// \throws cimg_library::CImgIOException if file could not be written.
+void write_masks(const char *fname, const Sequence &frames, const BoundingBoxes &boxes, int threshold = 0);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_MASK_H
@@ -0,0 +1,368 @@
+/* Indexed color output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "palette.h"
+#include "pool.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Distinct color and its number of pixels
+struct Bin
+{
+  unsigned int color; ///< RGBA color packed as 0xAABBGGRR, zero if transparent.
+  unsigned int count; ///< Number of pixels.
+};
+
+/// Color premultiplied by alpha and its number of pixels
+struct Point
+{
+  int          p[4]; ///< Premultiplied RGB and alpha.
+  unsigned int count; ///< Number of pixels.
+};
+
+/// Cluster of points of median cut
+struct Cluster
+{
+  size_t begin, end; ///< Range of points.
+  int    axis;       ///< Channel of largest range.
+  double score;      ///< Range times number of pixels, zero if not splittable.
+};
+
+/// Palette colors premultiplied by alpha, stored by channel
+struct Premultiplied
+{
+  int n;           ///< Number of colors.
+  int c[4][256];   ///< Channels of colors.
+};
+
+/// Order of points by one of their channels
+struct ByChannel
+{
+  int axis;
+  ByChannel(int axis) : axis(axis) {}
+  bool operator ()(const Point &a, const Point &b) const { return a.p[axis] < b.p[axis]; }
+};
+
+// ----------------------------------------------------------------------------
+/// Get packed RGBA color of pixel i of frame
+static inline unsigned int color_at(const Frame &frame, size_t i)
+{
+  const size_t         n  = size_t(frame.width()) * frame.height();
+  const int            nc = frame.spectrum();
+  const unsigned char *p  = frame.data();
+  const unsigned int   r  = p[i];
+  const unsigned int   g  = nc < 3 ? r : p[i + n];
+  const unsigned int   b  = nc < 3 ? r : p[i + 2 * n];
+  const unsigned int   a  = nc == 2 ? p[i + n] : (nc >= 4 ? p[i + 3 * n] : 255);
+  return a == 0 ? 0 : (r | (g << 8) | (b << 16) | (a << 24));
+}
+
+// ----------------------------------------------------------------------------
+/// Premultiply packed color by its alpha
+static inline void premultiply(unsigned int color, int *p)
+{
+  const int a = static_cast<int>(color >> 24);
+  for (int c = 0; c < 3; ++c) p[c] = (static_cast<int>((color >> (8 * c)) & 255) * a + 127) / 255;
+  p[3] = a;
+}
+
+// ----------------------------------------------------------------------------
+/// Count distinct colors of frame
+///
+/// \returns Bins ordered by color.
+static void count_colors(const Frame &frame, vector<Bin> &bins)
+{
+  const size_t n = size_t(frame.width()) * frame.height();
+  vector<unsigned int> colors(n);
+  for (size_t i = 0; i < n; ++i) colors[i] = color_at(frame, i);
+  sort(colors.begin(), colors.end());
+  bins.clear();
+  for (size_t i = 0; i < n; ) {
+    size_t j = i + 1;
+    while (j < n && colors[j] == colors[i]) ++j;
+    Bin bin;
+    bin.color = colors[i];
+    bin.count = static_cast<unsigned int>(j - i);
+    bins.push_back(bin);
+    i = j;
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Order of bins by color
+static bool by_color(const Bin &a, const Bin &b)
+{
+  return a.color < b.color;
+}
+
+// ----------------------------------------------------------------------------
+/// Order of palette colors which puts colors which are not opaque first
+static bool transparent_first(unsigned int a, unsigned int b)
+{
+  return (a >> 24) < (b >> 24) || ((a >> 24) == (b >> 24) && a < b);
+}
+
+// ----------------------------------------------------------------------------
+/// Determine channel of largest range and score of cluster
+static void measure(const vector<Point> &points, Cluster &cluster)
+{
+  int    lo[4] = {255, 255, 255, 255}, hi[4] = {0, 0, 0, 0};
+  double count = 0.;
+  for (size_t i = cluster.begin; i < cluster.end; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      lo[c] = cimg::min(lo[c], points[i].p[c]);
+      hi[c] = cimg::max(hi[c], points[i].p[c]);
+    }
+    count += points[i].count;
+  }
+  cluster.axis = 0;
+  for (int c = 1; c < 4; ++c) if (hi[c] - lo[c] > hi[cluster.axis] - lo[cluster.axis]) cluster.axis = c;
+  cluster.score = (hi[cluster.axis] - lo[cluster.axis]) * count;
+}
+
+// ----------------------------------------------------------------------------
+/// Index of nearest palette color
+static inline int nearest(const Premultiplied &palette, const int *p)
+{
+  // Distances to all colors first, which the compiler vectorizes
+  int d[256];
+  for (int k = 0; k < palette.n; ++k) {
+    const int dr = palette.c[0][k] - p[0];
+    const int dg = palette.c[1][k] - p[1];
+    const int db = palette.c[2][k] - p[2];
+    const int da = palette.c[3][k] - p[3];
+    d[k] = dr * dr + dg * dg + db * db + da * da;
+  }
+  int best = 0;
+  for (int k = 1; k < palette.n; ++k) if (d[k] < d[best]) best = k;
+  return best;
+}
+
+// ----------------------------------------------------------------------------
+/// Premultiply colors of palette given as n x 1 RGBA frame or packed colors
+static void premultiply(const vector<unsigned int> &colors, Premultiplied &palette)
+{
+  int p[4];
+  palette.n = static_cast<int>(colors.size());
+  for (int k = 0; k < palette.n; ++k) {
+    premultiply(colors[k], p);
+    for (int c = 0; c < 4; ++c) palette.c[c][k] = p[c];
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Cluster points by median cut and k-means
+///
+/// \returns Packed colors of the cluster means.
+static vector<unsigned int> cluster(vector<Point> &points, int k)
+{
+  // Median cut
+  vector<Cluster> clusters(1);
+  clusters[0].begin = 0;
+  clusters[0].end   = points.size();
+  measure(points, clusters[0]);
+  while (static_cast<int>(clusters.size()) < k) {
+    size_t s = 0;
+    for (size_t i = 1; i < clusters.size(); ++i) if (clusters[i].score > clusters[s].score) s = i;
+    if (clusters[s].score <= 0.) break;
+    Cluster &a = clusters[s];
+    sort(points.begin() + a.begin, points.begin() + a.end, ByChannel(a.axis));
+    double total = 0., sum = 0.;
+    for (size_t i = a.begin; i < a.end; ++i) total += points[i].count;
+    size_t m = a.begin;
+    while (m + 1 < a.end && sum + points[m].count < total / 2.) sum += points[m++].count;
+    m = cimg::max(a.begin + 1, cimg::min(m + 1, a.end - 1));
+    Cluster b;
+    b.begin = m;
+    b.end   = a.end;
+    a.end   = m;
+    measure(points, a);
+    measure(points, b);
+    clusters.push_back(b);
+  }
+  // Means of clusters, refined by k-means
+  const int    n = static_cast<int>(clusters.size());
+  vector<int>  label(points.size());
+  for (int j = 0; j < n; ++j) {
+    for (size_t i = clusters[j].begin; i < clusters[j].end; ++i) label[i] = j;
+  }
+  vector<unsigned int> colors(n);
+  Premultiplied        means;
+  for (int iter = 0; iter < 3; ++iter) {
+    if (iter > 0) {
+      for (size_t i = 0; i < points.size(); ++i) label[i] = nearest(means, points[i].p);
+    }
+    vector<double> sum(4 * n, 0.), count(n, 0.);
+    for (size_t i = 0; i < points.size(); ++i) {
+      for (int c = 0; c < 4; ++c) sum[4 * label[i] + c] += double(points[i].p[c]) * points[i].count;
+      count[label[i]] += points[i].count;
+    }
+    means.n = n;
+    for (int j = 0; j < n; ++j) {
+      if (count[j] == 0.) continue;
+      const double a = sum[4 * j + 3] / count[j];
+      unsigned int color = 0;
+      if (a >= .5) {
+        color = static_cast<unsigned int>(cimg::min(255., a + .5)) << 24;
+        for (int c = 0; c < 3; ++c) {
+          const double v = sum[4 * j + c] / count[j] * 255. / a;
+          color |= static_cast<unsigned int>(cimg::min(255., v + .5)) << (8 * c);
+        }
+      }
+      colors[j] = color;
+      for (int c = 0; c < 4; ++c) means.c[c][j] = static_cast<int>(sum[4 * j + c] / count[j] + .5);
+    }
+  }
+  return colors;
+}
+
+// ============================================================================
+// Palettes
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+bool is_png(const string &fname)
+{
+  return cimg::strcasecmp(cimg::split_filename(fname.c_str()), "png") == 0;
+}
+
+// ----------------------------------------------------------------------------
+Frame build_palette(const Sequence &frames, int ncolors)
+{
+  ncolors = cimg::max(1, cimg::min(ncolors, MAX_PALETTE_COLORS));
+  // Distinct colors of all frames
+  vector<vector<Bin> > counts(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    if (frames[frame].depth() > 1) {
+      count_colors(frames[frame].get_slice(0), counts[frame]);
+    } else {
+      count_colors(frames[frame], counts[frame]);
+    }
+  }
+  vector<Bin> bins;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    bins.insert(bins.end(), counts[i].begin(), counts[i].end());
+    vector<Bin>().swap(counts[i]);
+  }
+  sort(bins.begin(), bins.end(), by_color);
+  size_t n = 0;
+  for (size_t i = 0; i < bins.size(); ++i) {
+    if (n > 0 && bins[n - 1].color == bins[i].color) bins[n - 1].count += bins[i].count;
+    else bins[n++] = bins[i];
+  }
+  bins.resize(n);
+  // Exact palette if few enough colors, otherwise cluster colors, keeping
+  // fully transparent pixels exact
+  vector<unsigned int> colors;
+  if (static_cast<int>(bins.size()) <= ncolors) {
+    for (size_t i = 0; i < bins.size(); ++i) colors.push_back(bins[i].color);
+  } else {
+    vector<Point> points;
+    for (size_t i = 0; i < bins.size(); ++i) {
+      if (bins[i].color == 0) continue;
+      Point point;
+      premultiply(bins[i].color, point.p);
+      point.count = bins[i].count;
+      points.push_back(point);
+    }
+    const bool transparent = (points.size() < bins.size());
+    colors = cluster(points, ncolors - (transparent ? 1 : 0));
+    if (transparent) colors.push_back(0);
+  }
+  sort(colors.begin(), colors.end(), transparent_first);
+  colors.erase(unique(colors.begin(), colors.end()), colors.end());
+  Frame palette(static_cast<int>(colors.size()), 1, 1, 4);
+  for (int k = 0; k < palette.width(); ++k) {
+    for (int c = 0; c < 4; ++c) palette(k, 0, 0, c) = static_cast<unsigned char>(colors[k] >> (8 * c));
+  }
+  return palette;
+}
+
+// ----------------------------------------------------------------------------
+Frame map_palette(const Frame &frame, const Frame &palette)
+{
+  if (palette.is_empty() || palette.width() > MAX_PALETTE_COLORS || palette.spectrum() != 4) {
+    throw CImgArgumentException("map_palette(): Palette must be n x 1 RGBA image with 1 <= n <= %d colors",
+                                MAX_PALETTE_COLORS);
+  }
+  vector<unsigned int> colors(palette.width());
+  for (int k = 0; k < palette.width(); ++k) {
+    colors[k] = palette(k, 0, 0, 3) == 0 ? 0 : (palette(k, 0, 0, 0)       | (palette(k, 0, 0, 1) << 8) |
+                                                (palette(k, 0, 0, 2) << 16) | (palette(k, 0, 0, 3) << 24));
+  }
+  Premultiplied pm;
+  premultiply(colors, pm);
+  // Cache of recently mapped colors, flat-shaded frames have few colors,
+  // a key of one is not a packed color as transparent colors are zero
+  static const int CACHE_BITS = 12;
+  vector<unsigned int>  key  (1 << CACHE_BITS, 1);
+  vector<unsigned char> value(1 << CACHE_BITS, 0);
+  Frame        indices(frame.width(), frame.height(), 1, 1);
+  const size_t n = size_t(frame.width()) * frame.height();
+  int          p[4];
+  for (size_t i = 0; i < n; ++i) {
+    const unsigned int color = color_at(frame, i);
+    const unsigned int h     = (color * 2654435761u) >> (32 - CACHE_BITS);
+    if (key[h] != color) {
+      premultiply(color, p);
+      key  [h] = color;
+      value[h] = static_cast<unsigned char>(nearest(pm, p));
+    }
+    indices[i] = value[h];
+  }
+  return indices;
+}
+
+// ----------------------------------------------------------------------------
+void write_indexed(const Sequence &frames, const Frame &palette, const char *fname, FramePool &pool)
+{
+  // Map frames in parallel, but write files in order
+  Sequence indices(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    if (!frames[frame].is_empty() && frames[frame].depth() == 1) {
+      map_palette(frames[frame], palette).move_to(indices[frame]);
+    }
+  }
+  char ofname[1024];
+  cimglist_for(frames,frame) {
+    if (frames.size() > 1) cimg::number_filename(fname, frame, 6, ofname);
+    const char *name = (frames.size() > 1 ? ofname : fname);
+    if (indices[frame].is_empty()) pool.save(frames[frame], name);
+    else                           pool.save_indexed(indices[frame], palette, name);
+  }
+}
+
+
+} // namespace animtk
@@ -0,0 +1,71 @@
+/* Indexed color output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_PALETTE_H
+#define ANIMTK_PALETTE_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Palettes
+// ============================================================================
+
+/// Maximum number of colors of a palette of indexed PNG files
+const int MAX_PALETTE_COLORS = 256;
+
+/// Whether the file name extension of an output is .png
+bool is_png(const std::string &fname);
+
+/// Build palette shared by all frames of an image sequence
+///
+/// The distinct colors of all frames are counted, where all fully transparent
+/// pixels are counted as one color. If there are at most \p ncolors distinct
+/// colors, the palette consists of exactly these colors. Otherwise, the colors
+/// are clustered by median cut, which repeatedly splits the cluster with the
+/// largest range times number of pixels at the weighted median of its longest
+/// side, followed by k-means iterations. Clustering uses colors premultiplied
+/// by alpha, such that differences in the colors of mostly transparent pixels
+/// matter less. Gray frames and frames without alpha channel are converted
+/// to RGBA.
+///
+/// \returns Colors of the palette as n x 1 frame with four channels, where n
+///          is at most \p ncolors. Colors which are not opaque come first.
+Frame build_palette(const Sequence &frames, int ncolors = MAX_PALETTE_COLORS);
+
+/// Map pixels of frame to the nearest colors of a palette
+///
+/// \returns Palette index of each pixel as frame with one channel.
+Frame map_palette(const Frame &frame, const Frame &palette);
+
+/// Write image sequence as indexed PNG files with a shared palette
+///
+/// The files are named as by CImgList::save(), i.e., numbered unless the
+/// sequence has a single frame. Frames are mapped to the palette in parallel.
+///
+/// \throws cimg_library::CImgIOException if a file could not be written.
+void write_indexed(const Sequence &frames, const Frame &palette, const char *fname, FramePool &pool);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_PALETTE_H
@@ -0,0 +1,852 @@
+/* Frame buffer pool of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "pool.h"
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+#ifndef O_BINARY
+#  define O_BINARY 0
+#endif
+#ifdef cimg_use_png
+#  include "zlib.h"
+#endif
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Enlarge vector, counting reallocations
+template <class T>
+static void grow(vector<T> &v, size_t n, unsigned long &count)
+{
+  if (v.capacity() < n) ++count;
+  if (v.size() < n) v.resize(n);
+}
+
+// ----------------------------------------------------------------------------
+/// Read whole file into buffer
+///
+/// The file is read without stdio, which allocates memory for each opened file.
+static bool read_file(const char *fname, vector<unsigned char> &buffer, size_t &size, unsigned long &count)
+{
+  const int fd = open(fname, O_RDONLY | O_BINARY);
+  if (fd < 0) return false;
+  struct stat info;
+  bool ok = (fstat(fd, &info) == 0);
+  size = 0;
+  if (ok) {
+    const size_t n = static_cast<size_t>(info.st_size);
+    grow(buffer, n + 1, count);
+    while (size < n) {
+      const long m = static_cast<long>(read(fd, &buffer[size], static_cast<unsigned int>(n - size)));
+      if (m <= 0) break;
+      size += m;
+    }
+    ok = (size == n);
+  }
+  close(fd);
+  return ok;
+}
+
+// ----------------------------------------------------------------------------
+/// Whether the rows of a frame of the given size are processed by multiple threads
+///
+/// Frames are only split when the pool is not used by the threads of an
+/// enclosing parallel region, which process different frames instead.
+static bool parallel(size_t size)
+{
+#ifdef cimg_use_openmp
+  return size >= parallel_frame_size() && !omp_in_parallel() && omp_get_max_threads() > 1;
+#else
+  return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+/// Write buffer to file
+static bool write_file(const char *fname, const unsigned char *data, size_t size)
+{
+  const int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+  if (fd < 0) return false;
+  size_t pos = 0;
+  while (pos < size) {
+    const long m = static_cast<long>(write(fd, data + pos, static_cast<unsigned int>(size - pos)));
+    if (m <= 0) break;
+    pos += m;
+  }
+  return close(fd) == 0 && pos == size;
+}
+
+// ============================================================================
+// libpng memory and I/O
+// ============================================================================
+
+/// Memory used by libpng and zlib, reused for each file
+///
+/// Memory is handed out from a single block and only released at once when
+/// the file was read or written. Requests which do not fit into the block
+/// are allocated on the heap, and the block is enlarged to the total size
+/// requested for the file before the next file is processed.
+struct PngArena
+{
+  unsigned char  *data;     ///< Preallocated block.
+  size_t          size;     ///< Size of block.
+  size_t          used;     ///< Bytes of block in use.
+  size_t          peak;     ///< Total bytes requested since last reset.
+  vector<void *>  overflow; ///< Allocations which did not fit into the block.
+  unsigned long  *count;    ///< Counter of heap allocations.
+
+  PngArena(unsigned long *count) : data(NULL), size(0), used(0), peak(0), count(count) {}
+
+  ~PngArena()
+  {
+    reset();
+    delete[] data;
+  }
+
+  void *allocate(size_t n)
+  {
+    n = (n + 15) & ~size_t(15);
+    peak += n;
+    if (used + n <= size) {
+      void *p = data + used;
+      used += n;
+      return p;
+    }
+    void *p = malloc(n);
+    if (p) overflow.push_back(p), ++(*count);
+    return p;
+  }
+
+  void release(void *p)
+  {
+    if (data <= p && p < data + size) return;
+    vector<void *>::iterator it = find(overflow.begin(), overflow.end(), p);
+    if (it != overflow.end()) overflow.erase(it), free(p);
+  }
+
+  void reset()
+  {
+    for (size_t i = 0; i < overflow.size(); ++i) free(overflow[i]);
+    overflow.clear();
+    if (peak > size) {
+      delete[] data;
+      data = new unsigned char[peak];
+      size = peak;
+      ++(*count);
+    }
+    used = peak = 0;
+  }
+};
+
+#ifdef cimg_use_png
+
+// ----------------------------------------------------------------------------
+static png_voidp arena_malloc(png_structp png_ptr, png_alloc_size_t size)
+{
+  return static_cast<PngArena *>(png_get_mem_ptr(png_ptr))->allocate(size);
+}
+
+// ----------------------------------------------------------------------------
+static void arena_free(png_structp png_ptr, png_voidp ptr)
+{
+  static_cast<PngArena *>(png_get_mem_ptr(png_ptr))->release(ptr);
+}
+
+// ----------------------------------------------------------------------------
+/// PNG file in memory
+struct PngStream
+{
+  vector<unsigned char> *buffer; ///< File contents.
+  size_t                 size;   ///< Size of file.
+  size_t                 pos;    ///< Position of next byte read.
+  unsigned long         *count;  ///< Counter of heap allocations.
+};
+
+// ----------------------------------------------------------------------------
+static void stream_read(png_structp png_ptr, png_bytep data, png_size_t n)
+{
+  PngStream &stream = *static_cast<PngStream *>(png_get_io_ptr(png_ptr));
+  if (stream.pos + n > stream.size) png_error(png_ptr, "Unexpected end of file");
+  memcpy(data, &(*stream.buffer)[stream.pos], n);
+  stream.pos += n;
+}
+
+// ----------------------------------------------------------------------------
+static void stream_write(png_structp png_ptr, png_bytep data, png_size_t n)
+{
+  PngStream &stream = *static_cast<PngStream *>(png_get_io_ptr(png_ptr));
+  grow(*stream.buffer, stream.size + n, *stream.count);
+  memcpy(&(*stream.buffer)[stream.size], data, n);
+  stream.size += n;
+}
+
+// ----------------------------------------------------------------------------
+static void stream_flush(png_structp)
+{
+}
+
+// ----------------------------------------------------------------------------
+/// Return to setjmp() point without printing the error, which is reported by
+/// CImg when it reads or writes the file again
+static void png_error_jump(png_structp png_ptr, png_const_charp)
+{
+  png_longjmp(png_ptr, 1);
+}
+
+// ============================================================================
+// Parallel PNG encoding
+// ============================================================================
+
+/// Size of the filtered image data of a strip of rows encoded by one thread
+static const size_t PNG_STRIP_SIZE = 1 << 20;
+
+/// Compressor of a thread which encodes strips of PNG image data
+struct PngDeflater
+{
+  z_stream              z;           ///< Raw deflate stream, reset for each strip.
+  bool                  init;        ///< Whether deflate stream was initialized.
+  vector<unsigned char> rows;        ///< Previous and current interleaved row.
+  vector<unsigned char> filtered;    ///< Row filtered by each filter type.
+  vector<unsigned char> data;        ///< Filtered image data of strip.
+  unsigned long         allocations; ///< Number of heap allocations.
+
+  PngDeflater() : init(false), allocations(0) { memset(&z, 0, sizeof(z)); }
+  ~PngDeflater() { if (init) deflateEnd(&z); }
+};
+
+/// Compressed strip of PNG image data
+struct PngStrip
+{
+  vector<unsigned char> data;   ///< Compressed data.
+  size_t                size;   ///< Size of compressed data.
+  uLong                 adler;  ///< Adler-32 checksum of uncompressed data.
+  uLong                 length; ///< Size of uncompressed data.
+};
+
+#endif // cimg_use_png
+
+/// Strips of PNG image data which are filtered and compressed by multiple
+/// threads
+///
+/// Each strip is compressed separately and the compressor is flushed at its
+/// end, such that the compressed strips joined together form a single zlib
+/// stream. The compressors of the threads and the memory of the strips are
+/// reused for all files.
+struct PngStrips
+{
+#ifdef cimg_use_png
+  vector<PngDeflater *> deflaters; ///< Compressors of the threads.
+  vector<PngStrip>      strips;    ///< Compressed strips of current file.
+
+  ~PngStrips()
+  {
+    for (size_t i = 0; i < deflaters.size(); ++i) delete deflaters[i];
+  }
+#endif
+};
+
+#ifdef cimg_use_png
+
+// ----------------------------------------------------------------------------
+/// Interleave channels of a row of a frame
+static void interleave(const Frame &frame, int y, unsigned char *row)
+{
+  const int W = frame.width(), C = frame.spectrum();
+  for (int c = 0; c < C; ++c) {
+    const unsigned char *ptrs = frame.data(0, y, 0, c);
+    for (int x = 0; x < W; ++x) row[x * C + c] = ptrs[x];
+  }
+}
+
+#ifdef cimg_use_openmp
+
+// ----------------------------------------------------------------------------
+/// Paeth predictor of PNG filter type 4
+static inline int paeth(int a, int b, int c)
+{
+  const int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  return pb <= pc ? b : c;
+}
+
+// ----------------------------------------------------------------------------
+/// Filter row of n bytes, choosing the filter type with the minimum sum of
+/// absolute differences as libpng does by default
+///
+/// \param[out] dst  Filter type followed by the n filtered bytes.
+/// \param[in]  cur  Current row.
+/// \param[in]  prev Previous row, all zeros for the first row of the image.
+/// \param[in]  tmp  Memory for the row filtered by each of the 5 filter types.
+static void filter(unsigned char *dst, const unsigned char *cur, const unsigned char *prev,
+                   int n, int bpp, unsigned char *tmp)
+{
+  unsigned long best = 0;
+  int           type = 0;
+  for (int f = 0; f < 5; ++f) {
+    unsigned char *out = tmp + size_t(f) * (n + 1);
+    out[0] = static_cast<unsigned char>(f);
+    ++out;
+    int i = 0;
+    switch (f) {
+      case 0: memcpy(out, cur, n); break;
+      case 1:
+        for (; i < bpp; ++i) out[i] = cur[i];
+        for (; i < n;   ++i) out[i] = cur[i] - cur[i - bpp];
+        break;
+      case 2:
+        for (; i < n; ++i) out[i] = cur[i] - prev[i];
+        break;
+      case 3:
+        for (; i < bpp; ++i) out[i] = cur[i] - (prev[i] >> 1);
+        for (; i < n;   ++i) out[i] = cur[i] - ((cur[i - bpp] + prev[i]) >> 1);
+        break;
+      case 4:
+        for (; i < bpp; ++i) out[i] = cur[i] - prev[i];
+        for (; i < n;   ++i) out[i] = cur[i] - paeth(cur[i - bpp], prev[i], prev[i - bpp]);
+        break;
+    }
+    unsigned long sum = 0;
+    for (i = 0; i < n; ++i) sum += abs(static_cast<signed char>(out[i]));
+    if (f == 0 || sum < best) best = sum, type = f;
+  }
+  memcpy(dst, tmp + size_t(type) * (n + 1), n + 1);
+}
+
+// ----------------------------------------------------------------------------
+/// Filter and compress rows [y0, y1] of a frame
+static bool deflate_strip(const Frame &frame, int y0, int y1, bool last, PngDeflater &d, PngStrip &s)
+{
+  const int    bpp = frame.spectrum();
+  const int    n   = frame.width() * bpp;
+  const size_t len = size_t(n + 1) * (y1 - y0 + 1);
+  grow(d.rows,     2 * size_t(n),     d.allocations);
+  grow(d.filtered, 5 * size_t(n + 1), d.allocations);
+  grow(d.data,     len,               d.allocations);
+  unsigned char *prev = &d.rows[0], *cur = prev + n;
+  if (y0 > 0) interleave(frame, y0 - 1, prev);
+  else        memset(prev, 0, n);
+  for (int y = y0; y <= y1; ++y) {
+    interleave(frame, y, cur);
+    filter(&d.data[size_t(n + 1) * (y - y0)], cur, prev, n, bpp, &d.filtered[0]);
+    swap(prev, cur);
+  }
+  s.length = static_cast<uLong>(len);
+  s.adler  = adler32(adler32(0, NULL, 0), &d.data[0], static_cast<uInt>(len));
+  // Same compression level and strategy as libpng for filtered images
+  if (d.init) {
+    if (deflateReset(&d.z) != Z_OK) return false;
+  } else {
+    if (deflateInit2(&d.z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK) return false;
+    d.init = true;
+    ++d.allocations;
+  }
+  const size_t bound = deflateBound(&d.z, static_cast<uLong>(len)) + 16;
+  grow(s.data, bound, d.allocations);
+  d.z.next_in   = &d.data[0];
+  d.z.avail_in  = static_cast<uInt>(len);
+  d.z.next_out  = &s.data[0];
+  d.z.avail_out = static_cast<uInt>(bound);
+  const int status = deflate(&d.z, last ? Z_FINISH : Z_SYNC_FLUSH);
+  if (status != (last ? Z_STREAM_END : Z_OK) || d.z.avail_in != 0 || d.z.avail_out == 0) return false;
+  s.size = bound - d.z.avail_out;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+/// Write 32-bit unsigned integer in network byte order
+static unsigned char *put32(unsigned char *p, unsigned long v)
+{
+  p[0] = static_cast<unsigned char>(v >> 24);
+  p[1] = static_cast<unsigned char>(v >> 16);
+  p[2] = static_cast<unsigned char>(v >>  8);
+  p[3] = static_cast<unsigned char>(v);
+  return p + 4;
+}
+
+// ----------------------------------------------------------------------------
+/// Write chunk length and type, returning pointer to the start of its data
+static unsigned char *begin_chunk(unsigned char *&p, size_t length, const char *type)
+{
+  p = put32(p, static_cast<unsigned long>(length));
+  memcpy(p, type, 4);
+  unsigned char *start = p;
+  p += 4;
+  return start;
+}
+
+// ----------------------------------------------------------------------------
+/// Write CRC of chunk whose type starts at the given position
+static void end_chunk(unsigned char *&p, const unsigned char *start)
+{
+  p = put32(p, crc32(crc32(0, NULL, 0), start, static_cast<uInt>(p - start)));
+}
+
+#endif // cimg_use_openmp
+#endif // cimg_use_png
+
+// ============================================================================
+// Frame buffer pool
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+FramePool::FramePool()
+:
+  _size(0), _arena(NULL), _strips(NULL), _allocations(0)
+{
+  _arena  = new PngArena(&_allocations);
+  _strips = new PngStrips;
+}
+
+// ----------------------------------------------------------------------------
+FramePool::~FramePool()
+{
+  for (map<unsigned char *, size_t>::iterator it = _buffers.begin(); it != _buffers.end(); ++it) {
+    delete[] it->first;
+  }
+  delete _arena;
+  delete _strips;
+}
+
+// ----------------------------------------------------------------------------
+unsigned char *FramePool::buffer(size_t size)
+{
+  // Discard unused buffers of previous size class
+  if (size > _size) {
+    for (size_t i = 0; i < _free.size(); ++i) {
+      _buffers.erase(_free[i]);
+      delete[] _free[i];
+    }
+    _free.clear();
+    _size = size;
+  }
+  if (!_free.empty()) {
+    unsigned char *p = _free.back();
+    _free.pop_back();
+    return p;
+  }
+  unsigned char *p = new unsigned char[_size];
+  _buffers[p] = _size;
+  ++_allocations;
+  return p;
+}
+
+// ----------------------------------------------------------------------------
+bool FramePool::owns(const Frame &frame) const
+{
+  return frame.is_shared() && _buffers.find(const_cast<unsigned char *>(frame.data())) != _buffers.end();
+}
+
+// ----------------------------------------------------------------------------
+size_t FramePool::capacity(const Frame &frame) const
+{
+  if (!frame.is_shared()) return 0;
+  map<unsigned char *, size_t>::const_iterator it = _buffers.find(const_cast<unsigned char *>(frame.data()));
+  return it != _buffers.end() ? it->second : _stack.capacity(frame);
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::acquire(Frame &frame, int width, int height, int channels)
+{
+  if (width < 1 || height < 1 || channels < 1) {
+    release(frame);
+    return;
+  }
+  const size_t size = size_t(width) * height * channels;
+  if (capacity(frame) >= size) {
+    frame.assign(frame.data(), width, height, 1, channels, true);
+  } else {
+    release(frame);
+    frame.assign(buffer(size), width, height, 1, channels, true);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::release(Frame &frame)
+{
+  if (owns(frame)) {
+    map<unsigned char *, size_t>::iterator it = _buffers.find(frame.data());
+    if (it->second < _size) {
+      delete[] it->first;
+      _buffers.erase(it);
+    } else {
+      _free.push_back(it->first);
+    }
+  }
+  frame.assign();
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::release(Sequence &seq)
+{
+  cimglist_for(seq, i) release(seq[i]);
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::load(Frame &frame, const char *fname)
+{
+  if (cimg::strcasecmp(cimg::split_filename(fname), "png") == 0 && !code_path("ANIMTK_PLAIN_IO") &&
+      load_png(frame, fname)) return;
+  // Other formats and PNG files not handled by load_png()
+  const unsigned long size = _tmp.size();
+  _tmp.load(fname);
+  if (_tmp.size() != size) ++_allocations;
+  if (_tmp.depth() > 1) {
+    release(frame);
+    frame = _tmp;
+    return;
+  }
+  acquire(frame, _tmp.width(), _tmp.height(), _tmp.spectrum());
+  if (!frame.is_empty()) memcpy(frame.data(), _tmp.data(), _tmp.size());
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::save(const Frame &frame, const char *fname)
+{
+  if (cimg::strcasecmp(cimg::split_filename(fname), "png") == 0 && !code_path("ANIMTK_PLAIN_IO") &&
+      save_png(frame, fname)) return;
+  frame.save(fname);
+}
+
+// ----------------------------------------------------------------------------
+bool FramePool::load_png(Frame &frame, const char *fname)
+{
+#ifdef cimg_use_png
+  size_t size = 0;
+  if (!read_file(fname, _file, size, _allocations) || size < 8 || png_sig_cmp(&_file[0], 0, 8)) return false;
+  PngStream   stream   = { &_file, size, 8, &_allocations };
+  png_structp png_ptr  = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, NULL, png_error_jump, NULL,
+                                                  _arena, arena_malloc, arena_free);
+  png_infop   info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+  if (!info_ptr || setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    _arena->reset();
+    return false;
+  }
+  png_set_read_fn(png_ptr, &stream, stream_read);
+  png_set_sig_bytes(png_ptr, 8);
+  png_read_info(png_ptr, info_ptr);
+  png_uint_32 W, H;
+  int bit_depth, color_type, interlace_type;
+  bool is_gray = false;
+  png_get_IHDR(png_ptr, info_ptr, &W, &H, &bit_depth, &color_type, &interlace_type, NULL, NULL);
+  // Same transforms as CImg::load_png()
+  if (color_type == PNG_COLOR_TYPE_PALETTE) {
+    png_set_palette_to_rgb(png_ptr);
+    color_type = PNG_COLOR_TYPE_RGB;
+    bit_depth  = 8;
+  }
+  if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
+    png_set_expand_gray_1_2_4_to_8(png_ptr);
+    is_gray   = true;
+    bit_depth = 8;
+  }
+  if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+    png_set_tRNS_to_alpha(png_ptr);
+    color_type |= PNG_COLOR_MASK_ALPHA;
+  }
+  if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+    png_set_gray_to_rgb(png_ptr);
+    color_type |= PNG_COLOR_MASK_COLOR;
+    is_gray = true;
+  }
+  if (color_type == PNG_COLOR_TYPE_RGB) png_set_filler(png_ptr, 0xffffU, PNG_FILLER_AFTER);
+  const bool interlaced = (interlace_type != PNG_INTERLACE_NONE);
+  if (interlaced) png_set_interlace_handling(png_ptr);
+  png_read_update_info(png_ptr, info_ptr);
+  // 16-bit images are left to CImg
+  if (bit_depth != 8 || (color_type != PNG_COLOR_TYPE_RGB && color_type != PNG_COLOR_TYPE_RGB_ALPHA)) {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    _arena->reset();
+    return false;
+  }
+  const bool is_alpha = (color_type == PNG_COLOR_TYPE_RGB_ALPHA);
+  acquire(frame, int(W), int(H), (is_gray ? 1 : 3) + (is_alpha ? 1 : 0));
+  // Interlaced images need all rows, others are decoded row by row
+  grow(_scratch, size_t(4) * W * (interlaced ? H : 1), _allocations);
+  if (interlaced) {
+    grow(_rows, H, _allocations);
+    for (png_uint_32 y = 0; y < H; ++y) _rows[y] = &_scratch[0] + size_t(4) * W * y;
+    png_read_image(png_ptr, &_rows[0]);
+  }
+  unsigned char
+    *ptr_r = frame.data(0, 0, 0, 0),
+    *ptr_g = is_gray  ? NULL : frame.data(0, 0, 0, 1),
+    *ptr_b = is_gray  ? NULL : frame.data(0, 0, 0, 2),
+    *ptr_a = is_alpha ? frame.data(0, 0, 0, is_gray ? 1 : 3) : NULL;
+  for (png_uint_32 y = 0; y < H; ++y) {
+    const unsigned char *ptrs = interlaced ? _rows[y] : &_scratch[0];
+    if (!interlaced) png_read_row(png_ptr, &_scratch[0], NULL);
+    for (png_uint_32 x = 0; x < W; ++x, ptrs += 4) {
+      *(ptr_r++) = ptrs[0];
+      if (ptr_g) *(ptr_g++) = ptrs[1];
+      if (ptr_b) *(ptr_b++) = ptrs[2];
+      if (ptr_a) *(ptr_a++) = ptrs[3];
+    }
+  }
+  png_read_end(png_ptr, NULL);
+  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+  _arena->reset();
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+bool FramePool::save_png(const Frame &frame, const char *fname)
+{
+#ifdef cimg_use_png
+  // Other frames are left to CImg, which also reports its warnings for them
+  if (frame.is_empty() || frame.depth() > 1 || frame.spectrum() > 4) return false;
+  // Rows of large frames are encoded by multiple threads
+  if (parallel(frame.size()) && save_png_strips(frame, fname)) return true;
+  PngStream   stream   = { &_file, 0, 0, &_allocations };
+  png_structp png_ptr  = png_create_write_struct_2(PNG_LIBPNG_VER_STRING, NULL, png_error_jump, NULL,
+                                                   _arena, arena_malloc, arena_free);
+  png_infop   info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+  if (!info_ptr || setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    _arena->reset();
+    return false;
+  }
+  // Same encoding as CImg::save_png()
+  const int W = frame.width();
+  const int H = frame.height();
+  const int C = frame.spectrum();
+  int color_type;
+  switch (C) {
+    case 1:  color_type = PNG_COLOR_TYPE_GRAY;       break;
+    case 2:  color_type = PNG_COLOR_TYPE_GRAY_ALPHA; break;
+    case 3:  color_type = PNG_COLOR_TYPE_RGB;        break;
+    default: color_type = PNG_COLOR_TYPE_RGB_ALPHA;  break;
+  }
+  png_set_write_fn(png_ptr, &stream, stream_write, stream_flush);
+  png_set_IHDR(png_ptr, info_ptr, W, H, 8, color_type, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr, info_ptr);
+  grow(_scratch, size_t(C) * W, _allocations);
+  for (int y = 0; y < H; ++y) {
+    interleave(frame, y, &_scratch[0]);
+    png_write_row(png_ptr, &_scratch[0]);
+  }
+  png_write_end(png_ptr, info_ptr);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  _arena->reset();
+  if (!write_file(fname, &_file[0], stream.size)) {
+    throw CImgIOException("Failed to write frame to file %s!", fname);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::save_indexed(const Frame &indices, const Frame &palette, const char *fname)
+{
+  if (indices.is_empty() || indices.depth() > 1 || indices.spectrum() != 1 ||
+      palette.width() < 1 || palette.width() > 256 || palette.spectrum() != 4) {
+    throw CImgArgumentException("FramePool::save_indexed(): Invalid indices or palette of file %s", fname);
+  }
+#ifdef cimg_use_png
+  PngStream   stream   = { &_file, 0, 0, &_allocations };
+  png_structp png_ptr  = png_create_write_struct_2(PNG_LIBPNG_VER_STRING, NULL, png_error_jump, NULL,
+                                                   _arena, arena_malloc, arena_free);
+  png_infop   info_ptr = png_ptr ? png_create_info_struct(png_ptr) : NULL;
+  if (!info_ptr || setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    _arena->reset();
+    throw CImgIOException("Failed to encode frame of file %s!", fname);
+  }
+  png_color plte [256];
+  png_byte  trans[256];
+  int       ntrans = 0;
+  for (int i = 0; i < palette.width(); ++i) {
+    plte[i].red   = palette(i, 0, 0, 0);
+    plte[i].green = palette(i, 0, 0, 1);
+    plte[i].blue  = palette(i, 0, 0, 2);
+    trans[i]      = palette(i, 0, 0, 3);
+    if (trans[i] != 255) ntrans = i + 1;
+  }
+  png_set_write_fn(png_ptr, &stream, stream_write, stream_flush);
+  png_set_IHDR(png_ptr, info_ptr, indices.width(), indices.height(), 8, PNG_COLOR_TYPE_PALETTE,
+               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_set_PLTE(png_ptr, info_ptr, plte, palette.width());
+  if (ntrans > 0) png_set_tRNS(png_ptr, info_ptr, trans, ntrans, NULL);
+  png_write_info(png_ptr, info_ptr);
+  for (int y = 0; y < indices.height(); ++y) {
+    png_write_row(png_ptr, const_cast<png_bytep>(indices.data(0, y)));
+  }
+  png_write_end(png_ptr, info_ptr);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  _arena->reset();
+  if (!write_file(fname, &_file[0], stream.size)) {
+    throw CImgIOException("Failed to write frame to file %s!", fname);
+  }
+#else
+  throw CImgIOException("Writing indexed PNG file %s requires libpng!", fname);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+bool FramePool::save_png_strips(const Frame &frame, const char *fname)
+{
+#if defined(cimg_use_png) && defined(cimg_use_openmp)
+  const int W = frame.width();
+  const int H = frame.height();
+  const int C = frame.spectrum();
+  const int rows    = cimg::max(1, static_cast<int>(PNG_STRIP_SIZE / (size_t(W) * C + 1)));
+  const int strips  = (H + rows - 1) / rows;
+  const int threads = omp_get_max_threads();
+  vector<PngDeflater *> &deflaters = _strips->deflaters;
+  while (static_cast<int>(deflaters.size()) < threads) deflaters.push_back(new PngDeflater), ++_allocations;
+  if (static_cast<int>(_strips->strips.size()) < strips) _strips->strips.resize(strips), ++_allocations;
+  // Filter and compress strips
+  bool ok = true;
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < strips; ++i) {
+    PngDeflater &d = *deflaters[omp_get_thread_num()];
+    if (!deflate_strip(frame, i * rows, cimg::min(H, (i + 1) * rows) - 1, i == strips - 1, d, _strips->strips[i])) {
+#pragma omp critical
+      ok = false;
+    }
+  }
+  for (int t = 0; t < threads; ++t) {
+    _allocations += deflaters[t]->allocations;
+    deflaters[t]->allocations = 0;
+  }
+  if (!ok) return false;
+  // Same header as CImg::save_png(), followed by one image data chunk per strip
+  size_t size = 8 + 25 + 12 + 2 + 4;
+  uLong  adler = adler32(0, NULL, 0);
+  for (int i = 0; i < strips; ++i) {
+    const PngStrip &s = _strips->strips[i];
+    size += 12 + s.size;
+    adler = adler32_combine(adler, s.adler, s.length);
+  }
+  grow(_file, size, _allocations);
+  static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+  unsigned char *p = &_file[0], *start;
+  memcpy(p, signature, 8);
+  p += 8;
+  start = begin_chunk(p, 13, "IHDR");
+  p = put32(p, W);
+  p = put32(p, H);
+  *p++ = 8;
+  *p++ = static_cast<unsigned char>(C == 1 ? PNG_COLOR_TYPE_GRAY :
+                                    C == 2 ? PNG_COLOR_TYPE_GRAY_ALPHA :
+                                    C == 3 ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA);
+  *p++ = PNG_COMPRESSION_TYPE_DEFAULT;
+  *p++ = PNG_FILTER_TYPE_DEFAULT;
+  *p++ = PNG_INTERLACE_NONE;
+  end_chunk(p, start);
+  for (int i = 0; i < strips; ++i) {
+    const PngStrip &s = _strips->strips[i];
+    const bool first = (i == 0), last = (i == strips - 1);
+    start = begin_chunk(p, (first ? 2 : 0) + s.size + (last ? 4 : 0), "IDAT");
+    if (first) *p++ = 0x78, *p++ = 0x9c;
+    memcpy(p, &s.data[0], s.size);
+    p += s.size;
+    if (last) p = put32(p, adler);
+    end_chunk(p, start);
+  }
+  start = begin_chunk(p, 0, "IEND");
+  end_chunk(p, start);
+  if (!write_file(fname, &_file[0], p - &_file[0])) {
+    throw CImgIOException("Failed to write frame to file %s!", fname);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+void FramePool::crop(Frame &frame, const BoundingBox &box)
+{
+  if (frame.is_empty()) return;
+  if (frame.depth() > 1) {
+    Frame res = frame.get_crop(box.x0, box.y0, box.x1, box.y1);
+    release(frame);
+    res.move_to(frame);
+    return;
+  }
+  const int x0 = cimg::min(box.x0, box.x1), x1 = cimg::max(box.x0, box.x1);
+  const int y0 = cimg::min(box.y0, box.y1), y1 = cimg::max(box.y0, box.y1);
+  const int w  = frame.width(), h = frame.height(), c = frame.spectrum();
+  const int nw = x1 - x0 + 1, nh = y1 - y0 + 1;
+  if (capacity(frame) > 0 && x0 >= 0 && y0 >= 0 && x1 < w && y1 < h) {
+    unsigned char *data = frame.data();
+    // Copy rows of large pooled frames to another buffer using multiple threads
+    if (owns(frame) && parallel(frame.size())) {
+      unsigned char *dst = buffer(size_t(nw) * nh * c);
+      const int rows = nh * c;
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(static)
+#endif
+      for (int i = 0; i < rows; ++i) {
+        memcpy(dst + size_t(i) * nw, data + (size_t(i / nh) * h + y0 + i % nh) * w + x0, nw);
+      }
+      release(frame);
+      frame.assign(dst, nw, nh, 1, c, true);
+      return;
+    }
+    // Otherwise, move rows of region towards start of buffer
+    for (int k = 0; k < c; ++k)
+    for (int y = 0; y < nh; ++y) {
+      memmove(data + (size_t(k) * nh + y) * nw, data + (size_t(k) * h + y0 + y) * w + x0, nw);
+    }
+    frame.assign(data, nw, nh, 1, c, true);
+    return;
+  }
+  // Otherwise, copy frame and fill in region, padding with zeros
+  const unsigned long size = _tmp.size();
+  _tmp.assign(w, h, 1, c);
+  if (_tmp.size() != size) ++_allocations;
+  memcpy(_tmp.data(), frame.data(), _tmp.size());
+  acquire(frame, nw, nh, c);
+  frame.fill(0);
+  const int sx0 = cimg::max(x0, 0), sx1 = cimg::min(x1, w - 1);
+  const int sy0 = cimg::max(y0, 0), sy1 = cimg::min(y1, h - 1);
+  if (sx0 > sx1 || sy0 > sy1) return;
+  for (int k = 0; k < c; ++k)
+  for (int y = sy0; y <= sy1; ++y) {
+    memcpy(frame.data(sx0 - x0, y - y0, 0, k), _tmp.data(sx0, y, 0, k), sx1 - sx0 + 1);
+  }
+}
+
+
+} // namespace animtk
@@ -0,0 +1,161 @@
+/* Frame buffer pool of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_POOL_H
+#define ANIMTK_POOL_H
+
+#include <map>
+
+#include "animtk.h"
+#include "stack.h"
+
+
+namespace animtk {
+
+
+/// Memory used by libpng and zlib, reused for each file
+struct PngArena;
+
+/// Strips of PNG image data encoded by multiple threads
+struct PngStrips;
+
+// ============================================================================
+// Frame buffer pool
+// ============================================================================
+
+/// Pool of frame buffers which are reused for all frames of image sequences
+///
+/// All frames of a sequence have the same size, hence the pool uses a single
+/// size class given by the largest frame requested so far. Frames acquired
+/// from the pool share the memory of a pooled buffer, which remains owned by
+/// the pool. Decoding, cropping, and encoding of PNG frames through the pool
+/// reuse its buffers and scratch memory, including the memory used by libpng
+/// and zlib and the contents of the PNG files, which are read and written at
+/// once, such that no heap memory is allocated per frame once the pool holds
+/// enough buffers of the right size. Other file formats are decoded and
+/// encoded by CImg and copied from or to the pooled buffers.
+///
+/// The rows of large frames (see parallel_frame_size()) are cropped and encoded
+/// by multiple threads unless the pool is used inside a parallel region. The
+/// image data of such PNG files is split into strips which are compressed
+/// separately.
+///
+/// The pool also holds a FrameStack for sequences which are stored in one
+/// contiguous block of memory (see read_stack()). Frames which share the
+/// memory of a frame of this stack are decoded and cropped in place.
+///
+/// A pool is not thread-safe, each thread must use its own pool. Frames which
+/// share the memory of a pooled buffer must not be used after the pool was
+/// destroyed, and must not be modified in ways that change their size other
+/// than by the functions of the pool.
+class FramePool
+{
+public:
+
+  FramePool();
+  ~FramePool();
+
+  /// Let frame share the memory of a pooled buffer of the given size
+  ///
+  /// If the frame already shares a pooled buffer or frame of the stack which
+  /// is large enough, only the size of the frame is changed. The pixel values are undefined.
+  void acquire(Frame &frame, int width, int height, int channels);
+
+  /// Return buffer of frame to the pool, leaving an empty frame
+  ///
+  /// Frames which do not share a pooled buffer are cleared.
+  void release(Frame &frame);
+
+  /// Return buffers of all frames of a sequence to the pool
+  void release(Sequence &seq);
+
+  /// Whether frame shares the memory of a pooled buffer
+  bool owns(const Frame &frame) const;
+
+  /// Size of the pooled buffer or frame of the stack shared by a frame
+  ///
+  /// \returns Size of memory in bytes, or 0 if the frame shares neither.
+  size_t capacity(const Frame &frame) const;
+
+  /// Contiguous storage of image sequences
+  FrameStack &stack() { return _stack; }
+
+  /// Read frame into a pooled buffer
+  ///
+  /// \throws cimg_library::CImgIOException if the frame could not be read.
+  void load(Frame &frame, const char *fname);
+
+  /// Write frame using the scratch memory of the pool
+  ///
+  /// \throws cimg_library::CImgIOException if the frame could not be written.
+  void save(const Frame &frame, const char *fname);
+
+  /// Write indexed PNG file using the scratch memory of the pool
+  ///
+  /// \param indices Palette index of each pixel, a frame with one channel.
+  /// \param palette Colors of the palette as n x 1 frame with four channels,
+  ///                where n is at most 256. Colors which are not opaque should
+  ///                come first, as only the alpha values up to the last such
+  ///                color are stored.
+  /// \param fname   Name of PNG file.
+  ///
+  /// \throws cimg_library::CImgIOException if the frame could not be written.
+  void save_indexed(const Frame &indices, const Frame &palette, const char *fname);
+
+  /// Crop frame in place, keeping its pooled buffer if large enough
+  ///
+  /// Pixels outside the frame are set to zero as by CImg::crop(). A pooled
+  /// frame whose crop region lies inside the frame is cropped without
+  /// modifying the pool, such that different frames may be cropped by
+  /// concurrent threads in this case.
+  void crop(Frame &frame, const BoundingBox &box);
+
+  /// Number of pooled buffers
+  int buffers() const { return static_cast<int>(_buffers.size()); }
+
+  /// Number of heap allocations made by the pool since its creation
+  unsigned long allocations() const { return _allocations; }
+
+private:
+
+  size_t                            _size;        ///< Size of pooled buffers in bytes.
+  std::map<unsigned char *, size_t> _buffers;     ///< Pooled buffers and their sizes.
+  std::vector<unsigned char *>      _free;        ///< Unused pooled buffers.
+  std::vector<unsigned char>        _file;        ///< Contents of PNG file.
+  std::vector<unsigned char>        _scratch;     ///< Interleaved rows of PNG files.
+  std::vector<unsigned char *>      _rows;        ///< Row pointers into scratch memory.
+  Frame                             _tmp;         ///< Copy of frame for non-PNG files and crops.
+  PngArena                         *_arena;       ///< Memory of libpng and zlib.
+  PngStrips                        *_strips;      ///< Compressed strips of PNG files.
+  FrameStack                        _stack;       ///< Contiguous storage of sequence.
+  unsigned long                     _allocations; ///< Number of heap allocations.
+
+  unsigned char *buffer(size_t size);
+  bool           load_png(Frame &frame, const char *fname);
+  bool           save_png(const Frame &frame, const char *fname);
+  bool           save_png_strips(const Frame &frame, const char *fname);
+
+  FramePool(const FramePool &);
+  FramePool &operator =(const FramePool &);
+};
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_POOL_H
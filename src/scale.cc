@@ -0,0 +1,293 @@
+/* Multi-resolution output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdlib>
+
+#include "scale.h"
+#include "pool.h"
+#include "texture.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Filter taps of the pixels of a resampled row or column
+struct Taps
+{
+  int           n;      ///< Number of taps per output pixel.
+  vector<int>   index;  ///< Input pixel of each tap.
+  vector<float> weight; ///< Normalized weight of each tap.
+};
+
+// ----------------------------------------------------------------------------
+/// Compute tent filter taps for resampling n input pixels to m output pixels
+///
+/// Input pixels outside the row or column are clamped to its first and last
+/// pixel, respectively.
+static void filter_taps(int n, int m, Taps &taps)
+{
+  const double s = double(m) / n;
+  const double r = s < 1. ? 1. / s : 1.;
+  taps.n = static_cast<int>(ceil(2. * r)) + 1;
+  taps.index .resize(m * taps.n);
+  taps.weight.resize(m * taps.n);
+  for (int i = 0; i < m; ++i) {
+    const double c  = (i + .5) / s - .5;
+    const int    j0 = static_cast<int>(floor(c - r)) + 1;
+    int   *index  = &taps.index [i * taps.n];
+    float *weight = &taps.weight[i * taps.n];
+    double sum = 0.;
+    for (int k = 0; k < taps.n; ++k) {
+      const double w = cimg::max(0., 1. - cimg::abs(j0 + k - c) / r);
+      index [k] = cimg::max(0, cimg::min(j0 + k, n - 1));
+      weight[k] = static_cast<float>(w);
+      sum += w;
+    }
+    for (int k = 0; k < taps.n; ++k) weight[k] = static_cast<float>(weight[k] / sum);
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Convert filtered value to pixel value
+static inline unsigned char saturate(float v)
+{
+  return static_cast<unsigned char>(v <= 0.f ? 0 : (v >= 255.f ? 255 : int(v + .5f)));
+}
+
+// ============================================================================
+// Scales
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+Scales parse_scales(const char *str)
+{
+  Scales scales;
+  const char *p = str;
+  while (p && *p) {
+    char  *end;
+    double s = strtod(p, &end);
+    while (*end == ' ') ++end;
+    if (end == p || (*end != ',' && *end != '\0')) {
+      s = 0.;
+      while (*end != ',' && *end != '\0') ++end;
+    }
+    scales.push_back(s);
+    p = (*end == ',' ? end + 1 : end);
+  }
+  return scales;
+}
+
+// ----------------------------------------------------------------------------
+string format_scales(const Scales &scales)
+{
+  string str;
+  char   buffer[32];
+  for (size_t i = 0; i < scales.size(); ++i) {
+    snprintf(buffer, 32, i == 0 ? "%g" : ",%g", scales[i]);
+    str += buffer;
+  }
+  return str;
+}
+
+// ----------------------------------------------------------------------------
+string scaled_filename(const string &fname, double scale)
+{
+  char suffix[32];
+  snprintf(suffix, 32, "@%gx", scale);
+  size_t pos = fname.find_last_of('.');
+  if (pos == string::npos || (fname.find_last_of("/\\") != string::npos && pos < fname.find_last_of("/\\"))) {
+    pos = fname.length();
+  }
+  return fname.substr(0, pos) + suffix + fname.substr(pos);
+}
+
+// ----------------------------------------------------------------------------
+int snap_size(const Scales &scales, int block)
+{
+  for (size_t i = 0; i < scales.size(); ++i) {
+    if (!(scales[i] > 0.)) return 0;
+  }
+  for (int size = 2; size <= MAX_SNAP_SIZE; size += 2) {
+    if (size % block != 0) continue;
+    size_t i = 0;
+    while (i < scales.size()) {
+      const double n = floor(size * scales[i] + .5);
+      if (cimg::abs(size * scales[i] - n) >= 1e-6 || int(n) % block != 0) break;
+      ++i;
+    }
+    if (i == scales.size()) return size;
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+int snap_size(const Job &job)
+{
+  const bool texture = !texture_format(job).empty();
+  if (job.scales.empty() && !texture) return 1;
+  return snap_size(job.scales, texture ? TEXTURE_BLOCK_SIZE : 1);
+}
+
+// ----------------------------------------------------------------------------
+void snap(BoundingBoxes &boxes, int size, CropMode mode)
+{
+  int fx = 0, fy = 0;
+  for (size_t frame = 0; frame < boxes.size(); ++frame) {
+    BoundingBox &b = boxes[frame];
+    if (b.x1 < b.x0 || b.y1 < b.y0) continue;
+    // Floor division, coordinates of fixed size regions may be negative
+    b.x0 = (b.x0 >= 0 ? b.x0 / size : -((size - 1 - b.x0) / size)) * size;
+    b.y0 = (b.y0 >= 0 ? b.y0 / size : -((size - 1 - b.y0) / size)) * size;
+    b.x1 = b.x0 + (b.x1 - b.x0 + size) / size * size - 1;
+    b.y1 = b.y0 + (b.y1 - b.y0 + size) / size * size - 1;
+    fx = cimg::max(fx, b.width());
+    fy = cimg::max(fy, b.height());
+  }
+  if (mode == CROP_FIXED) {
+    for (size_t frame = 0; frame < boxes.size(); ++frame) {
+      BoundingBox &b = boxes[frame];
+      if (b.x1 < b.x0 || b.y1 < b.y0) continue;
+      b.x1 = b.x0 + fx - 1;
+      b.y1 = b.y0 + fy - 1;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+BoundingBox scale_box(const BoundingBox &box, double scale)
+{
+  if (box.x1 < box.x0 || box.y1 < box.y0) return box;
+  return BoundingBox(static_cast<int>(floor(box.x0 * scale + .5)),
+                     static_cast<int>(floor(box.y0 * scale + .5)),
+                     static_cast<int>(floor((box.x1 + 1) * scale + .5)) - 1,
+                     static_cast<int>(floor((box.y1 + 1) * scale + .5)) - 1);
+}
+
+// ============================================================================
+// Resampling
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+Frame resample(const Frame &frame, int width, int height)
+{
+  if (frame.is_empty() || width < 1 || height < 1) return Frame();
+  if (frame.depth() > 1) return frame.get_resize(width, height, -100, -100, 2);
+  const int w = frame.width(), h = frame.height(), nc = frame.spectrum();
+  const int alpha = (nc == 2 || nc == 4) ? nc - 1 : -1;
+  Taps tx, ty;
+  filter_taps(w, width,  tx);
+  filter_taps(h, height, ty);
+  // Horizontal pass, colors are premultiplied by alpha
+  CImg<float>   tmp(width, h, 1, nc);
+  vector<float> row(w), opacity(w, 1.f);
+  for (int y = 0; y < h; ++y) {
+    if (alpha >= 0) {
+      const unsigned char *a = frame.data(0, y, 0, alpha);
+      for (int x = 0; x < w; ++x) opacity[x] = a[x] / 255.f;
+    }
+    for (int c = 0; c < nc; ++c) {
+      const unsigned char *p = frame.data(0, y, 0, c);
+      if (c == alpha) for (int x = 0; x < w; ++x) row[x] = p[x];
+      else            for (int x = 0; x < w; ++x) row[x] = p[x] * opacity[x];
+      float *q = tmp.data(0, y, 0, c);
+      for (int i = 0; i < width; ++i) {
+        const int   *index  = &tx.index [i * tx.n];
+        const float *weight = &tx.weight[i * tx.n];
+        float v = 0.f;
+        for (int k = 0; k < tx.n; ++k) v += weight[k] * row[index[k]];
+        q[i] = v;
+      }
+    }
+  }
+  // Vertical pass, accumulating whole rows
+  Frame         scaled(width, height, 1, nc);
+  vector<float> sum(width * nc);
+  for (int y = 0; y < height; ++y) {
+    const int   *index  = &ty.index [y * ty.n];
+    const float *weight = &ty.weight[y * ty.n];
+    for (int c = 0; c < nc; ++c) {
+      float *s = &sum[c * width];
+      for (int x = 0; x < width; ++x) s[x] = 0.f;
+      for (int k = 0; k < ty.n; ++k) {
+        const float *p = tmp.data(0, index[k], 0, c);
+        const float  v = weight[k];
+        for (int x = 0; x < width; ++x) s[x] += v * p[x];
+      }
+    }
+    // Divide colors by alpha
+    const float *a = alpha >= 0 ? &sum[alpha * width] : NULL;
+    for (int c = 0; c < nc; ++c) {
+      const float   *s = &sum[c * width];
+      unsigned char *q = scaled.data(0, y, 0, c);
+      if (c == alpha || !a) for (int x = 0; x < width; ++x) q[x] = saturate(s[x]);
+      else for (int x = 0; x < width; ++x) q[x] = a[x] > 0.f ? saturate(s[x] * 255.f / a[x]) : 0;
+    }
+  }
+  return scaled;
+}
+
+// ----------------------------------------------------------------------------
+void resample(const Sequence &frames, double scale, Sequence &scaled)
+{
+  scaled.assign(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    const Frame &f = frames[frame];
+    if (f.is_empty()) continue;
+    const int width  = cimg::max(1, static_cast<int>(floor(f.width()  * scale + .5)));
+    const int height = cimg::max(1, static_cast<int>(floor(f.height() * scale + .5)));
+    resample(f, width, height).move_to(scaled[frame]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void write_scales(const Job &job, const Sequence &frames, const BoundingBoxes &boxes, int w, int h, FramePool &pool)
+{
+  Sequence scaled;
+  for (size_t i = 0; i < job.scales.size(); ++i) {
+    const double s = job.scales[i];
+    if (s == 1.) continue;
+    resample(frames, s, scaled);
+    TextureFormat format;
+    if (parse_texture_format(texture_format(job), format)) {
+      write_textures(scaled, scaled_filename(job.output, s).c_str(), format, job.hq);
+    } else {
+      write_sequence(scaled, scaled_filename(job.output, s).c_str(), pool);
+    }
+    if (!job.csv.empty()) {
+      BoundingBoxes sb(boxes.size());
+      for (size_t frame = 0; frame < boxes.size(); ++frame) sb[frame] = scale_box(boxes[frame], s);
+      write_csv(scaled_filename(job.csv, s).c_str(), sb,
+                static_cast<int>(floor(w * s + .5)), static_cast<int>(floor(h * s + .5)),
+                job.fbegin, job.fstride, job.append);
+    }
+  }
+}
+
+
+} // namespace animtk
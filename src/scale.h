@@ -0,0 +1,107 @@
+/* Multi-resolution output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_SCALE_H
+#define ANIMTK_SCALE_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Scales
+// ============================================================================
+
+/// Largest multiple of pixels to which the crop regions are snapped such that
+/// they have integral coordinates at all output scales (see snap_size())
+const int MAX_SNAP_SIZE = 64;
+
+/// Parse comma separated list of scales, e.g., "1,0.5,0.25"
+///
+/// \returns Scales in the given order. An item which is not a number yields a
+///          scale of zero, which is rejected as invalid by snap_size().
+Scales parse_scales(const char *str);
+
+/// Format scales as comma separated list as parsed by parse_scales()
+std::string format_scales(const Scales &scales);
+
+/// Insert scale into output file name, e.g., cropped@0.5x.png
+std::string scaled_filename(const std::string &fname, double scale);
+
+/// Determine multiple of pixels to which crop regions are snapped
+///
+/// \param scales Scales of the additional outputs.
+/// \param block  Size of the pixel blocks of the outputs, e.g., of textures.
+///
+/// \returns Smallest even multiple of \p block which is scaled to a multiple
+///          of \p block pixels by each scale, or zero if a scale is not
+///          positive or no such number up to MAX_SNAP_SIZE exists.
+int snap_size(const Scales &scales, int block = 1);
+
+/// Determine multiple of pixels to which the crop regions of a job are snapped
+///
+/// \returns One if the crop regions are not snapped, i.e., if the job has
+///          neither Job::scales nor Job::texture, or zero if invalid.
+int snap_size(const Job &job);
+
+/// Snap crop regions to multiples of the given size
+///
+/// The top-left corner of each non-empty region is moved up and left, and its
+/// bottom-right corner down and right, to the nearest multiple of \p size,
+/// such that the offsets of the regions are preserved exactly at all scales.
+/// Regions of CROP_FIXED mode are enlarged to the same snapped size.
+void snap(BoundingBoxes &boxes, int size, CropMode mode);
+
+/// Scale crop region whose coordinates are multiples of 1 / scale
+BoundingBox scale_box(const BoundingBox &box, double scale);
+
+/// Resample frame using a separable tent filter
+///
+/// Each output pixel is the weighted mean of the input pixels within a radius
+/// of one output pixel, or one input pixel when the frame is enlarged. The
+/// color channels of frames with alpha channel, i.e., of gray-alpha and RGBA
+/// frames, are weighted by alpha, such that the colors of transparent pixels
+/// do not bleed into the edges of the foreground.
+Frame resample(const Frame &frame, int width, int height);
+
+/// Resample frames of image sequence by the given scale
+void resample(const Sequence &frames, double scale, Sequence &scaled);
+
+/// Write resampled cropped frames and crop regions of each scale of a job
+///
+/// For each scale other than one, the cropped frames are resampled and written
+/// to the output sequence and CSV spreadsheet of the job whose file names are
+/// modified by scaled_filename(). The crop regions must have been snapped.
+///
+/// \param job    Crop job with Job::scales.
+/// \param frames Cropped frames.
+/// \param boxes  Snapped crop regions of the frames.
+/// \param w      Width of input frames.
+/// \param h      Height of input frames.
+/// \param pool   Frame pool used to encode the output frames.
+///
+/// \throws cimg_library::CImgException if the output could not be written.
+void write_scales(const Job &job, const Sequence &frames, const BoundingBoxes &boxes, int w, int h, FramePool &pool);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_SCALE_H
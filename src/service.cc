@@ -0,0 +1,832 @@
+/* Crop service of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+
+#include "pool.h"
+#include "scale.h"
+#include "service.h"
+
+#ifndef _WIN32
+#  include <pthread.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/un.h>
+#endif
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Protocol
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Quote and escape string for use in JSON
+static string json_string(const string &str)
+{
+  string res("\"");
+  for (const char *p = str.c_str(); *p; ++p) {
+    switch (*p) {
+      case '"':  res += "\\\""; break;
+      case '\\': res += "\\\\"; break;
+      case '\n': res += "\\n";  break;
+      case '\r': res += "\\r";  break;
+      case '\t': res += "\\t";  break;
+      default:
+        if (static_cast<unsigned char>(*p) < 0x20) {
+          char code[8];
+          snprintf(code, 8, "\\u%04x", static_cast<unsigned int>(*p));
+          res += code;
+        } else {
+          res.push_back(*p);
+        }
+    }
+  }
+  res.push_back('"');
+  return res;
+}
+
+// ----------------------------------------------------------------------------
+static void skip_space(const char *&p)
+{
+  while (*p && isspace(*p)) ++p;
+}
+
+// ----------------------------------------------------------------------------
+/// Parse quoted JSON string, p points to the opening quote
+static string parse_json_string(const char *&p)
+{
+  string res;
+  ++p;
+  while (*p && *p != '"') {
+    if (*p == '\\') {
+      ++p;
+      switch (*p) {
+        case '"':  res.push_back('"');  break;
+        case '\\': res.push_back('\\'); break;
+        case '/':  res.push_back('/');  break;
+        case 'b':  res.push_back('\b'); break;
+        case 'f':  res.push_back('\f'); break;
+        case 'n':  res.push_back('\n'); break;
+        case 'r':  res.push_back('\r'); break;
+        case 't':  res.push_back('\t'); break;
+        case 'u': {
+          unsigned int c = 0;
+          for (int i = 1; i <= 4; ++i) {
+            const char h = p[i];
+            if      ('0' <= h && h <= '9') c = c * 16 + (h - '0');
+            else if ('a' <= h && h <= 'f') c = c * 16 + (h - 'a' + 10);
+            else if ('A' <= h && h <= 'F') c = c * 16 + (h - 'A' + 10);
+            else throw CImgArgumentException("Invalid JSON request: Invalid unicode escape sequence");
+          }
+          p += 4;
+          // encode as UTF-8 (characters of the basic multilingual plane only)
+          if (c < 0x80) {
+            res.push_back(static_cast<char>(c));
+          } else if (c < 0x800) {
+            res.push_back(static_cast<char>(0xc0 | (c >> 6)));
+            res.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+          } else {
+            res.push_back(static_cast<char>(0xe0 | (c >> 12)));
+            res.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+            res.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+          }
+        } break;
+        default:
+          throw CImgArgumentException("Invalid JSON request: Invalid escape sequence");
+      }
+      ++p;
+    } else {
+      res.push_back(*p++);
+    }
+  }
+  if (*p != '"') throw CImgArgumentException("Invalid JSON request: Unterminated string");
+  ++p;
+  return res;
+}
+
+// ----------------------------------------------------------------------------
+/// Parse flat JSON object whose values are strings, numbers, or literals
+///
+/// \returns Map of field names to unescaped string values.
+static map<string, string> parse_json_object(const string &json)
+{
+  map<string, string> fields;
+  const char *p = json.c_str();
+  skip_space(p);
+  if (*p != '{') throw CImgArgumentException("Invalid JSON request: Expected object");
+  ++p;
+  skip_space(p);
+  if (*p == '}') {
+    ++p;
+  } else {
+    while (true) {
+      skip_space(p);
+      if (*p != '"') throw CImgArgumentException("Invalid JSON request: Expected field name");
+      const string name = parse_json_string(p);
+      skip_space(p);
+      if (*p != ':') throw CImgArgumentException("Invalid JSON request: Expected ':' after field name");
+      ++p;
+      skip_space(p);
+      string value;
+      if (*p == '"') {
+        value = parse_json_string(p);
+      } else {
+        while (*p && *p != ',' && *p != '}' && !isspace(*p)) value.push_back(*p++);
+        if (value.empty()) throw CImgArgumentException("Invalid JSON request: Missing value of field %s", name.c_str());
+      }
+      fields[name] = value;
+      skip_space(p);
+      if (*p == ',') { ++p; continue; }
+      if (*p == '}') { ++p; break;    }
+      throw CImgArgumentException("Invalid JSON request: Expected ',' or '}'");
+    }
+  }
+  skip_space(p);
+  if (*p) throw CImgArgumentException("Invalid JSON request: Unexpected characters after object");
+  return fields;
+}
+
+// ----------------------------------------------------------------------------
+static int parse_int(const string &name, const string &value)
+{
+  char *end = NULL;
+  errno = 0;
+  const long n = strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0') {
+    throw CImgArgumentException("Invalid JSON request: Value of field %s must be an integer", name.c_str());
+  }
+  if (errno == ERANGE || n < INT_MIN || n > INT_MAX) {
+    throw CImgArgumentException("Invalid JSON request: Value of field %s is out of range", name.c_str());
+  }
+  return static_cast<int>(n);
+}
+
+// ----------------------------------------------------------------------------
+static Job job_from_fields(const map<string, string> &fields, string *id)
+{
+  Job job;
+  for (map<string, string>::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+    const string &name  = it->first;
+    const string &value = it->second;
+    if      (name == "id")     { if (id) *id = value; }
+    else if (name == "input")  job.input   = value;
+    else if (name == "output") job.output  = value;
+    else if (name == "csv")    job.csv     = value;
+    else if (name == "cache")  job.cache   = value;
+    else if (name == "checkpoint") job.checkpoint = value;
+    else if (name == "interval")   job.interval   = parse_int(name, value);
+    else if (name == "delta")      job.delta      = value;
+    else if (name == "keyframes")  job.keyframes  = parse_int(name, value);
+    else if (name == "gap")        job.gap        = parse_int(name, value);
+    else if (name == "hull")       job.hull       = value;
+    else if (name == "vertices")   job.vertices   = parse_int(name, value);
+    else if (name == "scales")     job.scales     = parse_scales(value.c_str());
+    else if (name == "texture")    job.texture    = value;
+    else if (name == "colors")     job.colors     = parse_int(name, value);
+    else if (name == "masks")      job.masks      = value;
+    else if (name == "threshold")  job.threshold  = parse_int(name, value);
+    else if (name == "bleed")      job.bleed      = parse_int(name, value);
+    else if (name == "tiles")      job.tiles      = value;
+    else if (name == "tilesize")   job.tilesize   = parse_int(name, value);
+    else if (name == "segments")   job.segments   = parse_int(name, value);
+    else if (name == "begin")  job.fbegin  = parse_int(name, value);
+    else if (name == "end")    job.fend    = parse_int(name, value);
+    else if (name == "stride") job.fstride = parse_int(name, value);
+    else if (name == "mode") {
+      if      (value == "tight") job.mode = CROP_TIGHT;
+      else if (value == "union") job.mode = CROP_UNION;
+      else if (value == "fixed") job.mode = CROP_FIXED;
+      else if (value == "segmented") job.mode = CROP_SEGMENTED;
+      else throw CImgArgumentException("Invalid JSON request: Unknown mode %s", value.c_str());
+    } else if (name == "append" || name == "resume" || name == "stack" || name == "regions" || name == "hq") {
+      bool &flag = (name == "append"  ? job.append  : (name == "resume" ? job.resume :
+                   (name == "stack"   ? job.stack   : (name == "regions" ? job.regions : job.hq))));
+      if      (value == "true")  flag = true;
+      else if (value == "false") flag = false;
+      else throw CImgArgumentException("Invalid JSON request: Value of field %s must be true or false", name.c_str());
+    } else {
+      throw CImgArgumentException("Invalid JSON request: Unknown field %s", name.c_str());
+    }
+  }
+  const string msg = validate(job);
+  if (!msg.empty()) throw CImgArgumentException("%s", msg.c_str());
+  return job;
+}
+
+// ----------------------------------------------------------------------------
+string to_json(const Job &job, const string &id)
+{
+  const char *mode = "tight";
+  if      (job.mode == CROP_UNION) mode = "union";
+  else if (job.mode == CROP_FIXED) mode = "fixed";
+  else if (job.mode == CROP_SEGMENTED) mode = "segmented";
+  char numbers[128];
+  snprintf(numbers, 128, "\"begin\": %d, \"end\": %d, \"stride\": %d, ", job.fbegin, job.fend, job.fstride);
+  string json("{");
+  if (!id.empty()) json += "\"id\": " + json_string(id) + ", ";
+  json += "\"input\": "  + json_string(job.input)  + ", ";
+  json += "\"output\": " + json_string(job.output) + ", ";
+  json += "\"csv\": "    + json_string(job.csv)    + ", ";
+  if (!job.cache.empty()) json += "\"cache\": " + json_string(job.cache) + ", ";
+  if (!job.checkpoint.empty()) {
+    char interval[32];
+    snprintf(interval, 32, "%d", job.interval);
+    json += "\"checkpoint\": " + json_string(job.checkpoint) + ", ";
+    json += "\"interval\": " + string(interval) + ", ";
+    json += "\"resume\": " + string(job.resume ? "true" : "false") + ", ";
+  }
+  if (job.stack) json += "\"stack\": true, ";
+  if (!job.delta.empty()) {
+    char keyframes[32];
+    snprintf(keyframes, 32, "%d", job.keyframes);
+    json += "\"delta\": " + json_string(job.delta) + ", ";
+    json += "\"keyframes\": " + string(keyframes) + ", ";
+  }
+  if (job.regions) {
+    char gap[32];
+    snprintf(gap, 32, "%d", job.gap);
+    json += "\"regions\": true, ";
+    json += "\"gap\": " + string(gap) + ", ";
+  }
+  if (!job.hull.empty()) {
+    char vertices[32];
+    snprintf(vertices, 32, "%d", job.vertices);
+    json += "\"hull\": " + json_string(job.hull) + ", ";
+    json += "\"vertices\": " + string(vertices) + ", ";
+  }
+  if (!job.scales.empty()) json += "\"scales\": " + json_string(format_scales(job.scales)) + ", ";
+  if (!job.texture.empty()) {
+    json += "\"texture\": " + json_string(job.texture) + ", ";
+    json += "\"hq\": " + string(job.hq ? "true" : "false") + ", ";
+  }
+  if (job.colors > 0) {
+    char colors[32];
+    snprintf(colors, 32, "%d", job.colors);
+    json += "\"colors\": " + string(colors) + ", ";
+  }
+  if (!job.masks.empty()) {
+    char threshold[32];
+    snprintf(threshold, 32, "%d", job.threshold);
+    json += "\"masks\": " + json_string(job.masks) + ", ";
+    json += "\"threshold\": " + string(threshold) + ", ";
+  }
+  if (job.bleed > 0) {
+    char bleed[32];
+    snprintf(bleed, 32, "%d", job.bleed);
+    json += "\"bleed\": " + string(bleed) + ", ";
+  }
+  if (!job.tiles.empty()) {
+    char tilesize[32];
+    snprintf(tilesize, 32, "%d", job.tilesize);
+    json += "\"tiles\": " + json_string(job.tiles) + ", ";
+    json += "\"tilesize\": " + string(tilesize) + ", ";
+  }
+  if (job.segments > 0) {
+    char segments[32];
+    snprintf(segments, 32, "%d", job.segments);
+    json += "\"segments\": " + string(segments) + ", ";
+  }
+  json += numbers;
+  json += "\"mode\": \"" + string(mode) + "\", ";
+  json += "\"append\": " + string(job.append ? "true" : "false") + "}";
+  return json;
+}
+
+// ----------------------------------------------------------------------------
+Job job_from_json(const string &json, string *id)
+{
+  return job_from_fields(parse_json_object(json), id);
+}
+
+// ----------------------------------------------------------------------------
+/// Reply which reports the completion status of a job
+static string done_reply(const string &id, int nframes, const string &error)
+{
+  string reply("{\"id\": " + json_string(id) + ", \"event\": \"done\", ");
+  if (error.empty()) {
+    char n[64];
+    snprintf(n, 64, "\"status\": \"ok\", \"frames\": %d}\n", nframes);
+    reply += n;
+  } else {
+    reply += "\"status\": \"error\", \"message\": " + json_string(error) + "}\n";
+  }
+  return reply;
+}
+
+
+#ifndef _WIN32
+
+// ============================================================================
+// Service
+// ============================================================================
+
+/// Set by signal handler to stop the service
+static volatile sig_atomic_t stop_requested = 0;
+
+// ----------------------------------------------------------------------------
+static void handle_signal(int)
+{
+  stop_requested = 1;
+}
+
+// ----------------------------------------------------------------------------
+/// Write all data to file descriptor
+static bool write_all(int fd, const string &data)
+{
+  const char *p = data.data();
+  size_t      n = data.size();
+  while (n > 0) {
+    const ssize_t k = write(fd, p, n);
+    if (k < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    p += k, n -= static_cast<size_t>(k);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+/// Open connection to Unix domain socket
+static int connect_socket(const string &path)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw CImgIOException("Socket path %s too long!", path.c_str());
+  }
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path.c_str());
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// ----------------------------------------------------------------------------
+/// Maximum size of a request in bytes, beyond which the connection is closed
+static const size_t MAX_REQUEST_SIZE = 1024 * 1024;
+
+// ----------------------------------------------------------------------------
+/// Client connection to crop service
+struct Connection
+{
+  int             fd;
+  pthread_mutex_t mutex;   ///< Serializes replies and guards pending and eof.
+  int             pending; ///< Number of submitted jobs which are not completed.
+  bool            eof;     ///< Whether the client stopped sending requests.
+  string          buffer;  ///< Received data of incomplete request.
+
+  Connection(int fd) : fd(fd), pending(0), eof(false) { pthread_mutex_init(&mutex, NULL); }
+  ~Connection() { close(fd); pthread_mutex_destroy(&mutex); }
+
+  void reply(const string &msg)
+  {
+    pthread_mutex_lock(&mutex);
+    write_all(fd, msg);
+    pthread_mutex_unlock(&mutex);
+  }
+};
+
+// ----------------------------------------------------------------------------
+/// Mark job of connection as completed (eof=false) or end of requests (eof=true)
+///
+/// The connection is closed once the client stopped sending requests and
+/// all its jobs are completed.
+static void release(Connection *conn, bool eof)
+{
+  pthread_mutex_lock(&conn->mutex);
+  if (eof) conn->eof = true;
+  else     conn->pending -= 1;
+  const bool done = conn->eof && conn->pending == 0;
+  pthread_mutex_unlock(&conn->mutex);
+  if (done) delete conn;
+}
+
+// ----------------------------------------------------------------------------
+/// Crop job submitted to the service
+struct Task
+{
+  Job         job;
+  string      id;
+  Connection *conn;
+};
+
+// ----------------------------------------------------------------------------
+/// Queue of crop jobs shared by worker threads
+class TaskQueue
+{
+  pthread_mutex_t _mutex;
+  pthread_cond_t  _cond;
+  deque<Task>     _tasks;
+  bool            _closed;
+
+public:
+
+  TaskQueue() : _closed(false)
+  {
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init (&_cond,  NULL);
+  }
+
+  ~TaskQueue()
+  {
+    pthread_cond_destroy (&_cond);
+    pthread_mutex_destroy(&_mutex);
+  }
+
+  void push(const Task &task)
+  {
+    pthread_mutex_lock(&_mutex);
+    _tasks.push_back(task);
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+  }
+
+  /// Wake up workers waiting for tasks, which stop once the queue is empty
+  void close()
+  {
+    pthread_mutex_lock(&_mutex);
+    _closed = true;
+    pthread_cond_broadcast(&_cond);
+    pthread_mutex_unlock(&_mutex);
+  }
+
+  /// Wait for next task
+  ///
+  /// \returns Whether a task was dequeued or the queue was closed.
+  bool pop(Task &task)
+  {
+    pthread_mutex_lock(&_mutex);
+    while (_tasks.empty() && !_closed) pthread_cond_wait(&_cond, &_mutex);
+    const bool ok = !_tasks.empty();
+    if (ok) {
+      task = _tasks.front();
+      _tasks.pop_front();
+    }
+    pthread_mutex_unlock(&_mutex);
+    return ok;
+  }
+};
+
+// ----------------------------------------------------------------------------
+/// Worker thread of crop service
+struct Worker
+{
+  pthread_t  thread;
+  TaskQueue *queue;
+  int        nthreads;
+  int        verbose;
+};
+
+// ----------------------------------------------------------------------------
+/// Replies with the crop region of each frame of a task once it was written
+class BoxReplies : public Progress
+{
+  const Task &_task;
+
+public:
+
+  BoxReplies(const Task &task) : _task(task) {}
+
+  void written(int frame, const BoundingBox &b)
+  {
+    char fields[256];
+    snprintf(fields, 256, "\"frame\": %d, \"x0\": %d, \"y0\": %d, \"x1\": %d, \"y1\": %d}\n",
+             _task.job.fbegin + frame * _task.job.fstride, b.x0, b.y0, b.x1, b.y1);
+    _task.conn->reply("{\"id\": " + json_string(_task.id) + ", \"event\": \"box\", " + fields);
+  }
+};
+
+// ----------------------------------------------------------------------------
+static void *run_worker(void *arg)
+{
+  const Worker &worker = *static_cast<Worker *>(arg);
+#ifdef cimg_use_openmp
+  // jobs are processed in parallel by the workers instead
+  if (worker.nthreads > 1) omp_set_num_threads(1);
+#endif
+  // frame buffers are reused for all jobs of this worker
+  FramePool pool;
+  Sequence  seq;
+  Task      task;
+  while (worker.queue->pop(task)) {
+    const Job &job = task.job;
+    BoxReplies replies(task);
+    string error;
+    int    n = 0;
+    try {
+      n = process(job, seq, pool, NULL, NULL, &replies);
+    } catch (const exception &err) {
+      error = err.what();
+      if (error.empty()) error = "Unknown error";
+    }
+    task.conn->reply(done_reply(task.id, n, error));
+    if (worker.verbose) {
+      if (error.empty()) printf("Job %s: %d frames done\n", task.id.c_str(), n);
+      else               printf("Job %s: failed: %s\n", task.id.c_str(), error.c_str());
+      fflush(stdout);
+    }
+    release(task.conn, false);
+  }
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+/// Handle request line received from client
+///
+/// \returns Whether the service was requested to shut down.
+static bool handle_request(const string &line, Connection *conn, TaskQueue &queue, int &counter)
+{
+  const char *p = line.c_str();
+  skip_space(p);
+  if (!*p) return false;
+  string id;
+  try {
+    const map<string, string> fields = parse_json_object(line);
+    map<string, string>::const_iterator cmd = fields.find("command");
+    if (cmd != fields.end()) {
+      if (cmd->second == "shutdown") {
+        conn->reply("{\"event\": \"shutdown\"}\n");
+        return true;
+      }
+      throw CImgArgumentException("Unknown command %s", cmd->second.c_str());
+    }
+    Task task;
+    task.job  = job_from_fields(fields, &id);
+    task.conn = conn;
+    if (id.empty()) {
+      char n[32];
+      snprintf(n, 32, "%d", ++counter);
+      id = n;
+    }
+    task.id = id;
+    pthread_mutex_lock(&conn->mutex);
+    conn->pending += 1;
+    pthread_mutex_unlock(&conn->mutex);
+    queue.push(task);
+  } catch (const exception &err) {
+    conn->reply(done_reply(id, 0, err.what()));
+  }
+  return false;
+}
+
+// ----------------------------------------------------------------------------
+void serve(const string &path, int nthreads, int verbose)
+{
+  if (nthreads < 1) nthreads = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+  if (nthreads < 1) nthreads = 1;
+  // Refuse to take over socket of running service
+  int fd = connect_socket(path);
+  if (fd >= 0) {
+    close(fd);
+    throw CImgIOException("Crop service already running at %s!", path.c_str());
+  }
+  // Remove socket of a service which was not shut down, but no other file
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) {
+      throw CImgIOException("Cannot listen on %s, file exists and is not a socket!", path.c_str());
+    }
+    unlink(path.c_str());
+  }
+  // Listen on socket
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path.c_str());
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+    const int err = errno;
+    if (fd >= 0) close(fd);
+    throw CImgIOException("Failed to listen on socket %s: %s", path.c_str(), strerror(err));
+  }
+  stop_requested = 0;
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT,  handle_signal);
+  signal(SIGTERM, handle_signal);
+  // Start persistent workers
+  TaskQueue      queue;
+  vector<Worker> workers(nthreads);
+  for (int i = 0; i < nthreads; ++i) {
+    workers[i].queue    = &queue;
+    workers[i].nthreads = nthreads;
+    workers[i].verbose  = verbose;
+    pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]);
+  }
+  if (verbose) {
+    printf("Crop service listening on %s using %d worker threads\n", path.c_str(), nthreads);
+    fflush(stdout);
+  }
+  // Receive requests
+  vector<Connection *> conns;
+  vector<pollfd>       fds;
+  bool stop    = false;
+  int  counter = 0;
+  while (!stop && !stop_requested) {
+    fds.resize(conns.size() + 1);
+    fds[0].fd     = fd;
+    fds[0].events = POLLIN;
+    for (size_t i = 0; i < conns.size(); ++i) {
+      fds[i + 1].fd     = conns[i]->fd;
+      fds[i + 1].events = POLLIN;
+    }
+    for (size_t i = 0; i < fds.size(); ++i) fds[i].revents = 0;
+    if (poll(&fds[0], fds.size(), 250) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    vector<Connection *> open;
+    for (size_t i = 0; i < conns.size(); ++i) {
+      Connection *conn = conns[i];
+      if (fds[i + 1].revents == 0) {
+        open.push_back(conn);
+        continue;
+      }
+      char buffer[4096];
+      const ssize_t n = read(conn->fd, buffer, sizeof(buffer));
+      if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        open.push_back(conn);
+        continue;
+      }
+      if (n <= 0) {
+        release(conn, true);
+        continue;
+      }
+      conn->buffer.append(buffer, static_cast<size_t>(n));
+      size_t pos;
+      while ((pos = conn->buffer.find('\n')) != string::npos) {
+        const string line = conn->buffer.substr(0, pos);
+        conn->buffer.erase(0, pos + 1);
+        if (handle_request(line, conn, queue, counter)) stop = true;
+      }
+      if (conn->buffer.size() > MAX_REQUEST_SIZE) {
+        char msg[128];
+        snprintf(msg, 128, "Request exceeds maximum size of %u bytes", static_cast<unsigned int>(MAX_REQUEST_SIZE));
+        conn->reply(done_reply("", 0, msg));
+        release(conn, true);
+        continue;
+      }
+      open.push_back(conn);
+    }
+    conns.swap(open);
+    if (fds[0].revents & POLLIN) {
+      const int c = accept(fd, NULL, NULL);
+      if (c >= 0) conns.push_back(new Connection(c));
+    }
+  }
+  // Stop accepting new connections and complete pending jobs
+  close(fd);
+  unlink(path.c_str());
+  queue.close();
+  for (int i = 0; i < nthreads; ++i) pthread_join(workers[i].thread, NULL);
+  for (size_t i = 0; i < conns.size(); ++i) release(conns[i], true);
+  if (verbose) {
+    printf("Crop service stopped\n");
+    fflush(stdout);
+  }
+}
+
+// ============================================================================
+// Client
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Read next line of replies from crop service
+static bool read_line(int fd, string &buffer, string &line)
+{
+  size_t pos;
+  while ((pos = buffer.find('\n')) == string::npos) {
+    char data[4096];
+    const ssize_t n = read(fd, data, sizeof(data));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    buffer.append(data, static_cast<size_t>(n));
+  }
+  line = buffer.substr(0, pos);
+  buffer.erase(0, pos + 1);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static int connect_service(const string &path)
+{
+  const int fd = connect_socket(path);
+  if (fd < 0) {
+    throw CImgIOException("Crop service not available at %s: %s", path.c_str(), strerror(errno));
+  }
+  signal(SIGPIPE, SIG_IGN);
+  return fd;
+}
+
+// ----------------------------------------------------------------------------
+int submit(const string &path, const vector<Job> &jobs, FILE *out)
+{
+  const int fd = connect_service(path);
+  // Send all requests at once, the service processes them in parallel
+  string requests;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    char id[32];
+    snprintf(id, 32, "%d", int(i) + 1);
+    requests += to_json(jobs[i], id) + "\n";
+  }
+  if (!write_all(fd, requests)) {
+    close(fd);
+    throw CImgIOException("Failed to send jobs to crop service at %s!", path.c_str());
+  }
+  // Wait for completion of all jobs
+  string buffer, line;
+  int ndone = 0, nfailed = 0;
+  while (ndone < int(jobs.size())) {
+    if (!read_line(fd, buffer, line)) {
+      close(fd);
+      throw CImgIOException("Connection to crop service closed before all jobs were completed!");
+    }
+    if (out) {
+      fprintf(out, "%s\n", line.c_str());
+      fflush(out);
+    }
+    map<string, string> fields;
+    try {
+      fields = parse_json_object(line);
+    } catch (const CImgException &) {
+      continue;
+    }
+    if (fields["event"] == "done") {
+      ++ndone;
+      if (fields["status"] != "ok") ++nfailed;
+    }
+  }
+  close(fd);
+  return nfailed;
+}
+
+// ----------------------------------------------------------------------------
+void shutdown_service(const string &path)
+{
+  const int fd = connect_service(path);
+  string buffer, line;
+  const bool ok = write_all(fd, "{\"command\": \"shutdown\"}\n") && read_line(fd, buffer, line);
+  close(fd);
+  if (!ok) {
+    throw CImgIOException("Failed to shut down crop service at %s!", path.c_str());
+  }
+}
+
+#else // _WIN32
+
+// ----------------------------------------------------------------------------
+void serve(const string &, int, int)
+{
+  throw CImgIOException("Crop service not supported on this platform!");
+}
+
+// ----------------------------------------------------------------------------
+int submit(const string &, const vector<Job> &, FILE *)
+{
+  throw CImgIOException("Crop service not supported on this platform!");
+}
+
+// ----------------------------------------------------------------------------
+void shutdown_service(const string &)
+{
+  throw CImgIOException("Crop service not supported on this platform!");
+}
+
+#endif // _WIN32
+
+
+} // namespace animtk
@@ -0,0 +1,102 @@
+/* Crop service of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_SERVICE_H
+#define ANIMTK_SERVICE_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Protocol
+// ============================================================================
+
+// The crop service listens on a local (Unix domain) socket. Clients send one
+// JSON object per line, either a crop job such as
+//
+//   {"id": "walk", "input": "/renders/walk_%05d.png", "output": "/out/walk.png",
+//    "csv": "/out/walk.csv", "begin": 0, "end": -1, "stride": 1,
+//    "mode": "union", "append": false, "cache": "/var/cache/animtk"}
+//
+// or a command such as {"command": "shutdown"}. For each job, the service
+// replies with one line per frame containing its crop region as soon as the
+// frame was written (see Progress), followed by a line with the completion
+// status of the job:
+//
+//   {"id": "walk", "event": "box", "frame": 0, "x0": 12, "y0": 4, "x1": 51, "y1": 80}
+//   {"id": "walk", "event": "done", "status": "ok", "frames": 24}
+//   {"id": "walk", "event": "done", "status": "error", "message": "..."}
+//
+// Replies of jobs which are submitted over the same connection may interleave.
+// All file paths are interpreted by the service, i.e., should be absolute.
+// A connection whose request exceeds 1 MB without line break is closed.
+
+/// Serialize crop job as JSON request
+std::string to_json(const Job &job, const std::string &id = std::string());
+
+/// Parse JSON request of a crop job
+///
+/// \param[in]  json JSON object.
+/// \param[out] id   Value of "id" field. Not returned if \c NULL.
+///
+/// \throws cimg_library::CImgArgumentException if the request is invalid.
+Job job_from_json(const std::string &json, std::string *id = NULL);
+
+// ============================================================================
+// Service
+// ============================================================================
+
+/// Run crop service until it is shut down by a client or signal
+///
+/// Jobs are processed by a persistent pool of worker threads, each of which
+/// reuses its frame buffers for all jobs it processes.
+///
+/// \param socket   File path of the Unix domain socket. An existing socket of
+///                 a service which is no longer running is replaced.
+/// \param nthreads Number of worker threads. Number of CPUs if not positive.
+/// \param verbose  Print status messages to stdout.
+///
+/// \throws cimg_library::CImgIOException if the service could not be started,
+///         e.g., because the socket path is an existing file which is not a socket.
+void serve(const std::string &socket, int nthreads = 0, int verbose = 0);
+
+/// Submit crop jobs to crop service and wait for their completion
+///
+/// \param socket File path of the Unix domain socket.
+/// \param jobs   Crop jobs.
+/// \param out    Output stream to which the replies of the service are written.
+///               No output if \c NULL.
+///
+/// \returns Number of failed jobs.
+///
+/// \throws cimg_library::CImgIOException if the service is not available.
+int submit(const std::string &socket, const std::vector<Job> &jobs, FILE *out = NULL);
+
+/// Request crop service to shut down after all pending jobs are completed
+///
+/// \throws cimg_library::CImgIOException if the service is not available.
+void shutdown_service(const std::string &socket);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_SERVICE_H
@@ -0,0 +1,209 @@
+/* Sharded processing of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pool.h"
+#include "shard.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Box tables
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+BoxTable read_table(const char *fname)
+{
+  FILE *fp = fopen(fname, "r");
+  if (!fp) {
+    throw CImgIOException("Failed to open box table %s!", fname);
+  }
+  BoxTable table;
+  int version = 0;
+  if (fscanf(fp, "animtk-boxes %d %d %d %d %d %d", &version, &table.width, &table.height,
+             &table.nframes, &table.fbegin, &table.fstride) != 6 || version != 1) {
+    fclose(fp);
+    throw CImgIOException("Invalid box table %s!", fname);
+  }
+  int         i, frame;
+  BoundingBox b;
+  while (fscanf(fp, "%d %d %d %d %d %d", &i, &frame, &b.x0, &b.y0, &b.x1, &b.y1) == 6) {
+    table.index.push_back(i);
+    table.boxes.push_back(b);
+  }
+  const bool eof = (feof(fp) != 0);
+  fclose(fp);
+  if (!eof) {
+    throw CImgIOException("Invalid row %u of box table %s!", (unsigned int)table.index.size() + 1, fname);
+  }
+  return table;
+}
+
+// ----------------------------------------------------------------------------
+void write_table(const char *fname, const BoxTable &table)
+{
+  FILE *fp = fopen(fname, "w");
+  if (!fp) {
+    throw CImgIOException("Failed to open box table %s for writing!", fname);
+  }
+  fprintf(fp, "animtk-boxes 1 %d %d %d %d %d\n", table.width, table.height,
+          table.nframes, table.fbegin, table.fstride);
+  for (size_t i = 0; i < table.index.size(); ++i) {
+    const BoundingBox &b = table.boxes[i];
+    fprintf(fp, "%d %d %d %d %d %d\n", table.index[i], table.frame(i), b.x0, b.y0, b.x1, b.y1);
+  }
+  if (fclose(fp) != 0) {
+    throw CImgIOException("Failed to write box table %s!", fname);
+  }
+}
+
+// ============================================================================
+// Shards
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+bool parse_shard(const char *spec, int &shard, int &nshards)
+{
+  char end = '\0';
+  return sscanf(spec, "%d/%d%c", &shard, &nshards, &end) == 2 && 1 <= shard && shard <= nshards;
+}
+
+// ----------------------------------------------------------------------------
+void shard_range(int nframes, int shard, int nshards, int &first, int &last)
+{
+  first = int((long long)(shard - 1) * nframes / nshards);
+  last  = int((long long)(shard    ) * nframes / nshards);
+}
+
+// ----------------------------------------------------------------------------
+BoxTable analyze_shard(const Job &job, int shard, int nshards)
+{
+  if (!contains_pattern(job.input)) {
+    throw CImgArgumentException("analyze_shard(): Input must be a file name pattern such as frames_%%05d.png");
+  }
+  const char *option = extra_option(job);
+  if (option) {
+    throw CImgArgumentException("analyze_shard(): Option %s is not supported by sharded processing", option);
+  }
+  const vector<string> fnames = frame_files(job.input, job.fbegin, job.fend, job.fstride);
+  if (fnames.empty()) {
+    throw CImgIOException("Input image sequence %s is empty!", job.input.c_str());
+  }
+  BoxTable table;
+  table.nframes = int(fnames.size());
+  table.fbegin  = job.fbegin;
+  table.fstride = job.fstride;
+  int first, last;
+  shard_range(table.nframes, shard, nshards, first, last);
+  Sequence seq(last - first);
+  for (int i = first; i < last; ++i) {
+    seq[i - first].load(fnames[i].c_str());
+    table.index.push_back(i);
+  }
+  if (seq.size() > 0) {
+    table.width  = seq.front().width();
+    table.height = seq.front().height();
+    table.boxes  = analyze(seq);
+  }
+  return table;
+}
+
+// ----------------------------------------------------------------------------
+BoxTable merge(const vector<BoxTable> &tables, CropMode mode, double cost)
+{
+  if (tables.empty()) {
+    throw CImgArgumentException("merge(): No box tables given");
+  }
+  BoxTable res;
+  res.nframes = tables.front().nframes;
+  res.fbegin  = tables.front().fbegin;
+  res.fstride = tables.front().fstride;
+  res.index.resize(res.nframes);
+  res.boxes.resize(res.nframes);
+  vector<char> found(res.nframes, 0);
+  for (size_t t = 0; t < tables.size(); ++t) {
+    const BoxTable &table = tables[t];
+    if (table.nframes != res.nframes || table.fbegin != res.fbegin || table.fstride != res.fstride) {
+      throw CImgArgumentException("merge(): Box tables belong to different image sequences");
+    }
+    if (table.index.empty()) continue;
+    if (res.width == 0) {
+      res.width  = table.width;
+      res.height = table.height;
+    } else if (table.width != res.width || table.height != res.height) {
+      throw CImgArgumentException("merge(): Frames of shards differ in size (%dx%d vs. %dx%d)",
+                                  table.width, table.height, res.width, res.height);
+    }
+    for (size_t i = 0; i < table.index.size(); ++i) {
+      const int j = table.index[i];
+      if (j < 0 || j >= res.nframes || found[j]) {
+        throw CImgArgumentException("merge(): Invalid or duplicate frame %d in box tables", table.frame(i));
+      }
+      res.index[j] = j;
+      res.boxes[j] = table.boxes[i];
+      found[j]     = 1;
+    }
+  }
+  for (int j = 0; j < res.nframes; ++j) {
+    if (!found[j]) {
+      throw CImgArgumentException("merge(): Frame %d missing in box tables", res.fbegin + j * res.fstride);
+    }
+  }
+  adjust(res.boxes, mode, res.width, res.height, cost);
+  return res;
+}
+
+// ----------------------------------------------------------------------------
+int crop_shard(const Job &job, const BoxTable &table, int shard, int nshards)
+{
+  if (!contains_pattern(job.input)) {
+    throw CImgArgumentException("crop_shard(): Input must be a file name pattern such as frames_%%05d.png");
+  }
+  const char *option = extra_option(job);
+  if (option) {
+    throw CImgArgumentException("crop_shard(): Option %s is not supported by sharded processing", option);
+  }
+  if (CImgList<>::is_saveable(job.output.c_str())) {
+    throw CImgArgumentException("crop_shard(): Output %s cannot be written by multiple shards", job.output.c_str());
+  }
+  if (int(table.index.size()) != table.nframes) {
+    throw CImgArgumentException("crop_shard(): Box table does not cover all frames, merge shard tables first");
+  }
+  int first, last;
+  shard_range(table.nframes, shard, nshards, first, last);
+  FramePool pool;
+  Frame     frame;
+  char      fname[1024], ofname[1024];
+  for (int i = first; i < last; ++i) {
+    const BoundingBox &b = table.boxes[i];
+    snprintf(fname, 1024, job.input.c_str(), table.frame(i));
+    if (table.nframes == 1) snprintf(ofname, 1024, "%s", job.output.c_str());
+    else                    cimg::number_filename(job.output.c_str(), i, 6, ofname);
+    pool.load(frame, fname);
+    pool.crop(frame, b);
+    pool.save(frame, ofname);
+  }
+  return last - first;
+}
+
+
+} // namespace animtk
@@ -0,0 +1,114 @@
+/* Sharded processing of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_SHARD_H
+#define ANIMTK_SHARD_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Box tables
+// ============================================================================
+
+/// Crop regions of all or a subset of the frames of an image sequence
+///
+/// A box table is stored as text file with a header line followed by one
+/// line per frame with its position in the sequence, frame number, and
+/// crop region:
+///
+///   animtk-boxes 1 <width> <height> <nframes> <fbegin> <fstride>
+///   <index> <frame> <x0> <y0> <x1> <y1>
+///   ...
+struct BoxTable
+{
+  int              width;   ///< Width of input frames.
+  int              height;  ///< Height of input frames.
+  int              nframes; ///< Total number of frames of the sequence.
+  int              fbegin;  ///< Index of first frame of the sequence.
+  int              fstride; ///< Increment of frame indices.
+  std::vector<int> index;   ///< Position of each frame in the sequence.
+  BoundingBoxes    boxes;   ///< Crop region of each frame.
+
+  BoxTable() : width(0), height(0), nframes(0), fbegin(0), fstride(1) {}
+
+  /// Frame number of the i-th table entry
+  int frame(size_t i) const { return fbegin + index[i] * fstride; }
+};
+
+/// Read box table
+///
+/// \throws cimg_library::CImgIOException if the file could not be read.
+BoxTable read_table(const char *fname);
+
+/// Write box table
+///
+/// \throws cimg_library::CImgIOException if the file could not be written.
+void write_table(const char *fname, const BoxTable &table);
+
+// ============================================================================
+// Shards
+// ============================================================================
+
+/// Parse shard specification "i/n", where 1 <= i <= n
+///
+/// \returns Whether the specification is valid.
+bool parse_shard(const char *spec, int &shard, int &nshards);
+
+/// Determine contiguous range of sequence positions [first, last) of a shard
+void shard_range(int nframes, int shard, int nshards, int &first, int &last);
+
+/// Analyze the frames of a shard of the input sequence
+///
+/// \returns Partial table of unadjusted crop regions.
+///
+/// \throws cimg_library::CImgArgumentException if the job has options beyond
+///         cropping the frames (see extra_option()).
+/// \throws cimg_library::CImgException if a frame could not be read.
+BoxTable analyze_shard(const Job &job, int shard, int nshards);
+
+/// Combine partial tables of all shards and adjust the crop regions
+///
+/// The crop regions are adjusted using adjust() as if the whole sequence
+/// had been analyzed by a single process, where \p cost is the cost of each
+/// segment in CROP_SEGMENTED mode.
+///
+/// \throws cimg_library::CImgArgumentException if the tables do not belong to
+///         the same sequence or do not cover all of its frames.
+BoxTable merge(const std::vector<BoxTable> &tables, CropMode mode, double cost = 0.);
+
+/// Crop the frames of a shard using the crop regions of a merged table
+///
+/// Each frame is written to its own output file, numbered by its position in
+/// the whole sequence as if all frames were written by a single process.
+///
+/// \returns Number of frames cropped.
+///
+/// \throws cimg_library::CImgArgumentException if the job has options beyond
+///         cropping the frames (see extra_option()).
+/// \throws cimg_library::CImgException if the job failed.
+int crop_shard(const Job &job, const BoxTable &table, int shard, int nshards);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_SHARD_H
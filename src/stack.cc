@@ -0,0 +1,137 @@
+/* Contiguous frame storage of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+
+#include "stack.h"
+
+#ifdef __linux__
+#  include <sys/mman.h>
+#endif
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Size of huge pages
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// ----------------------------------------------------------------------------
+/// Allocate memory block, using huge pages for large blocks if possible
+static unsigned char *allocate(size_t size)
+{
+  void *p = NULL;
+#ifdef __linux__
+  if (size >= HUGE_PAGE_SIZE) {
+    size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (posix_memalign(&p, HUGE_PAGE_SIZE, size) != 0) p = NULL;
+#  ifdef MADV_HUGEPAGE
+    if (p) madvise(p, size, MADV_HUGEPAGE);
+#  endif
+    return static_cast<unsigned char *>(p);
+  }
+#endif
+  p = malloc(size);
+  return static_cast<unsigned char *>(p);
+}
+
+// ============================================================================
+// Frame stack
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+FrameStack::FrameStack()
+:
+  _data(NULL), _capacity(0), _width(0), _height(0), _channels(0), _frames(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+FrameStack::~FrameStack()
+{
+  clear();
+}
+
+// ----------------------------------------------------------------------------
+void FrameStack::assign(int width, int height, int channels, int frames)
+{
+  if (width < 1 || height < 1 || channels < 1 || frames < 1) {
+    throw CImgArgumentException("FrameStack::assign(): Invalid stack size %dx%dx%dx%d",
+                                width, height, channels, frames);
+  }
+  const size_t size = size_t(width) * height * channels * frames;
+  if (size > _capacity) {
+    clear();
+    _data = allocate(size);
+    if (!_data) {
+      throw CImgInstanceException("FrameStack::assign(): Failed to allocate memory (%s) for %d frames of size %dx%dx%d",
+                                  cimg::strbuffersize(size), frames, width, height, channels);
+    }
+    _capacity = size;
+  }
+  _width    = width;
+  _height   = height;
+  _channels = channels;
+  _frames   = frames;
+}
+
+// ----------------------------------------------------------------------------
+void FrameStack::clear()
+{
+  free(_data);
+  _data     = NULL;
+  _capacity = 0;
+  _width = _height = _channels = _frames = 0;
+}
+
+// ----------------------------------------------------------------------------
+Frame FrameStack::frame(int i)
+{
+  if (i < 0 || i >= _frames) {
+    throw CImgArgumentException("FrameStack::frame(): Invalid frame index %d, stack has %d frames", i, _frames);
+  }
+  return Frame(data(i), _width, _height, 1, _channels, true);
+}
+
+// ----------------------------------------------------------------------------
+void FrameStack::view(Sequence &seq)
+{
+  const unsigned int n = static_cast<unsigned int>(_frames);
+  if (seq.size() > n) seq.remove(n, seq.size() - 1);
+  if (seq.size() < n) seq.insert(n - seq.size());
+  for (int i = 0; i < _frames; ++i) seq[i].assign(data(i), _width, _height, 1, _channels, true);
+}
+
+// ----------------------------------------------------------------------------
+size_t FrameStack::capacity(const Frame &frame) const
+{
+  if (!frame.is_shared() || _frames == 0) return 0;
+  const unsigned char *p = frame.data();
+  if (p < _data || p >= _data + _frames * frame_size()) return 0;
+  return size_t(p - _data) % frame_size() == 0 ? frame_size() : 0;
+}
+
+
+} // namespace animtk
@@ -0,0 +1,99 @@
+/* Contiguous frame storage of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_STACK_H
+#define ANIMTK_STACK_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Frame stack
+// ============================================================================
+
+/// Image sequence stored in a single contiguous block of memory
+///
+/// The frames are stored one after another, each with its channels in
+/// separate planes, i.e., the block is a width x height x channels x frames
+/// array. Scanning the frames in order thus streams linearly through memory.
+/// On Linux, blocks of at least 2 MB are aligned to and backed by transparent
+/// huge pages where available.
+class FrameStack
+{
+  unsigned char *_data;     ///< Memory block.
+  size_t         _capacity; ///< Size of memory block in bytes.
+  int            _width;    ///< Width of frames.
+  int            _height;   ///< Height of frames.
+  int            _channels; ///< Number of channels of frames.
+  int            _frames;   ///< Number of frames.
+
+public:
+
+  FrameStack();
+  ~FrameStack();
+
+  /// Set size of stack, reusing its memory if the block is large enough
+  ///
+  /// The pixel values are undefined.
+  ///
+  /// \throws cimg_library::CImgInstanceException if the memory could not be allocated.
+  void assign(int width, int height, int channels, int frames);
+
+  /// Release memory
+  void clear();
+
+  int width   () const { return _width;    } ///< Width of frames.
+  int height  () const { return _height;   } ///< Height of frames.
+  int channels() const { return _channels; } ///< Number of channels of frames.
+  int frames  () const { return _frames;   } ///< Number of frames.
+
+  /// Size of a single frame in bytes
+  size_t frame_size() const { return size_t(_width) * _height * _channels; }
+
+  /// Pixel data of the i-th frame
+  unsigned char *data(int i = 0) { return _data + i * frame_size(); }
+
+  /// Pixel data of the i-th frame
+  const unsigned char *data(int i = 0) const { return _data + i * frame_size(); }
+
+  /// Frame which shares the memory of the i-th frame of the stack
+  Frame frame(int i);
+
+  /// Let the frames of a sequence share the memory of the stack
+  void view(Sequence &seq);
+
+  /// Size of the frame of the stack whose memory is shared by the given frame
+  ///
+  /// \returns Size of a frame of the stack in bytes, or 0 if \p frame does
+  ///          not share the memory of one of the frames of the stack.
+  size_t capacity(const Frame &frame) const;
+
+private:
+
+  FrameStack(const FrameStack &);
+  FrameStack &operator =(const FrameStack &);
+};
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_STACK_H
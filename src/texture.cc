@@ -0,0 +1,647 @@
+/* BCn compressed texture output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "texture.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Pixels of a 4x4 block, RGBA in row-major order
+typedef unsigned char Block[16][4];
+
+/// Interpolation weights of the 4-bit indices of BC7 blocks
+static const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+#ifdef cimg_use_openmp
+
+// ----------------------------------------------------------------------------
+/// Whether the blocks of a frame of the given size are compressed by multiple threads
+static bool parallel(size_t size)
+{
+  return size >= parallel_frame_size() && !omp_in_parallel() && omp_get_max_threads() > 1;
+}
+
+#endif // cimg_use_openmp
+
+// ----------------------------------------------------------------------------
+/// Copy pixels of block to RGBA, repeating the last column and row of the frame
+static void load_block(const Frame &frame, int bx, int by, Block px)
+{
+  const int nc = frame.spectrum();
+  for (int j = 0; j < 4; ++j)
+  for (int i = 0; i < 4; ++i) {
+    const int x = cimg::min(4 * bx + i, frame.width()  - 1);
+    const int y = cimg::min(4 * by + j, frame.height() - 1);
+    unsigned char *p = px[4 * j + i];
+    if (nc < 3) p[0] = p[1] = p[2] = frame(x, y, 0, 0);
+    else for (int c = 0; c < 3; ++c) p[c] = frame(x, y, 0, c);
+    p[3] = (nc == 2 || nc >= 4) ? frame(x, y, 0, nc == 2 ? 1 : 3) : 255;
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Fit endpoints of a line segment to the colors of the used pixels of a block
+///
+/// \param[in]  px  Pixels of block.
+/// \param[in]  use Whether each pixel is used. At least one pixel must be used.
+/// \param[in]  nc  Number of channels, 3 for RGB or 4 for RGBA.
+/// \param[in]  hq  Fit principal axis instead of using the bounding box.
+/// \param[out] e0  First endpoint.
+/// \param[out] e1  Second endpoint.
+static void fit_endpoints(const Block px, const bool *use, int nc, bool hq, float *e0, float *e1)
+{
+  float mean[4] = {0.f, 0.f, 0.f, 0.f}, lo[4], hi[4];
+  int   n = 0;
+  for (int c = 0; c < nc; ++c) lo[c] = 255.f, hi[c] = 0.f;
+  for (int i = 0; i < 16; ++i) {
+    if (!use[i]) continue;
+    for (int c = 0; c < nc; ++c) {
+      mean[c] += px[i][c];
+      lo[c] = cimg::min(lo[c], float(px[i][c]));
+      hi[c] = cimg::max(hi[c], float(px[i][c]));
+    }
+    ++n;
+  }
+  for (int c = 0; c < nc; ++c) mean[c] /= n;
+  float cov[4][4];
+  for (int a = 0; a < nc; ++a)
+  for (int b = 0; b < nc; ++b) {
+    cov[a][b] = 0.f;
+    for (int i = 0; i < 16; ++i) {
+      if (use[i]) cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+    }
+  }
+  if (!hq) {
+    // Diagonal of bounding box whose direction follows the covariance of
+    // each channel with the channel of largest range, inset by 1/16 except
+    // for alpha, such that transparent and opaque pixels remain exact
+    int k = 0;
+    for (int c = 1; c < nc; ++c) if (hi[c] - lo[c] > hi[k] - lo[k]) k = c;
+    for (int c = 0; c < nc; ++c) {
+      const float d = (c < 3 ? (hi[c] - lo[c]) / 16.f : 0.f);
+      e0[c] = lo[c] + d;
+      e1[c] = hi[c] - d;
+      if (cov[k][c] < 0.f) swap(e0[c], e1[c]);
+    }
+    return;
+  }
+  // Principal axis by power iteration, starting with the bounding box diagonal
+  float axis[4];
+  for (int c = 0; c < nc; ++c) axis[c] = hi[c] - lo[c];
+  for (int iter = 0; iter < 8; ++iter) {
+    float v[4], norm = 0.f;
+    for (int a = 0; a < nc; ++a) {
+      v[a] = 0.f;
+      for (int b = 0; b < nc; ++b) v[a] += cov[a][b] * axis[b];
+      norm = cimg::max(norm, cimg::abs(v[a]));
+    }
+    if (norm <= 0.f) break;
+    for (int c = 0; c < nc; ++c) axis[c] = v[c] / norm;
+  }
+  float len = 0.f;
+  for (int c = 0; c < nc; ++c) len += axis[c] * axis[c];
+  if (len <= 0.f) {
+    for (int c = 0; c < nc; ++c) e0[c] = e1[c] = mean[c];
+    return;
+  }
+  // Extent of colors projected onto axis
+  float tmin = 0.f, tmax = 0.f;
+  for (int i = 0; i < 16; ++i) {
+    if (!use[i]) continue;
+    float t = 0.f;
+    for (int c = 0; c < nc; ++c) t += (px[i][c] - mean[c]) * axis[c];
+    tmin = cimg::min(tmin, t / len);
+    tmax = cimg::max(tmax, t / len);
+  }
+  for (int c = 0; c < nc; ++c) {
+    e0[c] = cimg::max(0.f, cimg::min(255.f, mean[c] + tmin * axis[c]));
+    e1[c] = cimg::max(0.f, cimg::min(255.f, mean[c] + tmax * axis[c]));
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Least squares fit of endpoints given the interpolation weight of each pixel
+///
+/// \returns Whether the endpoints are well defined, i.e., whether the weights
+///          of the used pixels are not all the same.
+static bool refine_endpoints(const Block px, const bool *use, const float *w, int nc, float *e0, float *e1)
+{
+  float aa = 0.f, ab = 0.f, bb = 0.f, pa[4] = {0.f, 0.f, 0.f, 0.f}, pb[4] = {0.f, 0.f, 0.f, 0.f};
+  for (int i = 0; i < 16; ++i) {
+    if (!use[i]) continue;
+    const float a = 1.f - w[i], b = w[i];
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < nc; ++c) {
+      pa[c] += a * px[i][c];
+      pb[c] += b * px[i][c];
+    }
+  }
+  const float det = aa * bb - ab * ab;
+  if (cimg::abs(det) < 1e-6f) return false;
+  for (int c = 0; c < nc; ++c) {
+    e0[c] = cimg::max(0.f, cimg::min(255.f, (bb * pa[c] - ab * pb[c]) / det));
+    e1[c] = cimg::max(0.f, cimg::min(255.f, (aa * pb[c] - ab * pa[c]) / det));
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+/// Write 16 bit value in little endian byte order
+static inline unsigned char *put16(unsigned char *p, unsigned int v)
+{
+  p[0] = static_cast<unsigned char>(v);
+  p[1] = static_cast<unsigned char>(v >> 8);
+  return p + 2;
+}
+
+// ----------------------------------------------------------------------------
+/// Write 32 bit value in little endian byte order
+static inline unsigned char *put32(unsigned char *p, unsigned long v)
+{
+  p = put16(p, static_cast<unsigned int>(v & 0xffff));
+  return put16(p, static_cast<unsigned int>(v >> 16));
+}
+
+// ============================================================================
+// BC1 color blocks
+// ============================================================================
+
+/// Color block with its squared error
+struct ColorBlock
+{
+  unsigned int  c0, c1; ///< Endpoints in 5:6:5 format.
+  unsigned long bits;   ///< 2-bit index of each pixel.
+  int           error;  ///< Sum of squared errors of used pixels.
+};
+
+// ----------------------------------------------------------------------------
+/// Quantize color to 5:6:5 format
+static unsigned int pack565(const float *c)
+{
+  const int r = cimg::max(0, cimg::min(31, int(c[0] * 31.f / 255.f + .5f)));
+  const int g = cimg::max(0, cimg::min(63, int(c[1] * 63.f / 255.f + .5f)));
+  const int b = cimg::max(0, cimg::min(31, int(c[2] * 31.f / 255.f + .5f)));
+  return static_cast<unsigned int>((r << 11) | (g << 5) | b);
+}
+
+// ----------------------------------------------------------------------------
+/// Expand color of 5:6:5 format
+static void unpack565(unsigned int v, int *c)
+{
+  const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+  c[0] = (r << 3) | (r >> 2);
+  c[1] = (g << 2) | (g >> 4);
+  c[2] = (b << 3) | (b >> 2);
+}
+
+// ----------------------------------------------------------------------------
+/// Choose indices of color block with the given endpoints
+///
+/// \param punch Whether pixels which are not used are transparent, which
+///              requires the three color mode with c0 <= c1. Otherwise, the
+///              four color mode with c0 > c1 is used unless c0 == c1.
+static ColorBlock color_block(const Block px, const bool *use, bool punch, unsigned int c0, unsigned int c1)
+{
+  ColorBlock blk;
+  if (punch ? c0 > c1 : c0 < c1) swap(c0, c1);
+  blk.c0 = c0, blk.c1 = c1, blk.bits = 0, blk.error = 0;
+  int pal[4][3];
+  unpack565(c0, pal[0]);
+  unpack565(c1, pal[1]);
+  const int ncolors = (c0 > c1 ? 4 : 3);
+  for (int c = 0; c < 3; ++c) {
+    if (ncolors == 4) {
+      pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+      pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+    } else {
+      pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+      pal[3][c] = 0;
+    }
+  }
+  for (int i = 0; i < 16; ++i) {
+    int best = 0, error = 0;
+    if (punch && !use[i]) {
+      best = 3;
+    } else {
+      for (int k = 0; k < ncolors; ++k) {
+        int e = 0;
+        for (int c = 0; c < 3; ++c) e += (px[i][c] - pal[k][c]) * (px[i][c] - pal[k][c]);
+        if (k == 0 || e < error) best = k, error = e;
+      }
+      if (use[i]) blk.error += error;
+    }
+    blk.bits |= static_cast<unsigned long>(best) << (2 * i);
+  }
+  return blk;
+}
+
+// ----------------------------------------------------------------------------
+/// Encode colors of used pixels of block as BC1 color block of 8 bytes
+static void encode_color(const Block px, const bool *use, bool punch, bool hq, unsigned char *out)
+{
+  int n = 0;
+  for (int i = 0; i < 16; ++i) n += use[i];
+  ColorBlock best;
+  if (n == 0) {
+    best = color_block(px, use, punch, 0, 0);
+  } else {
+    float e0[4], e1[4];
+    fit_endpoints(px, use, 3, hq, e0, e1);
+    best = color_block(px, use, punch, pack565(e0), pack565(e1));
+    // Refine endpoints given the indices of the pixels
+    for (int iter = 0; hq && iter < 2 && best.error > 0; ++iter) {
+      float w[16];
+      for (int i = 0; i < 16; ++i) {
+        const int k = (best.bits >> (2 * i)) & 3;
+        if (best.c0 > best.c1) w[i] = (k == 0 ? 0.f : (k == 1 ? 1.f : (k == 2 ? 1.f / 3.f : 2.f / 3.f)));
+        else                   w[i] = (k == 0 ? 0.f : (k == 1 ? 1.f : .5f));
+      }
+      if (!refine_endpoints(px, use, w, 3, e0, e1)) break;
+      const ColorBlock blk = color_block(px, use, punch, pack565(e0), pack565(e1));
+      if (blk.error >= best.error) break;
+      best = blk;
+    }
+  }
+  out = put16(out, best.c0);
+  out = put16(out, best.c1);
+  put32(out, best.bits);
+}
+
+// ============================================================================
+// BC3 alpha blocks
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Encode alpha of block with the given endpoints as BC3 alpha block of 8 bytes
+///
+/// \returns Sum of squared errors.
+static int alpha_block(const Block px, int a0, int a1, unsigned char *out)
+{
+  int pal[8];
+  pal[0] = a0, pal[1] = a1;
+  if (a0 > a1) {
+    for (int k = 2; k < 8; ++k) pal[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+  } else {
+    for (int k = 2; k < 6; ++k) pal[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+    pal[6] = 0, pal[7] = 255;
+  }
+  unsigned long long bits  = 0;
+  int                error = 0;
+  for (int i = 0; i < 16; ++i) {
+    int best = 0, e = 256 * 256;
+    for (int k = 0; k < 8; ++k) {
+      const int d = (px[i][3] - pal[k]) * (px[i][3] - pal[k]);
+      if (d < e) best = k, e = d;
+    }
+    bits  |= static_cast<unsigned long long>(best) << (3 * i);
+    error += e;
+  }
+  out[0] = static_cast<unsigned char>(a0);
+  out[1] = static_cast<unsigned char>(a1);
+  for (int b = 0; b < 6; ++b) out[2 + b] = static_cast<unsigned char>(bits >> (8 * b));
+  return error;
+}
+
+// ----------------------------------------------------------------------------
+/// Encode alpha of block as BC3 alpha block of 8 bytes
+static void encode_alpha(const Block px, bool hq, unsigned char *out)
+{
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; ++i) {
+    lo = cimg::min(lo, int(px[i][3]));
+    hi = cimg::max(hi, int(px[i][3]));
+  }
+  const int error = alpha_block(px, hi, lo, out);
+  if (!hq || error == 0) return;
+  // Six interpolated values between the extremes other than 0 and 255,
+  // which are represented exactly
+  int lo6 = 255, hi6 = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (px[i][3] == 0 || px[i][3] == 255) continue;
+    lo6 = cimg::min(lo6, int(px[i][3]));
+    hi6 = cimg::max(hi6, int(px[i][3]));
+  }
+  if (lo6 > hi6) lo6 = hi6 = 0;
+  unsigned char alt[8];
+  if (alpha_block(px, lo6, hi6, alt) < error) memcpy(out, alt, 8);
+}
+
+// ============================================================================
+// BC7 blocks
+// ============================================================================
+
+/// BC7 mode 6 block with its squared error
+struct Bc7Block
+{
+  int           e[2][4]; ///< 7-bit endpoints.
+  int           p[2];    ///< P-bits of endpoints.
+  unsigned char idx[16]; ///< 4-bit index of each pixel.
+  int           error;   ///< Sum of squared errors.
+};
+
+/// Writer of the bits of a block, least significant bit first
+struct BitWriter
+{
+  unsigned char *data;
+  int            pos;
+
+  BitWriter(unsigned char *data) : data(data), pos(0) { memset(data, 0, 16); }
+
+  void put(unsigned int v, int n)
+  {
+    for (int b = 0; b < n; ++b, ++pos) {
+      if ((v >> b) & 1) data[pos >> 3] |= static_cast<unsigned char>(1 << (pos & 7));
+    }
+  }
+};
+
+// ----------------------------------------------------------------------------
+/// Quantize endpoints to 7 bits with the p-bit of least error, and choose indices
+static Bc7Block bc7_block(const Block px, const float *e0, const float *e1)
+{
+  Bc7Block     blk;
+  const float *e[2] = {e0, e1};
+  int          ep[2][4];
+  for (int k = 0; k < 2; ++k) {
+    float best = -1.f;
+    for (int p = 0; p < 2; ++p) {
+      int   q[4];
+      float error = 0.f;
+      for (int c = 0; c < 4; ++c) {
+        q[c] = cimg::max(0, cimg::min(127, int((e[k][c] - p) / 2.f + .5f)));
+        const float d = float((q[c] << 1) | p) - e[k][c];
+        error += d * d;
+      }
+      if (best < 0.f || error < best) {
+        best = error, blk.p[k] = p;
+        for (int c = 0; c < 4; ++c) blk.e[k][c] = q[c], ep[k][c] = (q[c] << 1) | p;
+      }
+    }
+  }
+  int pal[16][4];
+  for (int k = 0; k < 16; ++k)
+  for (int c = 0; c < 4; ++c) {
+    pal[k][c] = (ep[0][c] * (64 - BC7_WEIGHTS[k]) + ep[1][c] * BC7_WEIGHTS[k] + 32) >> 6;
+  }
+  blk.error = 0;
+  for (int i = 0; i < 16; ++i) {
+    int best = 0, error = 0;
+    for (int k = 0; k < 16; ++k) {
+      int d = 0;
+      for (int c = 0; c < 4; ++c) d += (px[i][c] - pal[k][c]) * (px[i][c] - pal[k][c]);
+      if (k == 0 || d < error) best = k, error = d;
+    }
+    blk.idx[i]  = static_cast<unsigned char>(best);
+    blk.error  += error;
+  }
+  return blk;
+}
+
+// ----------------------------------------------------------------------------
+/// Encode block as BC7 block of 16 bytes using mode 6, i.e., a single line
+/// segment in RGBA space with 4-bit indices
+static void encode_bc7(const Block block, bool hq, unsigned char *out)
+{
+  // Colors of fully transparent pixels do not matter, replace them by the
+  // mean color of the other pixels such that they do not affect the fit
+  Block px;
+  bool  use[16];
+  int   sum[3] = {0, 0, 0}, n = 0;
+  memcpy(px, block, sizeof(Block));
+  for (int i = 0; i < 16; ++i) {
+    use[i] = true;
+    if (px[i][3] == 0) continue;
+    for (int c = 0; c < 3; ++c) sum[c] += px[i][c];
+    ++n;
+  }
+  if (0 < n && n < 16) {
+    for (int i = 0; i < 16; ++i) {
+      if (px[i][3] > 0) continue;
+      for (int c = 0; c < 3; ++c) px[i][c] = static_cast<unsigned char>((sum[c] + n / 2) / n);
+    }
+  }
+  // The bounding box of transparent and opaque pixels does not follow their colors
+  if (0 < n && n < 16) hq = true;
+  float e0[4], e1[4];
+  fit_endpoints(px, use, 4, hq, e0, e1);
+  Bc7Block best = bc7_block(px, e0, e1);
+  for (int iter = 0; hq && iter < 2 && best.error > 0; ++iter) {
+    float w[16];
+    for (int i = 0; i < 16; ++i) w[i] = BC7_WEIGHTS[best.idx[i]] / 64.f;
+    if (!refine_endpoints(px, use, w, 4, e0, e1)) break;
+    const Bc7Block blk = bc7_block(px, e0, e1);
+    if (blk.error >= best.error) break;
+    best = blk;
+  }
+  // Most significant bit of the index of the first pixel is implicitly zero
+  if (best.idx[0] >= 8) {
+    for (int c = 0; c < 4; ++c) swap(best.e[0][c], best.e[1][c]);
+    swap(best.p[0], best.p[1]);
+    for (int i = 0; i < 16; ++i) best.idx[i] = static_cast<unsigned char>(15 - best.idx[i]);
+  }
+  BitWriter bits(out);
+  bits.put(1 << 6, 7);
+  for (int c = 0; c < 4; ++c) {
+    bits.put(best.e[0][c], 7);
+    bits.put(best.e[1][c], 7);
+  }
+  bits.put(best.p[0], 1);
+  bits.put(best.p[1], 1);
+  bits.put(best.idx[0], 3);
+  for (int i = 1; i < 16; ++i) bits.put(best.idx[i], 4);
+}
+
+// ============================================================================
+// DDS files
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+/// Size of DDS header including magic number in bytes
+static size_t dds_header_size(TextureFormat format)
+{
+  return format == TEXTURE_BC7 ? 148 : 128;
+}
+
+// ----------------------------------------------------------------------------
+/// Write DDS header of texture without mipmaps
+static void dds_header(unsigned char *p, int width, int height, TextureFormat format)
+{
+  memset(p, 0, dds_header_size(format));
+  memcpy(p, "DDS ", 4);
+  p = put32(p + 4, 124);                           // dwSize
+  p = put32(p, 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000); // CAPS, HEIGHT, WIDTH, PIXELFORMAT, LINEARSIZE
+  p = put32(p, height);
+  p = put32(p, width);
+  p = put32(p, texture_size(width, height, format));
+  p += 4 * 13;                                     // dwDepth, dwMipMapCount, dwReserved1
+  p = put32(p, 32);                                // ddspf.dwSize
+  p = put32(p, 0x4);                               // DDPF_FOURCC
+  memcpy(p, format == TEXTURE_BC1 ? "DXT1" : (format == TEXTURE_BC3 ? "DXT5" : "DX10"), 4);
+  p += 4 * 6;                                      // dwFourCC, dwRGBBitCount, masks
+  p = put32(p, 0x1000);                            // DDSCAPS_TEXTURE
+  p += 4 * 4;                                      // dwCaps2-4, dwReserved2
+  if (format == TEXTURE_BC7) {
+    p = put32(p, 98);                              // DXGI_FORMAT_BC7_UNORM
+    p = put32(p, 3);                               // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    p = put32(p, 0);
+    p = put32(p, 1);                               // arraySize
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Write DDS file
+static void write_dds(const char *fname, const vector<unsigned char> &dds)
+{
+  FILE *fp = fopen(fname, "wb");
+  if (!fp) {
+    throw CImgIOException("Failed to open texture file %s for writing!", fname);
+  }
+  const size_t n = fwrite(&dds[0], 1, dds.size(), fp);
+  if (fclose(fp) != 0 || n != dds.size()) {
+    throw CImgIOException("Failed to write texture file %s!", fname);
+  }
+}
+
+// ----------------------------------------------------------------------------
+/// Encode frame as DDS file in memory
+static void encode_dds(const Frame &frame, TextureFormat format, bool hq, vector<unsigned char> &dds)
+{
+  const size_t header = dds_header_size(format);
+  dds.resize(header + texture_size(frame.width(), frame.height(), format));
+  dds_header(&dds[0], frame.width(), frame.height(), format);
+  if (dds.size() > header) compress(frame, format, hq, &dds[header]);
+}
+
+// ============================================================================
+// Compressed textures
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+bool parse_texture_format(const string &name, TextureFormat &format)
+{
+  if      (cimg::strcasecmp(name.c_str(), "bc1") == 0) format = TEXTURE_BC1;
+  else if (cimg::strcasecmp(name.c_str(), "bc3") == 0) format = TEXTURE_BC3;
+  else if (cimg::strcasecmp(name.c_str(), "bc7") == 0) format = TEXTURE_BC7;
+  else return false;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool is_dds(const string &fname)
+{
+  return cimg::strcasecmp(cimg::split_filename(fname.c_str()), "dds") == 0;
+}
+
+// ----------------------------------------------------------------------------
+string texture_format(const Job &job)
+{
+  if (job.texture.empty() && is_dds(job.output)) return "bc3";
+  return job.texture;
+}
+
+// ----------------------------------------------------------------------------
+size_t texture_size(int width, int height, TextureFormat format)
+{
+  const size_t blocks = size_t((width + 3) / 4) * size_t((height + 3) / 4);
+  return blocks * (format == TEXTURE_BC1 ? 8 : 16);
+}
+
+// ----------------------------------------------------------------------------
+void compress(const Frame &frame, TextureFormat format, bool hq, unsigned char *data)
+{
+  if (frame.is_empty()) return;
+  const int    bw    = (frame.width()  + 3) / 4;
+  const int    bh    = (frame.height() + 3) / 4;
+  const size_t bytes = (format == TEXTURE_BC1 ? 8 : 16);
+  const bool   alpha = (frame.spectrum() == 2 || frame.spectrum() >= 4);
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic) if (parallel(frame.size()))
+#endif
+  for (int by = 0; by < bh; ++by) {
+    Block px;
+    bool  use[16];
+    for (int bx = 0; bx < bw; ++bx) {
+      unsigned char *out = data + (size_t(by) * bw + bx) * bytes;
+      load_block(frame, bx, by, px);
+      if (format == TEXTURE_BC7) {
+        encode_bc7(px, hq, out);
+      } else if (format == TEXTURE_BC3) {
+        // Colors of fully transparent pixels do not matter
+        int n = 0;
+        for (int i = 0; i < 16; ++i) n += (use[i] = (px[i][3] > 0));
+        if (n == 0) for (int i = 0; i < 16; ++i) use[i] = true;
+        encode_alpha(px, hq, out);
+        encode_color(px, use, false, hq, out + 8);
+      } else {
+        // Pixels with alpha below one half are transparent
+        bool punch = false;
+        for (int i = 0; i < 16; ++i) {
+          use[i] = (!alpha || px[i][3] >= 128);
+          punch  = punch || !use[i];
+        }
+        encode_color(px, use, punch, hq, out);
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+void save_dds(const Frame &frame, const char *fname, TextureFormat format, bool hq)
+{
+  vector<unsigned char> dds;
+  encode_dds(frame, format, hq, dds);
+  write_dds(fname, dds);
+}
+
+// ----------------------------------------------------------------------------
+void write_textures(const Sequence &frames, const char *fname, TextureFormat format, bool hq)
+{
+  if (frames.size() == 1) {
+    save_dds(frames[0], fname, format, hq);
+    return;
+  }
+  // Compress frames in parallel, but write files in order
+  vector<vector<unsigned char> > dds(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    encode_dds(frames[frame], format, hq, dds[frame]);
+  }
+  char ofname[1024];
+  cimglist_for(frames,frame) {
+    cimg::number_filename(fname, frame, 6, ofname);
+    write_dds(ofname, dds[frame]);
+  }
+}
+
+
+} // namespace animtk
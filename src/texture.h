@@ -0,0 +1,97 @@
+/* BCn compressed texture output of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_TEXTURE_H
+#define ANIMTK_TEXTURE_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Compressed textures
+// ============================================================================
+
+/// Block compression format of GPU textures
+///
+/// Only the BCn formats, which are stored in DDS files, are supported.
+/// ETC2 and the KTX2 container are not implemented.
+enum TextureFormat
+{
+  TEXTURE_BC1, ///< 4 bits per pixel, RGB with 1-bit alpha (DXT1).
+  TEXTURE_BC3, ///< 8 bits per pixel, RGB with interpolated alpha (DXT5).
+  TEXTURE_BC7  ///< 8 bits per pixel, RGBA with 7-bit endpoints (mode 6 only).
+};
+
+/// Width and height of the pixel blocks of compressed textures
+const int TEXTURE_BLOCK_SIZE = 4;
+
+/// Get texture format by its name, i.e., "bc1", "bc3", or "bc7"
+///
+/// \returns Whether the name is a known texture format.
+bool parse_texture_format(const std::string &name, TextureFormat &format);
+
+/// Whether the file name extension of an output is .dds
+bool is_dds(const std::string &fname);
+
+/// Name of compression format of the output of a crop job
+///
+/// \returns Job::texture, or "bc3" if none is given and the output is a DDS
+///          file. An empty string if the output is no compressed texture.
+std::string texture_format(const Job &job);
+
+/// Size of compressed texture in bytes
+size_t texture_size(int width, int height, TextureFormat format);
+
+/// Compress frame to texture blocks
+///
+/// The blocks are stored row by row. Pixels of partial blocks at the right and
+/// bottom edges of frames whose size is not a multiple of TEXTURE_BLOCK_SIZE
+/// repeat the last column and row. The fast preset uses the corners of the
+/// bounding box of the colors of a block as endpoints, while the high quality
+/// preset fits the endpoints to the principal axis of the colors and refines
+/// them by least squares. Gray frames are encoded as RGB, frames without alpha
+/// channel as opaque. The rows of blocks of large frames are compressed by
+/// multiple threads.
+///
+/// \param[in]  frame  Frame to compress.
+/// \param[in]  format Block compression format.
+/// \param[in]  hq     Whether to use the slower high quality preset.
+/// \param[out] data   Memory of texture_size() bytes.
+void compress(const Frame &frame, TextureFormat format, bool hq, unsigned char *data);
+
+/// Save frame as compressed texture in DDS file
+///
+/// \throws cimg_library::CImgIOException if file could not be written.
+void save_dds(const Frame &frame, const char *fname, TextureFormat format, bool hq = false);
+
+/// Write image sequence as compressed textures in DDS files
+///
+/// The files are named as by CImgList::save(), i.e., numbered unless the
+/// sequence has a single frame. Frames are compressed in parallel.
+///
+/// \throws cimg_library::CImgIOException if a file could not be written.
+void write_textures(const Sequence &frames, const char *fname, TextureFormat format, bool hq = false);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_TEXTURE_H
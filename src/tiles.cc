@@ -0,0 +1,164 @@
+/* Tile deduplication of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <map>
+
+#include "tiles.h"
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Tiles of a frame and their hashes
+struct FrameTiles
+{
+  Sequence                   tiles;  ///< Tiles row by row.
+  vector<unsigned long long> hashes; ///< Hash of each tile, zero if it is transparent black.
+};
+
+// ----------------------------------------------------------------------------
+/// 64-bit FNV-1a hash of tile, or zero if it is transparent black
+///
+/// Only tiles with alpha channel whose pixels are all zero are transparent
+/// black, whereas such tiles of gray or RGB frames are opaque black.
+static unsigned long long hash_tile(const Frame &tile)
+{
+  unsigned long long h    = 14695981039346656037ULL;
+  unsigned char      bits = 0;
+  const unsigned char *p  = tile.data();
+  for (size_t i = 0; i < tile.size(); ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+    bits |= p[i];
+  }
+  const bool alpha = (tile.spectrum() == 2 || tile.spectrum() == 4);
+  return bits || !alpha ? (h == 0 ? 1 : h) : 0;
+}
+
+// ----------------------------------------------------------------------------
+/// Split frame into tiles
+static void split(const Frame &frame, int size, TileMap &map, FrameTiles &ft)
+{
+  map.columns = (frame.width()  + size - 1) / size;
+  map.rows    = (frame.height() + size - 1) / size;
+  const int n = map.columns * map.rows;
+  ft.tiles.assign(n);
+  ft.hashes.resize(n);
+  for (int r = 0; r < map.rows; ++r)
+  for (int c = 0; c < map.columns; ++c) {
+    Frame &tile = ft.tiles[r * map.columns + c];
+    const int x0 = c * size, y0 = r * size;
+    const int w  = cimg::min(size, frame.width()  - x0);
+    const int h  = cimg::min(size, frame.height() - y0);
+    tile.assign(size, size, 1, frame.spectrum(), 0);
+    cimg_forC(tile, ch) {
+      for (int y = 0; y < h; ++y) memcpy(tile.data(0, y, 0, ch), frame.data(x0, y0 + y, 0, ch), w);
+    }
+    ft.hashes[r * map.columns + c] = hash_tile(tile);
+  }
+}
+
+// ============================================================================
+// Tiles
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+TileMaps tile_maps(const Sequence &frames, int size, Sequence &tiles)
+{
+  if (size < 1) {
+    throw CImgArgumentException("tile_maps(): Invalid tile size: %d", size);
+  }
+  // Split frames and hash tiles in parallel
+  TileMaps           maps(frames.size());
+  vector<FrameTiles> split_frames(frames.size());
+#ifdef cimg_use_openmp
+#pragma omp parallel for schedule(dynamic)
+#endif
+  cimglist_for(frames,frame) {
+    if (frames[frame].depth() == 1) split(frames[frame], size, maps[frame], split_frames[frame]);
+  }
+  // Find unique tiles in order
+  multimap<unsigned long long, int> unique;
+  tiles.assign();
+  for (size_t frame = 0; frame < maps.size(); ++frame) {
+    FrameTiles &ft = split_frames[frame];
+    maps[frame].tiles.assign(ft.hashes.size(), -1);
+    for (size_t i = 0; i < ft.hashes.size(); ++i) {
+      if (ft.hashes[i] == 0) continue;
+      typedef multimap<unsigned long long, int>::const_iterator Iterator;
+      pair<Iterator, Iterator> range = unique.equal_range(ft.hashes[i]);
+      for (Iterator it = range.first; it != range.second; ++it) {
+        const Frame &tile = tiles[it->second];
+        if (tile.spectrum() == ft.tiles[i].spectrum() && memcmp(tile.data(), ft.tiles[i].data(), tile.size()) == 0) {
+          maps[frame].tiles[i] = it->second;
+          break;
+        }
+      }
+      if (maps[frame].tiles[i] < 0) {
+        maps[frame].tiles[i] = int(tiles.size());
+        unique.insert(make_pair(ft.hashes[i], int(tiles.size())));
+        ft.tiles[i].move_to(tiles);
+      }
+    }
+    ft.tiles.assign();
+  }
+  return maps;
+}
+
+// ----------------------------------------------------------------------------
+Frame tile_atlas(const Sequence &tiles, int size)
+{
+  int nc = 4;
+  cimglist_for(tiles,i) if (i == 0 || tiles[i].spectrum() > nc) nc = tiles[i].spectrum();
+  const int n       = cimg::max(1, int(tiles.size()));
+  const int columns = int(std::ceil(std::sqrt(double(n))));
+  const int rows    = (n + columns - 1) / columns;
+  Frame atlas(columns * size, rows * size, 1, nc, 0);
+  cimglist_for(tiles,i) {
+    atlas.draw_image((i % columns) * size, (i / columns) * size, tiles[i]);
+  }
+  return atlas;
+}
+
+// ----------------------------------------------------------------------------
+void write_tiles_csv(const char *fname, const TileMaps &maps, int fbegin, int fstride)
+{
+  FILE *fp = fopen(fname, "w");
+  if (!fp) {
+    throw CImgIOException("Failed to open tile table %s!", fname);
+  }
+  fprintf(fp, " frame, columns,   rows, tiles\n");
+  for (size_t frame = 0; frame < maps.size(); ++frame) {
+    const TileMap &map = maps[frame];
+    fprintf(fp, "%6d, %7d, %6d", fbegin + int(frame) * fstride, map.columns, map.rows);
+    for (size_t i = 0; i < map.tiles.size(); ++i) fprintf(fp, ", %d", map.tiles[i]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+}
+
+
+} // namespace animtk
@@ -0,0 +1,84 @@
+/* Tile deduplication of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_TILES_H
+#define ANIMTK_TILES_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Tiles
+// ============================================================================
+
+/// Tiles of a cropped frame
+///
+/// The tiles are given row by row as indices of unique tiles, where -1 denotes
+/// a tile of a frame with alpha channel whose pixels are all zero, i.e.,
+/// transparent black. Black tiles of gray or RGB frames are opaque and unique.
+struct TileMap
+{
+  int              columns; ///< Number of tiles in each row.
+  int              rows;    ///< Number of rows of tiles.
+  std::vector<int> tiles;   ///< Index of unique tile of each tile or -1.
+
+  TileMap() : columns(0), rows(0) {}
+};
+
+/// Tile maps of all frames of an image sequence in order
+typedef std::vector<TileMap> TileMaps;
+
+/// Split cropped frames into tiles and determine the unique tiles
+///
+/// Tiles at the right and bottom edges of frames whose size is not a multiple
+/// of \p size are padded with zeros. The tiles of the frames are hashed by
+/// multiple threads, and tiles with equal hash are compared pixel by pixel,
+/// such that only identical tiles are shared.
+///
+/// \param[in]  frames Cropped image sequence.
+/// \param[in]  size   Width and height of tiles.
+/// \param[out] tiles  Unique tiles in order of their first occurrence.
+///
+/// \returns Tile maps of the frames.
+TileMaps tile_maps(const Sequence &frames, int size, Sequence &tiles);
+
+/// Arrange tiles in an atlas
+///
+/// Tile i is placed at ((i % c) * size, (i / c) * size), where c is the number
+/// of columns of the atlas, i.e., its width divided by the tile size, which is
+/// chosen such that the atlas is about square.
+///
+/// \returns Atlas image, a single transparent tile if there are no tiles.
+Frame tile_atlas(const Sequence &tiles, int size);
+
+/// Write table of tile maps in CSV format
+///
+/// Each row lists the frame number, the number of columns and rows of tiles,
+/// and the indices of the tiles row by row.
+///
+/// \throws cimg_library::CImgIOException if file could not be opened.
+void write_tiles_csv(const char *fname, const TileMaps &maps, int fbegin = 0, int fstride = 1);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_TILES_H
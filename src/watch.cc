@@ -0,0 +1,254 @@
+/* Watch-folder mode of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <csignal>
+#include <ctime>
+#include <map>
+#include <set>
+#include <sys/stat.h>
+
+#include "pool.h"
+#include "watch.h"
+
+#ifdef __linux__
+#  include <poll.h>
+#  include <unistd.h>
+#  include <sys/inotify.h>
+#endif
+
+using namespace std;
+using namespace cimg_library;
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Auxiliary functions
+// ============================================================================
+
+/// Set by signal handler to stop watching
+static volatile sig_atomic_t watch_stopped = 0;
+
+// ----------------------------------------------------------------------------
+static void stop_watch(int)
+{
+  watch_stopped = 1;
+}
+
+// ----------------------------------------------------------------------------
+/// Size of file or -1 if it does not exist
+static long file_size(const char *fname)
+{
+  struct stat info;
+  if (stat(fname, &info) != 0) return -1;
+  return static_cast<long>(info.st_size);
+}
+
+// ----------------------------------------------------------------------------
+/// Directory part of file path including trailing slash
+static string directory(const string &path)
+{
+  const size_t pos = path.find_last_of("/\\");
+  return pos == string::npos ? string() : path.substr(0, pos + 1);
+}
+
+// ----------------------------------------------------------------------------
+/// Detects files which were completely written to a directory
+class FolderWatch
+{
+  string            _dir;
+  set<string>       _written; ///< Files which were closed after writing.
+  map<string, long> _size;    ///< Sizes of files at last poll (no inotify).
+#ifdef __linux__
+  int               _fd;
+#endif
+
+public:
+
+  FolderWatch(const string &dir) : _dir(dir)
+  {
+#ifdef __linux__
+    _fd = inotify_init();
+    if (_fd < 0 || inotify_add_watch(_fd, dir.empty() ? "." : dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+      if (_fd >= 0) close(_fd);
+      throw CImgIOException("Failed to watch directory %s!", dir.empty() ? "." : dir.c_str());
+    }
+#endif
+  }
+
+  ~FolderWatch()
+  {
+#ifdef __linux__
+    close(_fd);
+#endif
+  }
+
+  /// Whether file was completely written since the last call
+  bool written(const string &fname)
+  {
+#ifdef __linux__
+    return _written.erase(fname) > 0;
+#else
+    const long size = file_size(fname.c_str());
+    map<string, long>::iterator it = _size.find(fname);
+    if (size <= 0) return false;
+    if (it == _size.end() || it->second != size) {
+      _size[fname] = size;
+      return false;
+    }
+    _size.erase(it);
+    return true;
+#endif
+  }
+
+  /// Wait at most the given number of milliseconds for file events
+  void wait(int ms)
+  {
+#ifdef __linux__
+    pollfd pfd;
+    pfd.fd      = _fd;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, ms) <= 0) return;
+    char buffer[4096] __attribute__((aligned(__alignof__(inotify_event))));
+    const ssize_t n = read(_fd, buffer, sizeof(buffer));
+    for (ssize_t i = 0; i < n; ) {
+      const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + i);
+      if (event->len > 0) _written.insert(_dir + event->name);
+      i += sizeof(inotify_event) + event->len;
+    }
+#else
+    cimg::wait(ms);
+#endif
+  }
+};
+
+// ============================================================================
+// Watch folder
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+int watch(const Job &job, int idle, int verbose)
+{
+  if (!contains_pattern(job.input)) {
+    throw CImgArgumentException("watch(): Input must be a file name pattern such as frames_%%05d.png");
+  }
+  const char *option = extra_option(job);
+  if (option) {
+    throw CImgArgumentException("watch(): Option %s is not supported when watching the input directory", option);
+  }
+  const bool tight = (job.mode == CROP_TIGHT);
+  FolderWatch folder(directory(job.input));
+  watch_stopped = 0;
+  void (*sigint )(int) = signal(SIGINT,  stop_watch);
+  void (*sigterm)(int) = signal(SIGTERM, stop_watch);
+  // Spreadsheet to which crop regions are appended in tight mode
+  FILE *csv = NULL;
+  if (tight && !job.csv.empty()) {
+    if (job.append && file_size(job.csv.c_str()) >= 0) csv = fopen(job.csv.c_str(), "a");
+    else if ((csv = fopen(job.csv.c_str(), "w")) != NULL) write_csv_header(csv);
+    if (!csv) throw CImgIOException("Failed to open spreadsheet file %s!", job.csv.c_str());
+  }
+  FramePool     pool;
+  Sequence      seq;
+  Frame         frame;
+  BoundingBoxes bb;
+  BoundingBox   prev;
+  int  w = 0, h = 0, n = 0;
+  char fname[1024], ofname[1024];
+  bool existing = true; // whether frames are still processed which existed at the start
+  time_t last = time(NULL);
+  try {
+    for (int index = job.fbegin; job.fend < 0 || index <= job.fend; index += job.fstride) {
+      snprintf(fname, 1024, job.input.c_str(), index);
+      if (!tight) seq.insert(1);
+      Frame &img = tight ? frame : seq.back();
+      // Wait for frame to be written unless it existed already, in which case it
+      // may only be incomplete if it is the one that was last written
+      bool ready = false;
+      if (existing && file_size(fname) >= 0) {
+        try {
+          if (tight) pool.load(img, fname);
+          else       img.load(fname);
+          ready = true;
+        } catch (const CImgException &) {
+        }
+      }
+      if (!ready) {
+        existing = false;
+        while (!watch_stopped) {
+          if (folder.written(fname)) {
+            if (tight) pool.load(img, fname);
+            else       img.load(fname);
+            ready = true;
+            break;
+          }
+          if (idle > 0 && difftime(time(NULL), last) >= idle) break;
+          folder.wait(250);
+        }
+      }
+      if (!ready) {
+        if (!tight) seq.remove(seq.size() - 1);
+        break;
+      }
+      if (n == 0) w = img.width(), h = img.height();
+      bb.push_back(analyze(img));
+      if (tight) {
+        const BoundingBox &b = bb.back();
+        cimg::number_filename(job.output.c_str(), n, 6, ofname);
+        pool.crop(img, b);
+        pool.save(img, ofname);
+        if (csv) {
+          write_csv_row(csv, index, b, w, h, n > 0 ? &prev : NULL);
+          fflush(csv);
+        }
+        prev = b;
+      }
+      if (verbose) {
+        printf("Frame %d: %s\n", index, fname);
+        fflush(stdout);
+      }
+      last = time(NULL);
+      ++n;
+    }
+  } catch (...) {
+    if (csv) fclose(csv);
+    signal(SIGINT,  sigint);
+    signal(SIGTERM, sigterm);
+    throw;
+  }
+  if (csv) fclose(csv);
+  signal(SIGINT,  sigint);
+  signal(SIGTERM, sigterm);
+  if (n == 0) {
+    throw CImgIOException("Input image sequence %s is empty!", job.input.c_str());
+  }
+  // Write adjusted output once sequence is complete
+  if (!tight) {
+    adjust(bb, job.mode, w, h, job.segments);
+    crop_and_write(seq, bb, job.output.c_str());
+    if (!job.csv.empty()) {
+      write_csv(job.csv.c_str(), bb, w, h, job.fbegin, job.fstride, job.append);
+    }
+  }
+  return n;
+}
+
+
+} // namespace animtk
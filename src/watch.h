@@ -0,0 +1,70 @@
+/* Watch-folder mode of The Animation Toolkit.
+ *
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMTK_WATCH_H
+#define ANIMTK_WATCH_H
+
+#include "animtk.h"
+
+
+namespace animtk {
+
+
+// ============================================================================
+// Watch folder
+// ============================================================================
+
+/// Process crop job while the frames of its input sequence are being written
+///
+/// Each frame is processed in order of its index once it was completely
+/// written, i.e., closed after writing or moved into the watched directory.
+/// On Linux, this is detected using inotify. On other systems, a file is
+/// considered complete when its size did not change between two polls.
+/// Frames which exist already when the watch starts are processed right away.
+///
+/// In CROP_TIGHT mode, each frame is cropped and written to its own output
+/// file as soon as it is available and its crop region is appended to the
+/// CSV spreadsheet immediately. In the other modes, the frames
+/// are analyzed as they arrive, but the adjusted output is written once the
+/// sequence is complete.
+///
+/// Only the input and output sequences, the CSV spreadsheet, the range of frame
+/// indices, and the crop mode of the job are supported. Jobs which use any of
+/// the other outputs or the cache, checkpoint, or frame stack are rejected.
+///
+/// The sequence is complete when the frame with index Job::fend was processed,
+/// when no new frame arrived for \p idle seconds, or when the process receives
+/// an interrupt or termination signal.
+///
+/// \param job     Crop job. The input must be a file name pattern.
+/// \param idle    Seconds without new frame after which the sequence is
+///                considered complete. No timeout if not positive.
+/// \param verbose Print status messages to stdout.
+///
+/// \returns Number of processed frames.
+///
+/// \throws cimg_library::CImgArgumentException if the job has options beyond
+///         cropping the frames (see extra_option()).
+/// \throws cimg_library::CImgException if the job failed.
+int watch(const Job &job, int idle = 0, int verbose = 0);
+
+
+} // namespace animtk
+
+
+#endif // ANIMTK_WATCH_H
@@ -0,0 +1,120 @@
+###############################################################################
+# Animation Toolkit - Regression test of crop-frames batch mode
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DCROP_FRAMES=<file> -DSYNTH_FRAMES=<file> -DHASH_FRAMES=<file>
+#         -DWORKING_DIR=<dir> -P RunBatchTest.cmake
+#
+# Crops several synthetic image sequences once by separate invocations of
+# crop-frames and once by a single invocation with a batch manifest, and
+# verifies that the outputs are identical.
+
+foreach (VAR CROP_FRAMES SYNTH_FRAMES HASH_FRAMES WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE  STDERR
+  )
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}\n${STDOUT}${STDERR}")
+  endif ()
+endmacro ()
+
+# ----------------------------------------------------------------------------
+# summarize output of crop-frames in given directory
+macro (summarize DIR RESULT)
+  file (GLOB CSV_FILES "${WORKING_DIR}/${DIR}/*.csv")
+  file (GLOB PNG_FILES "${WORKING_DIR}/${DIR}/*.png")
+  list (SORT CSV_FILES)
+  list (SORT PNG_FILES)
+  set (${RESULT})
+  foreach (CSV_FILE IN LISTS CSV_FILES)
+    file (READ "${CSV_FILE}" CSV)
+    get_filename_component (NAME "${CSV_FILE}" NAME)
+    set (${RESULT} "${${RESULT}}${NAME}:\n${CSV}")
+  endforeach ()
+  run ("${HASH_FRAMES}" ${PNG_FILES})
+  set (${RESULT} "${${RESULT}}${STDOUT}")
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}/input")
+file (MAKE_DIRECTORY "${WORKING_DIR}/single")
+file (MAKE_DIRECTORY "${WORKING_DIR}/batch")
+
+# ----------------------------------------------------------------------------
+# generate input sequences of different sizes
+run ("${SYNTH_FRAMES}" -o "input/small_%05d.png" -k walk  -n 4  -x 64  -y 48)
+run ("${SYNTH_FRAMES}" -o "input/large_%05d.png" -k walk  -n 12 -x 320 -y 200)
+run ("${SYNTH_FRAMES}" -o "input/twin_%05d.png"  -k twin  -n 6  -x 128 -y 64)
+run ("${SYNTH_FRAMES}" -o "input/pixel_%05d.png" -k pixel -n 3  -x 31  -y 20)
+
+set (JOBS
+  "-i input/small_00000.png -o DIR/small.png"
+  "-i input/large_00000.png -o DIR/large.png -u"
+  "-i input/twin_00000.png  -o DIR/twin.png  -f -c DIR/twin-coords.csv"
+  "-i input/pixel_00000.png -o DIR/pixel.png -b 1 -e 2"
+)
+
+# ----------------------------------------------------------------------------
+# separate invocations
+foreach (JOB IN LISTS JOBS)
+  string (REPLACE "DIR/" "single/" ARGS "${JOB}")
+  separate_arguments (ARGS)
+  run ("${CROP_FRAMES}" ${ARGS})
+endforeach ()
+
+# ----------------------------------------------------------------------------
+# batch manifest
+set (MANIFEST "# batch manifest\n\n")
+foreach (JOB IN LISTS JOBS)
+  string (REPLACE "DIR/" "batch/" ARGS "${JOB}")
+  set (MANIFEST "${MANIFEST}${ARGS}\n")
+endforeach ()
+file (WRITE "${WORKING_DIR}/manifest.txt" "${MANIFEST}")
+run ("${CROP_FRAMES}" -m manifest.txt)
+
+# ----------------------------------------------------------------------------
+# compare outputs
+summarize (single EXPECTED)
+summarize (batch  ACTUAL)
+if (NOT ACTUAL STREQUAL EXPECTED)
+  message (FATAL_ERROR "Output of batch mode differs from output of separate invocations!\n"
+                       "Expected:\n${EXPECTED}\nActual:\n${ACTUAL}")
+endif ()
+
+# ----------------------------------------------------------------------------
+# failing jobs must be reported without affecting the other jobs
+file (WRITE "${WORKING_DIR}/failing.txt" "-i input/missing_00000.png -o batch/missing.png\n-i input/small_00000.png -o batch/again.png\n")
+execute_process (
+  COMMAND "${CROP_FRAMES}" -m failing.txt
+  WORKING_DIRECTORY "${WORKING_DIR}"
+  RESULT_VARIABLE RETVAL
+  OUTPUT_QUIET ERROR_QUIET
+)
+if (RETVAL EQUAL 0)
+  message (FATAL_ERROR "Batch mode did not fail for missing input sequence!")
+endif ()
+if (NOT EXISTS "${WORKING_DIR}/batch/again.csv")
+  message (FATAL_ERROR "Batch mode did not process remaining jobs after failure!")
+endif ()
@@ -0,0 +1,96 @@
+###############################################################################
+# Animation Toolkit - Regression test of crop-frames analysis cache
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DCROP_FRAMES=<file> -DSYNTH_FRAMES=<file> -DHASH_FRAMES=<file>
+#         -DWORKING_DIR=<dir> -P RunCacheTest.cmake
+#
+# Crops a synthetic image sequence with and without cache, changes a frame,
+# and verifies that re-runs using the cache only analyze the changed frame
+# and produce the same output as runs without cache.
+
+foreach (VAR CROP_FRAMES SYNTH_FRAMES HASH_FRAMES WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE  STDERR
+  )
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}\n${STDOUT}${STDERR}")
+  endif ()
+endmacro ()
+
+# ----------------------------------------------------------------------------
+# summarize output of crop-frames in given directory
+macro (summarize DIR RESULT)
+  file (GLOB PNG_FILES "${WORKING_DIR}/${DIR}/*.png")
+  list (SORT PNG_FILES)
+  file (READ "${WORKING_DIR}/${DIR}/walk.csv" ${RESULT})
+  run ("${HASH_FRAMES}" ${PNG_FILES})
+  set (${RESULT} "${${RESULT}}${STDOUT}")
+endmacro ()
+
+# ----------------------------------------------------------------------------
+# crop sequence with and without cache and compare outputs
+macro (compare MODE NEW)
+  file (REMOVE_RECURSE "${WORKING_DIR}/direct" "${WORKING_DIR}/cached")
+  file (MAKE_DIRECTORY "${WORKING_DIR}/direct" "${WORKING_DIR}/cached")
+  run ("${CROP_FRAMES}" -i input/walk_00000.png -o direct/walk.png ${MODE})
+  run ("${CROP_FRAMES}" -i input/walk_00000.png -o cached/walk.png ${MODE} --cache cache -v 1)
+  if (NOT STDOUT MATCHES "#new: +${NEW}\n")
+    message (FATAL_ERROR "Expected ${NEW} frames not found in cache, got:\n${STDOUT}")
+  endif ()
+  summarize (direct EXPECTED)
+  summarize (cached ACTUAL)
+  if (NOT ACTUAL STREQUAL EXPECTED)
+    message (FATAL_ERROR "Output of crop-frames ${MODE} with cache differs from output without cache!\n"
+                         "Expected:\n${EXPECTED}\nActual:\n${ACTUAL}")
+  endif ()
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}/input")
+
+run ("${SYNTH_FRAMES}" -o "input/walk_%05d.png" -k walk -n 8 -x 96 -y 60)
+run ("${SYNTH_FRAMES}" -o "input/twin_%05d.png" -k twin -n 1 -x 96 -y 60)
+
+compare ("" 8)    # empty cache
+compare ("" 0)    # all frames unchanged
+compare (-u 0)    # other modes reuse crop regions
+compare (-f 0)
+
+# "re-render" a single frame
+file (RENAME "${WORKING_DIR}/input/twin_00000.png" "${WORKING_DIR}/input/walk_00003.png")
+compare ("" 1)
+compare (-u 0)
+
+# output overwritten in place must not corrupt the cache
+run ("${CROP_FRAMES}" -i input/walk_00000.png -o cached/walk.png -f)
+compare (-u 0)
+
+# re-run writing the same output again must not leave temporary files behind
+run ("${CROP_FRAMES}" -i input/walk_00000.png -o cached/walk.png -u --cache cache)
+file (GLOB TEMP_FILES "${WORKING_DIR}/cached/*.tmp")
+if (TEMP_FILES)
+  message (FATAL_ERROR "Temporary files left in output directory:\n${TEMP_FILES}")
+endif ()
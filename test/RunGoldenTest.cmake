@@ -0,0 +1,139 @@
+###############################################################################
+# Animation Toolkit - Golden output regression test of crop-frames
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DCROP_FRAMES=<file> -DSYNTH_FRAMES=<file> -DHASH_FRAMES=<file>
+#         -DSYNTH_ARGS=<args> [-DCROP_ARGS=<args>]
+#         -DEXPECTED=<file> -DWORKING_DIR=<dir>
+#         -P RunGoldenTest.cmake
+#
+# Generates a synthetic input sequence, crops it with crop-frames, and compares
+# the CSV spreadsheet and the hashes of the pixel data of the cropped frames to
+# the expected output. The expected output is shared by all kernel variants,
+# i.e., the output of the optimized code paths must be bit-identical.
+#
+# When the environment variable ANIMTK_UPDATE_GOLDEN is set, the EXPECTED file
+# is (re-)written instead. This must only be done when the output of a tool is
+# changed intentionally.
+#
+# If CROP_ARGS contains the -a option, each frame is processed by a separate
+# invocation of crop-frames which appends its crop region to the spreadsheet.
+# Other CSV files written to the output directory, e.g., the table of --delta,
+# are compared as well. If CROP_ARGS contains the --texture option, the frames
+# are written as compressed textures (.dds), which are compared byte by byte
+# and decoded to check their error with respect to the cropped input frames.
+# So are the hit-test masks (.mask) written to the output directory, whose
+# queries are checked as well.
+#
+# The tools are run with relative file paths inside the WORKING_DIR, because
+# crop-frames derives the frame number from the first '_' in the file path.
+
+foreach (VAR CROP_FRAMES SYNTH_FRAMES HASH_FRAMES SYNTH_ARGS EXPECTED WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+separate_arguments (SYNTH_ARGS)
+separate_arguments (CROP_ARGS)
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE  STDERR
+  )
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}\n${STDOUT}${STDERR}")
+  endif ()
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}/input")
+file (MAKE_DIRECTORY "${WORKING_DIR}/output")
+
+# ----------------------------------------------------------------------------
+# generate input sequence
+run ("${SYNTH_FRAMES}" -o "input/frame_%05d.png" ${SYNTH_ARGS})
+
+# ----------------------------------------------------------------------------
+# crop input sequence
+list (FIND CROP_ARGS "-a" APPEND)
+list (FIND CROP_ARGS "--texture" TEXTURE)
+if (TEXTURE EQUAL -1)
+  set (EXT "png")
+else ()
+  set (EXT "dds")
+endif ()
+if (APPEND EQUAL -1)
+  run ("${CROP_FRAMES}" -i "input/frame_00000.png"
+                        -o "output/cropped.${EXT}"
+                        -c "output/cropped.csv"
+                        ${CROP_ARGS})
+else ()
+  file (GLOB INPUT_FRAMES "${WORKING_DIR}/input/frame_*.png")
+  list (SORT INPUT_FRAMES)
+  foreach (INPUT_FRAME IN LISTS INPUT_FRAMES)
+    get_filename_component (NAME    "${INPUT_FRAME}" NAME)
+    get_filename_component (NAME_WE "${INPUT_FRAME}" NAME_WE)
+    run ("${CROP_FRAMES}" -i "input/${NAME}"
+                          -o "output/cropped_${NAME_WE}.${EXT}"
+                          -c "output/cropped.csv"
+                          ${CROP_ARGS})
+  endforeach ()
+endif ()
+
+# ----------------------------------------------------------------------------
+# summarize output
+file (READ "${WORKING_DIR}/output/cropped.csv" CSV)
+file (GLOB TABLES "${WORKING_DIR}/output/*.csv")
+list (SORT TABLES)
+foreach (TABLE IN LISTS TABLES)
+  get_filename_component (NAME "${TABLE}" NAME)
+  if (NOT NAME STREQUAL "cropped.csv")
+    file (READ "${TABLE}" CONTENT)
+    set (CSV "${CSV}${NAME}:\n${CONTENT}")
+  endif ()
+endforeach ()
+file (GLOB OUTPUT_FRAMES "${WORKING_DIR}/output/*.png" "${WORKING_DIR}/output/*.dds" "${WORKING_DIR}/output/*.mask")
+list (SORT OUTPUT_FRAMES)
+if (NOT OUTPUT_FRAMES)
+  message (FATAL_ERROR "No cropped frames written to ${WORKING_DIR}/output!")
+endif ()
+if (TEXTURE EQUAL -1 OR NOT APPEND EQUAL -1)
+  run ("${HASH_FRAMES}" ${OUTPUT_FRAMES})
+else ()
+  run ("${HASH_FRAMES}" -f "input/frame_%05d.png" -c "output/cropped.csv" ${OUTPUT_FRAMES})
+endif ()
+set (ACTUAL "csv:\n${CSV}frames:\n${STDOUT}")
+file (WRITE "${WORKING_DIR}/actual.txt" "${ACTUAL}")
+
+# ----------------------------------------------------------------------------
+# compare to expected output
+if (DEFINED ENV{ANIMTK_UPDATE_GOLDEN})
+  file (WRITE "${EXPECTED}" "${ACTUAL}")
+  message (STATUS "Updated ${EXPECTED}")
+elseif (NOT EXISTS "${EXPECTED}")
+  message (FATAL_ERROR "Missing expected output ${EXPECTED}! Actual output written to ${WORKING_DIR}/actual.txt.")
+else ()
+  file (READ "${EXPECTED}" EXPECTED_OUTPUT)
+  if (NOT ACTUAL STREQUAL EXPECTED_OUTPUT)
+    message (FATAL_ERROR "Output differs from expected output!\n"
+                         "Expected (${EXPECTED}):\n${EXPECTED_OUTPUT}\n"
+                         "Actual (${WORKING_DIR}/actual.txt):\n${ACTUAL}")
+  endif ()
+endif ()
@@ -0,0 +1,56 @@
+###############################################################################
+# Animation Toolkit - Regression test of the reuse of pooled frame buffers
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DSYNTH_FRAMES=<file> -DCOUNT_ALLOCATIONS=<file>
+#         -DWORKING_DIR=<dir> -P RunPoolTest.cmake
+#
+# Generates two different synthetic image sequences of the same size and
+# verifies that cropping the second sequence using the frame pool of the
+# first one allocates no memory.
+
+foreach (VAR SYNTH_FRAMES COUNT_ALLOCATIONS WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE  STDERR
+  )
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}\n${STDOUT}${STDERR}")
+  endif ()
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}/input")
+file (MAKE_DIRECTORY "${WORKING_DIR}/output")
+
+# ----------------------------------------------------------------------------
+# generate input sequences of same size
+run ("${SYNTH_FRAMES}" -o "input/a_%05d.png" -k walk -n 6 -x 97 -y 61 -r 1)
+run ("${SYNTH_FRAMES}" -o "input/b_%05d.png" -k walk -n 6 -x 97 -y 61 -r 2)
+
+# ----------------------------------------------------------------------------
+# crop sequences using the same frame pool
+run ("${COUNT_ALLOCATIONS}" "input/a_%05d.png" "output/a.png"
+                            "input/b_%05d.png" "output/b.png")
+message (STATUS "${STDOUT}")
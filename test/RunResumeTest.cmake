@@ -0,0 +1,134 @@
+###############################################################################
+# Animation Toolkit - Regression test of crop-frames resumable processing
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DCROP_FRAMES=<file> -DSYNTH_FRAMES=<file> -DHASH_FRAMES=<file>
+#         -DWORKING_DIR=<dir> -P RunResumeTest.cmake
+#
+# Interrupts crop-frames while analyzing and while writing frames, resumes
+# it from its checkpoint, and verifies that only unfinished frames are
+# processed again and that the output is identical to the one of a single run.
+
+foreach (VAR CROP_FRAMES SYNTH_FRAMES HASH_FRAMES WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE  STDERR
+  )
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}\n${STDOUT}${STDERR}")
+  endif ()
+endmacro ()
+
+# ----------------------------------------------------------------------------
+macro (run_failing)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_QUIET ERROR_QUIET
+  )
+  if (RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command did not fail: ${CMD}")
+  endif ()
+endmacro ()
+
+# ----------------------------------------------------------------------------
+# summarize output of crop-frames in given directory
+macro (summarize DIR RESULT)
+  file (GLOB PNG_FILES "${WORKING_DIR}/${DIR}/*.png")
+  list (SORT PNG_FILES)
+  file (READ "${WORKING_DIR}/${DIR}/walk.csv" ${RESULT})
+  run ("${HASH_FRAMES}" ${PNG_FILES})
+  set (${RESULT} "${${RESULT}}${STDOUT}")
+endmacro ()
+
+# ----------------------------------------------------------------------------
+macro (expect WHAT N)
+  if (NOT STDOUT MATCHES "#${WHAT}: +${N}\n")
+    message (FATAL_ERROR "Expected ${N} frames ${WHAT} by resumed run, got:\n${STDOUT}")
+  endif ()
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}/input" "${WORKING_DIR}/single" "${WORKING_DIR}/resumed")
+
+run ("${SYNTH_FRAMES}" -o "input/walk_%05d.png" -k walk -n 8 -x 96 -y 60)
+run ("${CROP_FRAMES}" -i input/walk_00000.png -o single/walk.png -u)
+set (CROP_ARGS -i input/walk_00000.png -o resumed/walk.png -u --interval 2 --resume -v 1)
+
+# ----------------------------------------------------------------------------
+# interrupted while analyzing frame 5, i.e., frames 0 to 3 were analyzed
+file (RENAME "${WORKING_DIR}/input/walk_00005.png" "${WORKING_DIR}/walk_00005.png")
+file (WRITE "${WORKING_DIR}/input/walk_00005.png" "incomplete")
+run_failing ("${CROP_FRAMES}" ${CROP_ARGS})
+if (NOT EXISTS "${WORKING_DIR}/resumed/walk.ckpt")
+  message (FATAL_ERROR "No checkpoint written by interrupted run!")
+endif ()
+file (RENAME "${WORKING_DIR}/walk_00005.png" "${WORKING_DIR}/input/walk_00005.png")
+
+# ----------------------------------------------------------------------------
+# interrupted while writing frame 5, i.e., frames 0 to 3 were written
+file (MAKE_DIRECTORY "${WORKING_DIR}/resumed/walk_000005.png")
+run_failing ("${CROP_FRAMES}" ${CROP_ARGS})
+file (REMOVE_RECURSE "${WORKING_DIR}/resumed/walk_000005.png")
+
+# ----------------------------------------------------------------------------
+# resume
+run ("${CROP_FRAMES}" ${CROP_ARGS})
+expect (analyzed 0)
+expect (written  4)
+if (EXISTS "${WORKING_DIR}/resumed/walk.ckpt")
+  message (FATAL_ERROR "Checkpoint not removed after job was completed!")
+endif ()
+summarize (single  EXPECTED)
+summarize (resumed ACTUAL)
+if (NOT ACTUAL STREQUAL EXPECTED)
+  message (FATAL_ERROR "Output of resumed run differs from output of single run!\n"
+                       "Expected:\n${EXPECTED}\nActual:\n${ACTUAL}")
+endif ()
+
+# ----------------------------------------------------------------------------
+# nothing to resume
+run ("${CROP_FRAMES}" ${CROP_ARGS})
+expect (analyzed 8)
+expect (written  8)
+
+# ----------------------------------------------------------------------------
+# resume with different cost of segments
+file (REMOVE_RECURSE "${WORKING_DIR}/resumed")
+file (MAKE_DIRECTORY "${WORKING_DIR}/resumed/walk_000005.png")
+set (SEGMENTS_ARGS -i input/walk_00000.png -o resumed/walk.png --interval 2 --resume)
+run_failing ("${CROP_FRAMES}" ${SEGMENTS_ARGS} --segments 1000)
+file (REMOVE_RECURSE "${WORKING_DIR}/resumed/walk_000005.png")
+execute_process (
+  COMMAND "${CROP_FRAMES}" ${SEGMENTS_ARGS} --segments 500
+  WORKING_DIRECTORY "${WORKING_DIR}"
+  RESULT_VARIABLE RETVAL
+  OUTPUT_QUIET
+  ERROR_VARIABLE  STDERR
+)
+if (RETVAL EQUAL 0 OR NOT STDERR MATCHES "belongs to a different crop job")
+  message (FATAL_ERROR "Checkpoint of job with different --segments was not rejected:\n${STDERR}")
+endif ()
@@ -0,0 +1,105 @@
+#! /bin/sh
+###############################################################################
+# Animation Toolkit - Regression test of crop-frames service mode
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   RunServiceTest.sh <crop-frames> <synth-frames> <hash-frames> <working dir>
+#
+# Starts a crop service, submits crop jobs to it, and verifies that the
+# outputs are identical to those of separate invocations of crop-frames.
+
+CROP_FRAMES="$1"
+SYNTH_FRAMES="$2"
+HASH_FRAMES="$3"
+WORKING_DIR="$4"
+
+if [ -z "$WORKING_DIR" ]; then
+  echo "usage: $0 <crop-frames> <synth-frames> <hash-frames> <working dir>" 1>&2
+  exit 1
+fi
+
+fail()
+{
+  echo "$@" 1>&2
+  [ -z "$SERVER" ] || kill $SERVER 2> /dev/null
+  exit 1
+}
+
+rm -rf "$WORKING_DIR"
+mkdir -p "$WORKING_DIR/input" "$WORKING_DIR/single" "$WORKING_DIR/service" || exit 1
+cd "$WORKING_DIR" || exit 1
+
+# -----------------------------------------------------------------------------
+# generate input sequences
+"$SYNTH_FRAMES" -o input/walk_%05d.png -k walk -n 8 -x 96 -y 60  || exit 1
+"$SYNTH_FRAMES" -o input/twin_%05d.png -k twin -n 5 -x 128 -y 64 || exit 1
+
+# -----------------------------------------------------------------------------
+# separate invocations
+"$CROP_FRAMES" -i input/walk_00000.png -o single/walk.png    || exit 1
+"$CROP_FRAMES" -i input/twin_00000.png -o single/twin.png -u || exit 1
+"$CROP_FRAMES" -i input/twin_00000.png -o single/parts.png --regions --gap 4 || exit 1
+"$CROP_FRAMES" -i input/walk_00000.png -o single/walk.dds --texture bc3 -c single/texture.csv || exit 1
+
+# -----------------------------------------------------------------------------
+# refuse to replace file which is not a socket
+echo "not a socket" > file.txt
+"$CROP_FRAMES" --serve "$PWD/file.txt" 2> /dev/null && fail "Crop service listening on regular file!"
+[ -f file.txt ] || fail "Crop service removed regular file!"
+
+# -----------------------------------------------------------------------------
+# start service and wait for its socket
+SOCKET="$PWD/crop.sock"
+"$CROP_FRAMES" --serve "$SOCKET" -j 2 > server.log 2>&1 &
+SERVER=$!
+n=0
+while [ ! -S "$SOCKET" ]; do
+  n=$((n + 1))
+  [ $n -le 100 ] || fail "Crop service did not start!"
+  kill -0 $SERVER 2> /dev/null || fail "Crop service terminated unexpectedly!"
+  sleep 0.1
+done
+
+# -----------------------------------------------------------------------------
+# submit single job and batch manifest
+"$CROP_FRAMES" --client "$SOCKET" -v 1 -i input/walk_00000.png -o service/walk.png > replies.txt \
+  || fail "Crop job submitted to service failed!"
+[ `grep -c '"event": "box"' replies.txt` -eq 8 ] || fail "Crop service did not report box of each frame!"
+grep -q '"event": "done", "status": "ok", "frames": 8' replies.txt || fail "Crop service did not report completion!"
+
+echo "-i input/twin_00000.png -o service/twin.png -u" > manifest.txt
+echo "-i input/twin_00000.png -o service/parts.png --regions --gap 4" >> manifest.txt
+echo "-i input/walk_00000.png -o service/walk.dds -c service/texture.csv" >> manifest.txt
+echo "-i input/missing_00000.png -o service/missing.png" >> manifest.txt
+"$CROP_FRAMES" --client "$SOCKET" -m manifest.txt 2> /dev/null && fail "Crop service did not report failed job!"
+
+# -----------------------------------------------------------------------------
+# shut down service
+"$CROP_FRAMES" --client "$SOCKET" --shutdown || fail "Failed to shut down crop service!"
+wait $SERVER || { SERVER=; fail "Crop service exited with error!"; }
+SERVER=
+[ ! -e "$SOCKET" ] || fail "Crop service did not remove its socket!"
+
+# -----------------------------------------------------------------------------
+# compare outputs
+for name in walk twin parts; do
+  cmp -s single/$name.csv service/$name.csv || fail "CSV output of $name differs!"
+  (cd single  && "$HASH_FRAMES" $name*.png) > expected.txt || exit 1
+  (cd service && "$HASH_FRAMES" $name*.png) > actual.txt   || exit 1
+  cmp -s expected.txt actual.txt || fail "Cropped frames of $name differ!"
+done
+cmp -s single/texture.csv service/texture.csv || fail "CSV output of texture differs!"
+for f in single/walk*.dds; do
+  cmp -s $f service/${f#single/} || fail "Compressed texture $f differs!"
+done
+exit 0
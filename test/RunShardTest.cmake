@@ -0,0 +1,122 @@
+###############################################################################
+# Animation Toolkit - Regression test of crop-frames sharded processing
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   cmake -DCROP_FRAMES=<file> -DSYNTH_FRAMES=<file> -DHASH_FRAMES=<file>
+#         -DWORKING_DIR=<dir> -P RunShardTest.cmake
+#
+# Crops a synthetic image sequence once by a single invocation of crop-frames
+# and once by separate processes for each shard of the sequence, and verifies
+# that the outputs are identical.
+
+foreach (VAR CROP_FRAMES SYNTH_FRAMES HASH_FRAMES WORKING_DIR)
+  if (NOT ${VAR})
+    message (FATAL_ERROR "Missing ${VAR} definition!")
+  endif ()
+endforeach ()
+
+# ----------------------------------------------------------------------------
+macro (run)
+  execute_process (
+    COMMAND ${ARGN}
+    WORKING_DIRECTORY "${WORKING_DIR}"
+    RESULT_VARIABLE RETVAL
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE  STDERR
+  )
+  if (NOT RETVAL EQUAL 0)
+    string (REPLACE ";" " " CMD "${ARGN}")
+    message (FATAL_ERROR "Command failed with exit code ${RETVAL}: ${CMD}\n${STDOUT}${STDERR}")
+  endif ()
+endmacro ()
+
+# ----------------------------------------------------------------------------
+# summarize output of crop-frames in given directory
+macro (summarize DIR RESULT)
+  file (GLOB PNG_FILES "${WORKING_DIR}/${DIR}/*.png")
+  list (SORT PNG_FILES)
+  file (READ "${WORKING_DIR}/${DIR}/walk.csv" ${RESULT})
+  run ("${HASH_FRAMES}" ${PNG_FILES})
+  set (${RESULT} "${${RESULT}}${STDOUT}")
+endmacro ()
+
+# ----------------------------------------------------------------------------
+# crop sequence by single process and by given number of shards
+macro (compare NSHARDS)
+  file (REMOVE_RECURSE "${WORKING_DIR}/single" "${WORKING_DIR}/shards")
+  file (MAKE_DIRECTORY "${WORKING_DIR}/single" "${WORKING_DIR}/shards")
+  run ("${CROP_FRAMES}" -i input/walk_00000.png -o single/walk.png ${ARGN})
+  set (TABLES)
+  foreach (I RANGE 1 ${NSHARDS})
+    run ("${CROP_FRAMES}" -i input/walk_00000.png --shard ${I}/${NSHARDS} -t shards/part${I}.txt ${ARGN})
+    list (APPEND TABLES shards/part${I}.txt)
+  endforeach ()
+  string (REPLACE ";" "," TABLES "${TABLES}")
+  run ("${CROP_FRAMES}" --merge "${TABLES}" -t shards/boxes.txt -c shards/walk.csv ${ARGN})
+  foreach (I RANGE 1 ${NSHARDS})
+    run ("${CROP_FRAMES}" -i input/walk_00000.png -o shards/walk.png --shard ${I}/${NSHARDS} --boxes shards/boxes.txt ${ARGN})
+  endforeach ()
+  summarize (single EXPECTED)
+  summarize (shards ACTUAL)
+  if (NOT ACTUAL STREQUAL EXPECTED)
+    message (FATAL_ERROR "Output of ${NSHARDS} shards with options '${ARGN}' differs from output of single process!\n"
+                         "Expected:\n${EXPECTED}\nActual:\n${ACTUAL}")
+  endif ()
+endmacro ()
+
+file (REMOVE_RECURSE "${WORKING_DIR}")
+file (MAKE_DIRECTORY "${WORKING_DIR}/input")
+
+run ("${SYNTH_FRAMES}" -o "input/walk_%05d.png" -k walk -n 10 -x 96 -y 60)
+
+compare (3)
+compare (3 -u)
+compare (4 -f)
+compare (4 -f -b 1 -s 2)
+compare (12 -u) # more shards than frames
+
+# merge must fail if a shard is missing
+execute_process (
+  COMMAND "${CROP_FRAMES}" --merge shards/part1.txt,shards/part2.txt -t shards/boxes.txt -u
+  WORKING_DIRECTORY "${WORKING_DIR}"
+  RESULT_VARIABLE RETVAL
+  OUTPUT_QUIET ERROR_QUIET
+)
+if (RETVAL EQUAL 0)
+  message (FATAL_ERROR "Merge of incomplete box tables did not fail!")
+endif ()
+
+# options beyond cropping the frames must be rejected instead of ignored
+set (TABLES)
+foreach (I RANGE 1 12)
+  list (APPEND TABLES shards/part${I}.txt)
+endforeach ()
+string (REPLACE ";" "," TABLES "${TABLES}")
+foreach (OPTION "--bleed;2" "--regions" "--colors;4" "--texture;bc3" "--masks;shards/walk.mask" "--scales;0.5"
+                "--hull;shards/hull.csv" "--delta;shards/delta.csv" "--tiles;shards/tiles.csv" "--stack")
+  list (GET OPTION 0 NAME)
+  foreach (STEP "--shard;1/2;-t;shards/rejected.txt" "--shard;1/2;--boxes;shards/boxes.txt;-o;shards/rejected.png"
+                "--merge;${TABLES};-t;shards/rejected.txt")
+    execute_process (
+      COMMAND "${CROP_FRAMES}" -i input/walk_00000.png ${STEP} ${OPTION}
+      WORKING_DIRECTORY "${WORKING_DIR}"
+      RESULT_VARIABLE RETVAL
+      OUTPUT_QUIET
+      ERROR_VARIABLE  STDERR
+    )
+    if (RETVAL EQUAL 0 OR NOT STDERR MATCHES "${NAME}")
+      string (REPLACE ";" " " CMD "${STEP} ${OPTION}")
+      message (FATAL_ERROR "Sharded processing did not reject option ${NAME}: ${CMD}\n${STDERR}")
+    endif ()
+  endforeach ()
+endforeach ()
@@ -0,0 +1,93 @@
+#! /bin/sh
+###############################################################################
+# Animation Toolkit - Regression test of crop-frames watch-folder mode
+#
+# Copyright (C) 2013, Andreas Schuh.
+#
+# Distributed under the GNU GPL; see accompanying file COPYING.txt for details.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY, to the extent permitted by law; without even the
+# implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+###############################################################################
+
+# Usage:
+#
+#   RunWatchTest.sh <crop-frames> <synth-frames> <hash-frames> <working dir>
+#
+# Moves the frames of a synthetic image sequence one by one into a directory
+# watched by crop-frames, and verifies that the outputs are identical to
+# those of crop-frames run on the complete sequence.
+
+CROP_FRAMES="$1"
+SYNTH_FRAMES="$2"
+HASH_FRAMES="$3"
+WORKING_DIR="$4"
+
+if [ -z "$WORKING_DIR" ]; then
+  echo "usage: $0 <crop-frames> <synth-frames> <hash-frames> <working dir>" 1>&2
+  exit 1
+fi
+
+fail()
+{
+  echo "$@" 1>&2
+  [ -z "$WATCHER" ] || kill $WATCHER 2> /dev/null
+  exit 1
+}
+
+# wait until file has given number of lines
+wait_lines()
+{
+  n=0
+  while [ ! -f "$1" ] || [ `wc -l < "$1"` -lt $2 ]; do
+    n=$((n + 1))
+    [ $n -le 100 ] || fail "Timeout waiting for $2 lines in $1!"
+    sleep 0.1
+  done
+}
+
+rm -rf "$WORKING_DIR"
+mkdir -p "$WORKING_DIR/render" "$WORKING_DIR/input" "$WORKING_DIR/single" "$WORKING_DIR/watch" || exit 1
+cd "$WORKING_DIR" || exit 1
+
+"$SYNTH_FRAMES" -o render/walk_%05d.png -k walk -n 6 -x 96 -y 60 || exit 1
+"$CROP_FRAMES" -i render/walk_00000.png -o single/walk.png       || exit 1
+"$CROP_FRAMES" -i render/walk_00000.png -o single/union.png -u   || exit 1
+
+# -----------------------------------------------------------------------------
+# tight mode: crop region of each frame is appended when it arrives
+cp render/walk_00000.png render/walk_00001.png input/ || exit 1
+"$CROP_FRAMES" --watch -i input/walk_00000.png -o watch/walk.png -e 5 &
+WATCHER=$!
+wait_lines watch/walk.csv 3
+for i in 2 3 4 5; do
+  cp render/walk_0000$i.png walk_0000$i.png && mv walk_0000$i.png input/ || fail "Failed to add frame $i!"
+  wait_lines watch/walk.csv $((i + 2))
+done
+wait $WATCHER || { WATCHER=; fail "Watch of sequence failed!"; }
+WATCHER=
+
+# -----------------------------------------------------------------------------
+# union mode: output is written once no new frame arrived
+"$CROP_FRAMES" --watch --idle 1 -u -i input/walk_00000.png -o watch/union.png \
+  || fail "Watch of sequence in union mode failed!"
+
+# -----------------------------------------------------------------------------
+# options which are not implemented by watch mode are rejected
+for option in "--bleed 2" "--masks watch/walk.mask" "--hull watch/hull.csv" "--delta watch/delta.csv" \
+              "--scales 0.5" "--regions" "--cache cache" "--stack" "--tiles watch/tiles.csv" "--colors 4"; do
+  "$CROP_FRAMES" --watch --idle 1 -i input/walk_00000.png -o watch/rejected.png $option 2> /dev/null \
+    && fail "Watch mode did not reject option $option!"
+done
+[ ! -e watch/rejected_000000.png ] || fail "Watch mode wrote output of rejected job!"
+
+# -----------------------------------------------------------------------------
+# compare outputs
+for name in walk union; do
+  cmp -s single/$name.csv watch/$name.csv || fail "CSV output of $name differs!"
+  (cd single && "$HASH_FRAMES" $name*.png) > expected.txt || exit 1
+  (cd watch  && "$HASH_FRAMES" $name*.png) > actual.txt   || exit 1
+  cmp -s expected.txt actual.txt || fail "Cropped frames of $name differ!"
+done
+exit 0
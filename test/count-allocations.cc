@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// Animation Toolkit
+#include "animtk.h"
+#include "pool.h"
+using namespace cimg_library;
+using namespace animtk;
+
+// ----------------------------------------------------------------------------
+// Crops each image sequence given as pair of input and output file names using
+// the same frame pool, and prints the number of heap allocations made by the
+// pool after each sequence. Once the pool holds a buffer for each frame, no
+// more memory is allocated for sequences of the same size, i.e., the program
+// fails if the number changes after the first sequence.
+int main(int argc, char *argv[])
+{
+  if (argc < 5 || argc % 2 == 0) {
+    fprintf(stderr, "usage: %s <input> <output> <input> <output>...\n", argv[0]);
+    exit(1);
+  }
+  FramePool     pool;
+  Sequence      seq;
+  unsigned long first = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    Job job;
+    job.input  = argv[i];
+    job.output = argv[i + 1];
+    try {
+      process(job, seq, pool);
+    } catch (const CImgException &err) {
+      fprintf(stderr, "Error: %s\n", err.what());
+      exit(1);
+    }
+    printf("%s: %lu allocations\n", job.input.c_str(), pool.allocations());
+    if (i == 1) {
+      first = pool.allocations();
+    } else if (pool.allocations() != first) {
+      fprintf(stderr, "Error: Frame pool allocated memory for %s!\n", job.input.c_str());
+      exit(1);
+    }
+  }
+  return 0;
+}
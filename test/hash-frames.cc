@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// CImg
+#include "CImgInstance.h"
+using namespace cimg_library;
+
+// ----------------------------------------------------------------------------
+// Hit-test masks
+#include "hitmask.h"
+using namespace animtk;
+
+// ----------------------------------------------------------------------------
+// 64-bit FNV-1a hash
+unsigned long long fnv1a(const void *data, size_t n)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < n; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// ----------------------------------------------------------------------------
+// Prints the number of pixels of each frame of a file of hit-test masks which
+// are hit, and checks that rectangle queries of 3x3 blocks agree with queries
+// of their pixels.
+void print_masks(const char *fname)
+{
+  HitMasks masks;
+  if (!masks.load(fname)) {
+    fprintf(stderr, "Error: Failed to read hit-test masks %s!\n", fname);
+    exit(1);
+  }
+  for (int frame = 0; frame < masks.frames(); ++frame) {
+    const int w = masks.width(frame), h = masks.height(frame);
+    int hits = 0;
+    for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x) {
+      if (masks.hit(frame, x, y)) ++hits;
+    }
+    for (int y = -1; y <= h; y += 3)
+    for (int x = -1; x <= w; x += 3) {
+      bool any = false;
+      for (int j = y; j < y + 3; ++j)
+      for (int i = x; i < x + 3; ++i) {
+        if (masks.hit(frame, i, j)) any = true;
+      }
+      if (masks.hit(frame, x, y, x + 2, y + 2) != any) {
+        fprintf(stderr, "Error: Query of rectangle at (%d, %d) of frame %d of %s disagrees with its pixels!\n", x, y, frame, fname);
+        exit(1);
+      }
+    }
+    printf("  frame %d at (%d, %d) %dx%d: %d hits\n", frame, masks.x(frame), masks.y(frame), w, h, hits);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Compressed textures
+//
+// The blocks are decoded as specified by Direct3D, independent of the encoder
+// of the animtk library, such that errors of its bit layout are detected.
+
+/// Read 16 bit value in little endian byte order
+unsigned int get16(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+/// Read 32 bit value in little endian byte order
+unsigned long get32(const unsigned char *p)
+{
+  return get16(p) | (static_cast<unsigned long>(get16(p + 2)) << 16);
+}
+
+/// Expand color of 5:6:5 format
+void unpack565(unsigned int v, int *c)
+{
+  const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+  c[0] = (r << 3) | (r >> 2);
+  c[1] = (g << 2) | (g >> 4);
+  c[2] = (b << 3) | (b >> 2);
+}
+
+/// Decode BC1 color block, where BC3 color blocks always use four colors
+void decode_color(const unsigned char *in, bool bc1, unsigned char px[16][4])
+{
+  const unsigned int c0 = get16(in), c1 = get16(in + 2);
+  int pal[4][4];
+  unpack565(c0, pal[0]);
+  unpack565(c1, pal[1]);
+  pal[0][3] = pal[1][3] = pal[2][3] = pal[3][3] = 255;
+  for (int c = 0; c < 3; ++c) {
+    if (c0 > c1 || !bc1) {
+      pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+      pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+    } else {
+      pal[2][c] = (pal[0][c] + pal[1][c]) / 2;
+      pal[3][c] = 0;
+    }
+  }
+  if (c0 <= c1 && bc1) pal[3][3] = 0;
+  const unsigned long bits = get32(in + 4);
+  for (int i = 0; i < 16; ++i) {
+    const int k = (bits >> (2 * i)) & 3;
+    for (int c = 0; c < 4; ++c) px[i][c] = static_cast<unsigned char>(pal[k][c]);
+  }
+}
+
+/// Decode BC3 alpha block
+void decode_alpha(const unsigned char *in, unsigned char px[16][4])
+{
+  const int a0 = in[0], a1 = in[1];
+  int pal[8];
+  pal[0] = a0, pal[1] = a1;
+  if (a0 > a1) {
+    for (int k = 2; k < 8; ++k) pal[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+  } else {
+    for (int k = 2; k < 6; ++k) pal[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+    pal[6] = 0, pal[7] = 255;
+  }
+  unsigned long long bits = 0;
+  for (int b = 0; b < 6; ++b) bits |= static_cast<unsigned long long>(in[2 + b]) << (8 * b);
+  for (int i = 0; i < 16; ++i) px[i][3] = static_cast<unsigned char>(pal[(bits >> (3 * i)) & 7]);
+}
+
+/// Read bits of BC7 block, least significant bit first
+int get_bits(const unsigned char *in, int &pos, int n)
+{
+  int v = 0;
+  for (int b = 0; b < n; ++b, ++pos) v |= ((in[pos >> 3] >> (pos & 7)) & 1) << b;
+  return v;
+}
+
+/// Decode BC7 block, which must use mode 6
+bool decode_bc7(const unsigned char *in, unsigned char px[16][4])
+{
+  static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+  int pos = 0;
+  if (get_bits(in, pos, 7) != (1 << 6)) return false;
+  int e[2][4];
+  for (int c = 0; c < 4; ++c) {
+    e[0][c] = get_bits(in, pos, 7);
+    e[1][c] = get_bits(in, pos, 7);
+  }
+  const int p0 = get_bits(in, pos, 1), p1 = get_bits(in, pos, 1);
+  for (int c = 0; c < 4; ++c) {
+    e[0][c] = (e[0][c] << 1) | p0;
+    e[1][c] = (e[1][c] << 1) | p1;
+  }
+  for (int i = 0; i < 16; ++i) {
+    const int w = weights[get_bits(in, pos, i == 0 ? 3 : 4)];
+    for (int c = 0; c < 4; ++c) {
+      px[i][c] = static_cast<unsigned char>((e[0][c] * (64 - w) + e[1][c] * w + 32) >> 6);
+    }
+  }
+  return true;
+}
+
+/// Pixel of frame as RGBA
+void rgba(const CImg<unsigned char> &frame, int x, int y, unsigned char *p)
+{
+  const int nc = frame.spectrum();
+  if (nc < 3) p[0] = p[1] = p[2] = frame(x, y, 0, 0);
+  else for (int c = 0; c < 3; ++c) p[c] = frame(x, y, 0, c);
+  p[3] = (nc == 2 || nc >= 4) ? frame(x, y, 0, nc == 2 ? 1 : 3) : 255;
+}
+
+/// Decode blocks of DDS file and compare them to the cropped source frame
+///
+/// Pixels which are transparent in the source frame only need to be
+/// transparent, i.e., below one half for BC1, whose transparent pixels are
+/// black, and zero otherwise. Blocks whose compared pixels all have the same
+/// color must be exact up to the quantization of the endpoints, i.e., of
+/// 5:6:5 colors for BC1/BC3 and of the shared p-bit for BC7. The root mean
+/// squared error of the channels of other blocks must not exceed MAX_RMSE,
+/// which allows for BC7 mode 6 blocks of transparent pixels and opaque pixels
+/// of two colors, whose opaque pixels share a single color of the line segment.
+const double MAX_RMSE = 40.;
+
+void check_texture(const char *fname, const CImg<unsigned char> &file, const CImg<unsigned char> &src)
+{
+  const unsigned char *dds = file.data();
+  if (file.size() < 128 || memcmp(dds, "DDS ", 4) != 0) {
+    fprintf(stderr, "Error: %s is no DDS file!\n", fname);
+    exit(1);
+  }
+  const int h = int(get32(dds + 12)), w = int(get32(dds + 16));
+  const bool bc1 = memcmp(dds + 84, "DXT1", 4) == 0;
+  const bool bc3 = memcmp(dds + 84, "DXT5", 4) == 0;
+  const bool bc7 = memcmp(dds + 84, "DX10", 4) == 0 && file.size() >= 148 && get32(dds + 128) == 98;
+  const size_t header = bc7 ? 148 : 128, bytes = bc1 ? 8 : 16;
+  const int    bw = (w + 3) / 4, bh = (h + 3) / 4;
+  if ((!bc1 && !bc3 && !bc7) || file.size() != header + size_t(bw) * bh * bytes) {
+    fprintf(stderr, "Error: Unknown format or invalid size of texture %s!\n", fname);
+    exit(1);
+  }
+  if (w != src.width() || h != src.height()) {
+    fprintf(stderr, "Error: Size of texture %s is %dx%d instead of %dx%d!\n", fname, w, h, src.width(), src.height());
+    exit(1);
+  }
+  const bool alpha = (src.spectrum() == 2 || src.spectrum() >= 4);
+  for (int by = 0; by < bh; ++by)
+  for (int bx = 0; bx < bw; ++bx) {
+    const unsigned char *in = dds + header + (size_t(by) * bw + bx) * bytes;
+    unsigned char px[16][4];
+    if (bc7) {
+      if (!decode_bc7(in, px)) {
+        fprintf(stderr, "Error: Block (%d, %d) of %s is not a BC7 mode 6 block!\n", bx, by, fname);
+        exit(1);
+      }
+    } else if (bc3) {
+      decode_color(in + 8, false, px);
+      decode_alpha(in, px);
+    } else {
+      decode_color(in, true, px);
+    }
+    double sse = 0.;
+    int    n = 0, maxerr[4] = {0, 0, 0, 0};
+    bool   flat = true;
+    unsigned char first[4];
+    for (int j = 0; j < 4; ++j)
+    for (int i = 0; i < 4; ++i) {
+      const int x = 4 * bx + i, y = 4 * by + j;
+      if (x >= w || y >= h) continue;
+      const unsigned char *d = px[4 * j + i];
+      unsigned char s[4];
+      rgba(src, x, y, s);
+      // Transparent pixels
+      const bool hidden = bc1 ? (alpha && s[3] < 128) : (s[3] == 0);
+      if (hidden) {
+        if (d[3] > (bc7 ? 1 : 0)) {
+          fprintf(stderr, "Error: Transparent pixel (%d, %d) of %s has alpha %d!\n", x, y, fname, d[3]);
+          exit(1);
+        }
+        continue;
+      }
+      if (bc1 && d[3] != 255) {
+        fprintf(stderr, "Error: Opaque pixel (%d, %d) of %s is transparent!\n", x, y, fname);
+        exit(1);
+      }
+      if (bc1) s[3] = 255;
+      if (n == 0) memcpy(first, s, 4);
+      else if (memcmp(first, s, 4) != 0) flat = false;
+      for (int c = 0; c < 4; ++c) {
+        const int e = cimg::abs(int(d[c]) - int(s[c]));
+        maxerr[c] = cimg::max(maxerr[c], e);
+        sse += e * e;
+      }
+      ++n;
+    }
+    if (n == 0) continue;
+    if (flat) {
+      const int tol[4] = {bc7 ? 1 : 4, bc7 ? 1 : 2, bc7 ? 1 : 4, bc7 ? 1 : 0};
+      for (int c = 0; c < 4; ++c) {
+        if (maxerr[c] > tol[c]) {
+          fprintf(stderr, "Error: Channel %d of flat block (%d, %d) of %s differs by %d!\n", c, bx, by, fname, maxerr[c]);
+          exit(1);
+        }
+      }
+    } else if (sqrt(sse / (4 * n)) > MAX_RMSE) {
+      fprintf(stderr, "Error: Error of block (%d, %d) of %s is %.1f!\n", bx, by, fname, sqrt(sse / (4 * n)));
+      exit(1);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Crop regions of CSV spreadsheet of crop-frames, indexed by row
+struct CropRegion
+{
+  int frame, x0, y0, x1, y1;
+};
+
+vector<CropRegion> read_regions(const char *fname)
+{
+  vector<CropRegion> regions;
+  FILE *fp = fopen(fname, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Failed to open CSV file %s!\n", fname);
+    exit(1);
+  }
+  char line[1024];
+  while (fgets(line, 1024, fp)) {
+    CropRegion r;
+    int        iw, ih, ow, oh, cx, cy, dx, dy;
+    if (sscanf(line, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d", &r.frame, &iw, &ih, &ow, &oh,
+               &cx, &cy, &dx, &dy, &r.x0, &r.y0, &r.x1, &r.y1) == 13) {
+      regions.push_back(r);
+    }
+  }
+  fclose(fp);
+  return regions;
+}
+
+// ----------------------------------------------------------------------------
+// Source of compressed texture given by the number at the end of its file
+// name, i.e., the row of the crop region in the CSV file, or the first row
+void texture_source(const char *fname, const char *pattern, const vector<CropRegion> &regions,
+                    CImg<unsigned char> &src)
+{
+  const string name  = cimg::basename(fname);
+  const size_t dot   = name.rfind('.');
+  const size_t under = name.rfind('_');
+  int row = 0;
+  if (under != string::npos && dot != string::npos && under < dot) {
+    row = atoi(name.substr(under + 1, dot - under - 1).c_str());
+  }
+  if (row < 0 || row >= int(regions.size())) {
+    fprintf(stderr, "Error: No crop region of texture %s in CSV file!\n", fname);
+    exit(1);
+  }
+  const CropRegion &r = regions[row];
+  char input[1024];
+  snprintf(input, 1024, pattern, r.frame);
+  src.load(input);
+  src.crop(r.x0, r.y0, r.x1, r.y1);
+}
+
+// ----------------------------------------------------------------------------
+// Prints the size and a hash of the decoded pixel data of each image file
+// given as argument. Unlike a hash of the file itself, this hash does not
+// depend on the version and settings of the image encoding library.
+// Compressed textures and hit-test masks, which are written by crop-frames
+// itself, are hashed as they are. When the input frames and the CSV file of
+// crop-frames are given, the compressed textures whose file name contains
+// no '@', i.e., which are not resampled, are moreover decoded and compared
+// to the cropped input frames (see check_texture()).
+int main(int argc, char *argv[])
+{
+  const char *pattern = NULL, *csv = NULL;
+  int         first   = 1;
+  while (first + 1 < argc && (strcmp(argv[first], "-f") == 0 || strcmp(argv[first], "-c") == 0)) {
+    if (argv[first][1] == 'f') pattern = argv[first + 1];
+    else                       csv     = argv[first + 1];
+    first += 2;
+  }
+  if (first >= argc || (pattern == NULL) != (csv == NULL)) {
+    fprintf(stderr, "usage: %s [-f <input frames> -c <csv>] <image>...\n", argv[0]);
+    exit(1);
+  }
+  vector<CropRegion> regions;
+  if (csv) regions = read_regions(csv);
+  for (int i = first; i < argc; ++i) {
+    const char *ext = cimg::split_filename(argv[i]);
+    if (cimg::strcasecmp(ext, "dds") == 0 || cimg::strcasecmp(ext, "mask") == 0) {
+      CImg<unsigned char> file;
+      try {
+        file.load_raw(argv[i]);
+      } catch (const CImgException &err) {
+        fprintf(stderr, "Error: %s\n", err.what());
+        exit(1);
+      }
+      printf("%s %d bytes %016llx\n", cimg::basename(argv[i]), int(file.size()), fnv1a(file.data(), file.size()));
+      if (cimg::strcasecmp(ext, "mask") == 0) print_masks(argv[i]);
+      if (cimg::strcasecmp(ext, "dds") == 0 && pattern && !strchr(cimg::basename(argv[i]), '@')) {
+        CImg<unsigned char> src;
+        try {
+          texture_source(argv[i], pattern, regions, src);
+        } catch (const CImgException &err) {
+          fprintf(stderr, "Error: %s\n", err.what());
+          exit(1);
+        }
+        check_texture(argv[i], file, src);
+      }
+      continue;
+    }
+    CImg<unsigned char> img;
+    try {
+      img.load(argv[i]);
+    } catch (const CImgException &err) {
+      fprintf(stderr, "Error: %s\n", err.what());
+      exit(1);
+    }
+    printf("%s %dx%dx%dx%d %016llx\n", cimg::basename(argv[i]),
+           img.width(), img.height(), img.depth(), img.spectrum(), fnv1a(img.data(), img.size()));
+  }
+  return 0;
+}
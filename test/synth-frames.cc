@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2013, Andreas Schuh
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License long
+ * with The Animation Toolkit. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include "config.h"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+// CImg
+#include "CImgInstance.h"
+using namespace cimg_library;
+
+// ----------------------------------------------------------------------------
+// Simple linear congruential generator such that the generated frames are
+// identical on all platforms, unlike when using std::rand
+struct Random
+{
+  unsigned int state;
+  Random(unsigned int seed) : state(seed) {}
+  int operator ()(int n) { state = state * 1103515245u + 12345u; return int((state >> 16) % unsigned(n)); }
+};
+
+// ----------------------------------------------------------------------------
+// Draw a sprite consisting of a body and two arms with the given phase
+void draw_sprite(CImg<unsigned char> &img, int x, int y, int r, int phase, const unsigned char *color)
+{
+  const unsigned char shade[4] = {
+    (unsigned char)(color[0] / 2), (unsigned char)(color[1] / 2), (unsigned char)(color[2] / 2), color[3]
+  };
+  img.draw_ellipse(x, y, float(r), float(r + r / 2), 0.f, color);
+  img.draw_rectangle(x - r / 2, y - r / 4, x + r / 2, y + r / 4, shade);
+  const int a = (phase % 8) - 4;
+  img.draw_line(x - r, y, x - 2 * r, y + a * r / 4, shade);
+  img.draw_line(x + r, y, x + 2 * r, y - a * r / 4, shade);
+}
+
+// ----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  // Command help
+  cimg_usage("[options] -o frames_\%05d.png\n"
+"\n version: " VERSION);
+  cimg_help(" This program generates synthetic image sequences which are used for benchmarks,\n"
+            " profile-guided optimization, and regression tests of the other tools.\n");
+  // Command-line options
+  string ofname = cimg_option("-o", "synth_\%05d.png", "Output sequence, must contain a format pattern such as \%05d.");
+  string kind   = cimg_option("-k", "walk", "Kind of animation (walk, twin, limbs, blink, pixel, empty, opaque, noise).");
+  int    n      = cimg_option("-n", 24,     "Number of frames.");
+  int    w      = cimg_option("-x", 256,    "Width of frames.");
+  int    h      = cimg_option("-y", 192,    "Height of frames.");
+  int    c      = cimg_option("-c", 4,      "Number of channels (3: RGB, 4: RGBA).");
+  int    seed   = cimg_option("-r", 1,      "Seed of pseudo-random number generator.");
+  // Check arguments
+  for (int i = 0; i < argc; ++i) {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0 || strcmp(argv[i], "--help") == 0) {
+      printf("\n");
+      exit(0);
+    }
+  }
+  if (n < 1 || w < 1 || h < 1 || c < 1 || c > 4) {
+    fprintf(stderr, "Invalid number of frames, image size, or number of channels!\n");
+    exit(1);
+  }
+  // Generate frames
+  Random rnd((unsigned int)seed);
+  const unsigned char opaque[4] = { 255, 255, 255, 255 };
+  unsigned char color[4] = { 200, 120, 40, 255 };
+  char buffer[1024];
+  for (int frame = 0; frame < n; ++frame) {
+    CImg<unsigned char> img(w, h, 1, c, 0);
+    const int r = cimg::max(1, cimg::min(w, h) / 12);
+    if (kind == "walk") {
+      const int x = r * 2 + (frame * cimg::max(1, w - r * 4)) / n;
+      const int y = h / 2 + (frame % 4) - 2;
+      color[0] = (unsigned char)(100 + rnd(156));
+      draw_sprite(img, x, y, r + (frame % 3), frame, color);
+    } else if (kind == "twin") {
+      draw_sprite(img, w / 6, h / 2, r, frame, color);
+      const int x = w / 2 + (frame * (w / 2 - r)) / n;
+      img.draw_circle(x, h / 4, cimg::max(1, r / 3), opaque);
+    } else if (kind == "limbs") {
+      draw_sprite(img, w / 2, h / 2, r * 2, frame, color);
+    } else if (kind == "blink") {
+      // Enters at the left edge and is missing from every third frame
+      if (frame % 3 != 2) draw_sprite(img, (frame * w) / n, h / 2, r, frame, color);
+    } else if (kind == "pixel") {
+      img.draw_point(rnd(w), rnd(h), opaque);
+    } else if (kind == "opaque") {
+      img.fill(255);
+      img.draw_rectangle(0, 0, w / 2, h / 2, color);
+    } else if (kind == "noise") {
+      cimg_forXYC(img, x, y, k) img(x, y, 0, k) = (unsigned char)rnd(256);
+    } else if (kind != "empty") {
+      fprintf(stderr, "Unknown kind of animation: %s\n", kind.c_str());
+      exit(1);
+    }
+    snprintf(buffer, 1024, ofname.c_str(), frame);
+    try {
+      img.save(buffer);
+    } catch (const CImgException &err) {
+      fprintf(stderr, "Error: %s\n", err.what());
+      exit(1);
+    }
+  }
+  return 0;
+}